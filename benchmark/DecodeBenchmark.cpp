@@ -0,0 +1,95 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// Measures how fast the consumer decodes events into JsonBuilders, with no
+// lttng session involved: the events come from the synthetic source, for a
+// few payload shapes, and the callback only counts them.
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <jsonbuilder/JsonBuilder.h>
+#include <lttng-consume/LttngConsumer.h>
+
+using namespace LttngConsume;
+
+namespace {
+
+struct PayloadShape
+{
+    const char* Name;
+    std::vector<SyntheticField> Fields;
+};
+
+double RunConsumer(const LttngConsumerOptions& options, uint64_t& eventCount)
+{
+    LttngConsumer consumer{ "synthetic://",
+                            std::chrono::milliseconds{ 50 },
+                            options };
+
+    auto start = std::chrono::steady_clock::now();
+
+    eventCount = 0;
+    consumer.StartConsuming(
+        [&eventCount](jsonbuilder::JsonBuilder&) { eventCount++; });
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double>(elapsed).count();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t totalEvents = 2000000;
+    if (argc > 1)
+    {
+        totalEvents = std::stoull(argv[1]);
+    }
+
+    const PayloadShape shapes[] = {
+        { "integer", { { "value" } } },
+        { "scalars",
+          { { "count", SyntheticFieldType::UnsignedInteger },
+            { "delta", SyntheticFieldType::SignedInteger },
+            { "ratio", SyntheticFieldType::Real },
+            { "state", SyntheticFieldType::Enumeration, 4 } } },
+        { "strings",
+          { { "host", SyntheticFieldType::String, 16 },
+            { "message", SyntheticFieldType::String, 128 } } },
+        { "arrays",
+          { { "samples", SyntheticFieldType::IntegerArray, 16 },
+            { "extra", SyntheticFieldType::IntegerSequence, 16 } } }
+    };
+
+    const uint32_t streamCounts[] = { 1, 16 };
+
+    std::cout << std::setw(10) << "payload" << std::setw(10) << "streams"
+              << std::setw(16) << "ev/s" << std::endl;
+
+    for (const PayloadShape& shape : shapes)
+    {
+        for (uint32_t streamCount : streamCounts)
+        {
+            LttngConsumerOptions options;
+            options.Ordering = MessageOrdering::TimestampMerge;
+            options.Synthetic.Fields = shape.Fields;
+            options.Synthetic.StreamCount = streamCount;
+            options.Synthetic.EventsPerStream = totalEvents / streamCount;
+
+            uint64_t eventCount = 0;
+            double seconds = RunConsumer(options, eventCount);
+
+            std::cout << std::setw(10) << shape.Name << std::setw(10)
+                      << streamCount << std::setw(16)
+                      << static_cast<uint64_t>(eventCount / seconds)
+                      << std::endl;
+        }
+    }
+
+    return 0;
+}
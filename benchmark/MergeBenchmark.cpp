@@ -0,0 +1,267 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// Compares lttng-consume's merge filter against babeltrace's utils.muxer.
+// The synthetic source emits the same total number of events spread over an
+// increasing number of streams, one output port per stream, with timestamps
+// interleaved so that every message forces a cross-stream decision.
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <babeltrace2/babeltrace.h>
+
+#include "BabelPtr.h"
+#include "FailureHelpers.h"
+#include "MergeFilter.h"
+#include "SyntheticSource.h"
+
+using namespace LttngConsume;
+
+namespace {
+
+// Sink that only counts event messages, so the filter dominates the cost
+struct CountingSink
+{
+    BabelPtr<bt_message_iterator> MessageItr;
+    uint64_t EventCount = 0;
+};
+
+bt_component_class_sink_consume_method_status
+CountingSink_RunStatic(bt_self_component_sink* self)
+{
+    auto sink = static_cast<CountingSink*>(bt_self_component_get_data(
+        bt_self_component_sink_as_self_component(self)));
+
+    bt_message_array_const messages = nullptr;
+    uint64_t count = 0;
+    bt_message_iterator_next_status status =
+        bt_message_iterator_next(sink->MessageItr.Get(), &messages, &count);
+
+    switch (status)
+    {
+    case BT_MESSAGE_ITERATOR_NEXT_STATUS_END:
+        sink->MessageItr.Reset();
+        return BT_COMPONENT_CLASS_SINK_CONSUME_METHOD_STATUS_END;
+    case BT_MESSAGE_ITERATOR_NEXT_STATUS_AGAIN:
+        return BT_COMPONENT_CLASS_SINK_CONSUME_METHOD_STATUS_AGAIN;
+    case BT_MESSAGE_ITERATOR_NEXT_STATUS_OK:
+        break;
+    default:
+        return BT_COMPONENT_CLASS_SINK_CONSUME_METHOD_STATUS_ERROR;
+    }
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        if (bt_message_get_type(messages[i]) == BT_MESSAGE_TYPE_EVENT)
+        {
+            sink->EventCount++;
+        }
+        bt_message_put_ref(messages[i]);
+    }
+
+    return BT_COMPONENT_CLASS_SINK_CONSUME_METHOD_STATUS_OK;
+}
+
+bt_component_class_initialize_method_status CountingSink_InitStatic(
+    bt_self_component_sink* self,
+    bt_self_component_sink_configuration*,
+    const bt_value*,
+    void* init_method_data)
+{
+    bt_self_component_add_port_status addPortStatus =
+        bt_self_component_sink_add_input_port(self, "in", nullptr, nullptr);
+    if (addPortStatus != BT_SELF_COMPONENT_ADD_PORT_STATUS_OK)
+    {
+        return static_cast<bt_component_class_initialize_method_status>(
+            addPortStatus);
+    }
+
+    bt_self_component_set_data(
+        bt_self_component_sink_as_self_component(self), init_method_data);
+
+    return BT_COMPONENT_CLASS_INITIALIZE_METHOD_STATUS_OK;
+}
+
+bt_component_class_sink_graph_is_configured_method_status
+CountingSink_GraphIsConfiguredStatic(bt_self_component_sink* self)
+{
+    auto sink = static_cast<CountingSink*>(bt_self_component_get_data(
+        bt_self_component_sink_as_self_component(self)));
+
+    bt_message_iterator_create_from_sink_component_status status =
+        bt_message_iterator_create_from_sink_component(
+            self,
+            bt_self_component_sink_borrow_input_port_by_name(self, "in"),
+            &sink->MessageItr);
+
+    return static_cast<bt_component_class_sink_graph_is_configured_method_status>(
+        status);
+}
+
+BabelPtr<const bt_component_class_sink> GetCountingSinkComponentClass()
+{
+    BabelPtr<bt_component_class_sink> sinkClass =
+        bt_component_class_sink_create("counting", CountingSink_RunStatic);
+    bt_component_class_sink_set_initialize_method(
+        sinkClass.Get(), CountingSink_InitStatic);
+    bt_component_class_sink_set_graph_is_configured_method(
+        sinkClass.Get(), CountingSink_GraphIsConfiguredStatic);
+
+    BabelPtr<const bt_component_class_sink> returnVal = sinkClass.Detach();
+    return returnVal;
+}
+
+enum class FilterKind
+{
+    Muxer,
+    Merge
+};
+
+double RunGraph(FilterKind filterKind, const SyntheticSourceOptions& options)
+{
+    BabelPtr<bt_graph> graph = bt_graph_create(0);
+
+    BabelPtr<const bt_component_class_source> sourceClass =
+        GetSyntheticSourceComponentClass();
+    SyntheticSourceOptions sourceOptions = options;
+    const bt_component_source* source = nullptr;
+    FAIL_FAST_IF(
+        bt_graph_add_source_component_with_initialize_method_data(
+            graph.Get(),
+            sourceClass.Get(),
+            "source",
+            nullptr,
+            &sourceOptions,
+            BT_LOGGING_LEVEL_WARNING,
+            &source) != BT_GRAPH_ADD_COMPONENT_STATUS_OK);
+
+    const bt_component_filter* filter = nullptr;
+    if (filterKind == FilterKind::Muxer)
+    {
+        BabelPtr<const bt_plugin> utilsPlugin;
+        FAIL_FAST_IF(
+            bt_plugin_find(
+                "utils",
+                BT_FALSE,
+                BT_FALSE,
+                BT_TRUE,
+                BT_FALSE,
+                BT_TRUE,
+                &utilsPlugin) != BT_PLUGIN_FIND_STATUS_OK);
+
+        FAIL_FAST_IF(
+            bt_graph_add_filter_component(
+                graph.Get(),
+                bt_plugin_borrow_filter_component_class_by_name_const(
+                    utilsPlugin.Get(), "muxer"),
+                "filter",
+                nullptr,
+                BT_LOGGING_LEVEL_WARNING,
+                &filter) != BT_GRAPH_ADD_COMPONENT_STATUS_OK);
+    }
+    else
+    {
+        BabelPtr<const bt_component_class_filter> mergeClass =
+            GetMergeFilterComponentClass();
+        FAIL_FAST_IF(
+            bt_graph_add_filter_component(
+                graph.Get(),
+                mergeClass.Get(),
+                "filter",
+                nullptr,
+                BT_LOGGING_LEVEL_WARNING,
+                &filter) != BT_GRAPH_ADD_COMPONENT_STATUS_OK);
+    }
+
+    BabelPtr<const bt_component_class_sink> sinkClass =
+        GetCountingSinkComponentClass();
+    CountingSink countingSink;
+    const bt_component_sink* sink = nullptr;
+    FAIL_FAST_IF(
+        bt_graph_add_sink_component_with_initialize_method_data(
+            graph.Get(),
+            sinkClass.Get(),
+            "sink",
+            nullptr,
+            &countingSink,
+            BT_LOGGING_LEVEL_WARNING,
+            &sink) != BT_GRAPH_ADD_COMPONENT_STATUS_OK);
+
+    // Both filters add a fresh "inN" port each time one gets connected
+    for (uint64_t i = 0; i < options.StreamCount; i++)
+    {
+        std::string inputPortName = "in" + std::to_string(i);
+        FAIL_FAST_IF(
+            bt_graph_connect_ports(
+                graph.Get(),
+                bt_component_source_borrow_output_port_by_index_const(source, i),
+                bt_component_filter_borrow_input_port_by_name_const(
+                    filter, inputPortName.c_str()),
+                nullptr) != BT_GRAPH_CONNECT_PORTS_STATUS_OK);
+    }
+
+    FAIL_FAST_IF(
+        bt_graph_connect_ports(
+            graph.Get(),
+            bt_component_filter_borrow_output_port_by_name_const(filter, "out"),
+            bt_component_sink_borrow_input_port_by_name_const(sink, "in"),
+            nullptr) != BT_GRAPH_CONNECT_PORTS_STATUS_OK);
+
+    auto start = std::chrono::steady_clock::now();
+
+    bt_graph_run_status status;
+    while ((status = bt_graph_run(graph.Get())) == BT_GRAPH_RUN_STATUS_AGAIN)
+    {}
+    FAIL_FAST_IF(status != BT_GRAPH_RUN_STATUS_OK);
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    FAIL_FAST_IF(
+        countingSink.EventCount != options.StreamCount * options.EventsPerStream);
+
+    return std::chrono::duration<double>(elapsed).count();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    bt_logging_set_global_level(BT_LOGGING_LEVEL_WARNING);
+
+    uint64_t totalEvents = 4000000;
+    if (argc > 1)
+    {
+        totalEvents = std::stoull(argv[1]);
+    }
+
+    const uint32_t streamCounts[] = { 1, 4, 16, 64, 128, 256, 512 };
+
+    std::cout << std::setw(8) << "streams" << std::setw(16) << "muxer ev/s"
+              << std::setw(16) << "merge ev/s" << std::setw(10) << "speedup"
+              << std::endl;
+
+    for (uint32_t streamCount : streamCounts)
+    {
+        SyntheticSourceOptions options;
+        options.StreamCount = streamCount;
+        options.EventsPerStream = totalEvents / streamCount;
+
+        double events =
+            static_cast<double>(streamCount * options.EventsPerStream);
+        double muxerSeconds = RunGraph(FilterKind::Muxer, options);
+        double mergeSeconds = RunGraph(FilterKind::Merge, options);
+
+        std::cout << std::setw(8) << streamCount << std::setw(16)
+                  << static_cast<uint64_t>(events / muxerSeconds)
+                  << std::setw(16) << static_cast<uint64_t>(events / mergeSeconds)
+                  << std::setw(10) << std::setprecision(3)
+                  << muxerSeconds / mergeSeconds << std::endl;
+    }
+
+    return 0;
+}
@@ -2,11 +2,21 @@
 // Licensed under the MIT License.
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <jsonbuilder/JsonBuilder.h>
+#include <lttng-consume/LttngConsumerOptions.h>
+#include <lttng-consume/LttngConsumerStatistics.h>
+#include <lttng-consume/LttngEventBatch.h>
+#include <lttng-consume/LttngSubscription.h>
+#include <lttng-consume/TypedEvent.h>
 
 namespace LttngConsume {
 
@@ -15,16 +25,127 @@ class LttngConsumerImpl;
 class LttngConsumer
 {
   public:
+    // listeningUrl is either an lttng-live URL such as
+    // "net://localhost/host/<host>/<session>", or the path of a recorded
+    // CTF trace, optionally prefixed with "file://". A recorded trace is
+    // read once and StartConsuming() returns at its end. "synthetic://"
+    // generates events as LttngConsumerOptions::Synthetic describes, and
+    // behaves like a recorded trace when they are limited in number.
     LttngConsumer(
         std::string_view listeningUrl,
-        std::chrono::milliseconds pollInterval);
+        std::chrono::milliseconds pollInterval,
+        const LttngConsumerOptions& options = {});
 
     ~LttngConsumer();
 
     void StartConsuming(std::function<void(jsonbuilder::JsonBuilder&&)> callback);
 
+    // Same as above for any functor, which is inlined into the loop over
+    // each batch so only the batch goes through a std::function. Events are
+    // moved into callbacks that accept a JsonBuilder&& or a JsonBuilder, as
+    // with the overload above. A callback that takes a JsonBuilder& or a
+    // const JsonBuilder& leaves the event in place, so its buffer is reused
+    // for later events.
+    template<typename Callback>
+    void StartConsuming(Callback&& callback)
+    {
+        StartConsumingBatches([&callback](LttngEventBatch& batch) {
+            for (jsonbuilder::JsonBuilder& builder : batch)
+            {
+                if constexpr (std::is_invocable_v<
+                                  Callback&,
+                                  jsonbuilder::JsonBuilder&&>)
+                {
+                    callback(std::move(builder));
+                }
+                else
+                {
+                    callback(builder);
+                }
+            }
+        });
+    }
+
+    // Like StartConsuming(), but hands over the events decoded from each
+    // batch of upstream messages at once. See LttngEventBatch for how long
+    // the events live.
+    void StartConsumingBatches(std::function<void(LttngEventBatch&)> callback);
+
     void StopConsuming();
 
+    // Pull alternative to StartConsuming() that runs the graph on the
+    // calling thread, one sink iteration at a time, until events were
+    // decoded or timeout passed. Replaces the contents of batch with at
+    // most maxEvents events, in the order StartConsuming() would deliver
+    // them, and keeps any others for the next call. An empty batch means
+    // the timeout passed first.
+    //
+    // Returns false, with nothing left to return, once a recorded trace was
+    // read to its end or StopConsuming() was called. Don't combine with
+    // StartConsuming() or ProcessAvailable(); throws std::invalid_argument
+    // when ShardCount or OfflineWorkerCount is above one.
+    bool NextBatch(
+        LttngEventBatch& batch,
+        size_t maxEvents,
+        std::chrono::milliseconds timeout);
+
+    // Event loop alternative to StartConsuming(). Returns a non-blocking fd
+    // that becomes readable when ProcessAvailable() should be called: right
+    // away while there is more to read, otherwise once pollInterval has
+    // passed. The fd stays owned by the consumer. Throws like NextBatch(),
+    // or std::system_error if the fd can't be created. For example:
+    //
+    //     epoll_event event{ EPOLLIN };
+    //     epoll_ctl(epollFd, EPOLL_CTL_ADD, consumer.GetPollFd(), &event);
+    //     ...
+    //     if (!consumer.ProcessAvailable(callback)) { /* remove the fd */ }
+    int GetPollFd();
+
+    // Runs the graph on the calling thread until it would block, or for at
+    // most pollInterval, handing events to callback as
+    // StartConsumingBatches() does. Returns false once a recorded trace was
+    // read to its end or StopConsuming() was called. Don't combine with
+    // StartConsuming() or NextBatch().
+    bool ProcessAvailable(
+        const std::function<void(LttngEventBatch&)>& callback);
+
+    // Events of the class named by the handler skip JSON: their bound fields
+    // are read straight into its struct and passed to its callback, on the
+    // thread running the graph. Other callbacks don't see them. Without
+    // shards, typed and JSON events reach their callbacks in the order
+    // given by Ordering. Shards deliver JSON events on their own threads,
+    // unordered with typed ones. A class whose bound fields don't match is
+    // decoded to JSON as usual and counted in LttngConsumerStatistics.
+    //
+    // Call before StartConsuming(); throws std::invalid_argument for a
+    // malformed field path or when OfflineWorkerCount is above one. For
+    // example:
+    //
+    //     consumer.AddTypedEvent(LttngConsume::MakeTypedEvent<MyEvent>(
+    //         "my_provider.my_event",
+    //         { LttngConsume::Bind<&MyEvent::Status>("data.status") },
+    //         [](const MyEvent& event) { ... }));
+    void AddTypedEvent(std::shared_ptr<TypedEventHandler> handler);
+
+    // Shares this consumer's session with another subscriber. Once any are
+    // added, events go to the subscribers whose filters they match instead
+    // of to the StartConsuming() callback, after the consumer's own Filter,
+    // budget and rate limits. Call before StartConsuming(); throws
+    // std::invalid_argument for a malformed filter or field, or when
+    // ShardCount or OfflineWorkerCount is above one or aggregating.
+    void Subscribe(LttngSubscription subscription);
+
+    // Safe to call from any thread, including while consuming
+    LttngConsumerStatistics GetStatistics() const;
+
+    // Safe to call from any thread. The view stays valid for the life of the
+    // consumer, so equal strings can be compared by pointer. Empty for an id
+    // that was never delivered.
+    std::string_view LookupInternedString(uint32_t id) const;
+
+    // Safe to call from any thread. Empty unless TrackLatency is set.
+    std::vector<LttngLatencyHistogram> GetLatencyHistograms() const;
+
   private:
     std::unique_ptr<LttngConsumerImpl> _impl;
 };
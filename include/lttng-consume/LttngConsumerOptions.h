@@ -0,0 +1,279 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace LttngConsume {
+
+enum class MessageOrdering
+{
+    // Every source output port is routed through babeltrace's utils.muxer,
+    // so events are delivered in global timestamp order across all streams.
+    Muxer,
+
+    // Same global timestamp order as Muxer, but produced by lttng-consume's
+    // own merge filter. It keys a binary heap on cached integer timestamps
+    // and stays cheap as the number of per-CPU streams grows.
+    TimestampMerge,
+
+    // Source output ports are connected straight to the sink, which reads
+    // them round-robin. Events are only ordered within a stream, but a quiet
+    // stream no longer holds back delivery of the others. That applies to
+    // a recorded trace and the synthetic source, which have a port per
+    // stream. A live session has a single port whose messages lttng-live
+    // already merges, so there this only saves the muxer's pass over every
+    // message.
+    Unordered
+};
+
+struct AggregationOptions
+{
+    // Length of each summary window in event time. When above zero, events
+    // are counted per class instead of decoded, and the callback receives
+    // one "lttng-consume.aggregate" record per window with those counts
+    // under "data". Sharding is ignored while aggregating. The last window
+    // is delivered at the end of a recorded trace or once consuming stops,
+    // by NextBatch() or ProcessAvailable() the first time they see it.
+    std::chrono::nanoseconds Interval{ 0 };
+
+    // A window is otherwise only emitted once an event from a later one
+    // arrives, so a window of a quiet live session is emitted anyway this
+    // long after its end by the wall clock. Events for it that arrive after
+    // that are counted in the next window, and in
+    // LttngConsumerStatistics::EventsAggregatedLate. Zero to always wait
+    // for a later event.
+    std::chrono::nanoseconds IdleFlushDelay{ std::chrono::seconds{ 1 } };
+
+    // Optional numeric field, e.g. "data.size", whose sum, min and max are
+    // added per class next to the count
+    std::string ValueField;
+
+    // Ascending upper bounds of a histogram of ValueField. A final bucket
+    // counts the values above the last bound.
+    std::vector<double> HistogramBounds;
+};
+
+struct EventRateLimit
+{
+    // Event name as delivered, e.g. "hello_world.my_first_tracepoint", or a
+    // prefix ending in '*' such as "hello_world.*"
+    std::string EventName;
+
+    // Fraction of matching events kept, evenly spaced rather than random
+    double SampleRatio = 1.0;
+
+    // Token bucket refilled at this rate in event time, applied to the
+    // events kept by sampling. Zero for no limit.
+    double EventsPerSecond = 0;
+
+    // Most events let through at once after a quiet period
+    uint32_t Burst = 1;
+};
+
+enum class MemoryBudgetPolicy
+{
+    // Stop reading from the trace until delivery catches up and enough
+    // held events are released, which has to happen outside the callback as
+    // it isn't called meanwhile. A live session then loses events in the
+    // tracer's own buffers, which are counted as discarded.
+    Block,
+
+    // Keep reading, but drop events undecoded while over budget
+    Drop
+};
+
+struct MemoryBudgetOptions
+{
+    // Most bytes of decoded events held on their way to the callback: in
+    // shard queues, in the batch being delivered and between offline
+    // workers and their merge, plus events callbacks keep with
+    // LttngEventBatch::Hold() and events shared with LttngSubscriptions,
+    // until they are released. Zero for no limit.
+    // Events a callback moves out of its batch directly are its own to
+    // account for.
+    uint64_t MaxBytes = 0;
+
+    MemoryBudgetPolicy Policy = MemoryBudgetPolicy::Block;
+};
+
+struct ThreadPlacementOptions
+{
+    // CPUs the threads may run on, e.g. cores kept away from the traced
+    // services. Empty to leave them to the scheduler.
+    std::vector<uint32_t> Cpus;
+
+    // NUMA node the threads prefer to allocate memory on, usually the node
+    // of Cpus, so decoded events stay local to the CPUs decoding them.
+    // Other nodes are still used once it is full.
+    std::optional<uint32_t> NumaNode;
+};
+
+struct CaptureOptions
+{
+    // When set, the messages read are also written to this directory with
+    // babeltrace's sink.ctf.fs, e.g. to replay a live session later as a
+    // recorded trace. Each segment is a complete trace of its own in a
+    // subdirectory named capture-<nanoseconds since the epoch>.
+    std::string Directory;
+
+    // A new segment is started once the current one reaches this size
+    uint64_t SegmentBytes = 64 * 1024 * 1024;
+
+    // The oldest segments are deleted before each new one starts, so that
+    // they and a full new segment fit within this. Zero to keep them all.
+    uint64_t MaxBytes = 0;
+};
+
+enum class SyntheticFieldType
+{
+    // The event's index within its stream
+    SignedInteger,
+    UnsignedInteger,
+    Real,
+
+    // Length letters, counting up through the alphabet from the one at the
+    // event's index modulo 26
+    String,
+
+    // The event's index modulo Length, each value labelled "LABEL<value>"
+    Enumeration,
+
+    // Length signed integers counting up from 0
+    IntegerArray,
+
+    // The first (index modulo (Length + 1)) elements of an IntegerArray
+    IntegerSequence
+};
+
+struct SyntheticField
+{
+    std::string Name;
+    SyntheticFieldType Type = SyntheticFieldType::UnsignedInteger;
+    uint32_t Length = 0;
+};
+
+struct SyntheticSourceOptions
+{
+    // Name of the one event class generated
+    std::string EventName = "synthetic:event";
+
+    // Members of the payload, in order
+    std::vector<SyntheticField> Fields{ { "value" } };
+
+    // Each stream has its own output port, like the streams of a recorded
+    // trace. Its packet context has a cpu_id of the stream's index, and
+    // each event's common context a vpid of that index plus one and a
+    // procname of "synthetic".
+    uint32_t StreamCount = 1;
+
+    // Events each stream emits before ending. Zero to keep emitting until
+    // StopConsuming().
+    uint64_t EventsPerStream = 0;
+
+    // Per stream, paced by the wall clock. Zero to emit events as fast as
+    // they are consumed.
+    double EventsPerSecond = 0;
+
+    uint32_t EventsPerPacket = 1024;
+};
+
+struct LttngConsumerOptions
+{
+    MessageOrdering Ordering = MessageOrdering::Muxer;
+
+    // When above one, streams are spread over this many shards as they
+    // begin, e.g. the per-CPU streams of a live session. Each shard decodes
+    // its events and invokes the callback on its own thread, so the
+    // callback must be thread safe. Ordering only holds within a stream and
+    // Ordering is treated as Unordered.
+    uint32_t ShardCount = 1;
+
+    // Optional field that picks the shard of each event instead of its
+    // stream, e.g. "streamEventContext.vpid", "packetContext.cpu_id"
+    // or "data.request_id". Events with equal keys always share a shard and
+    // keep the order given by Ordering, which is then left as configured.
+    // Events whose class lacks the field all go to the first shard.
+    std::string ShardKey;
+
+    AggregationOptions Aggregation;
+
+    // Checked in order and the first limit whose EventName matches an event
+    // class applies to it. Each event name is sampled and limited on its
+    // own, with one budget for its classes in every trace, e.g. lttng's
+    // per-PID buffers. Dropped events are never decoded and are counted in
+    // LttngConsumerStatistics.
+    std::vector<EventRateLimit> RateLimits;
+
+    // When set, only events for which this expression holds are decoded,
+    // checked on their raw fields before any rate limit, e.g.
+    //
+    //     data.status != 0 && streamEventContext.vpid in { 12, 34 }
+    //     !(data.name == "idle") || data.latency >= 1.5
+    //
+    // Paths are written as for ShardKey. Comparisons on a field the event's
+    // class lacks, or of a string with a number, are false. Events rejected
+    // are counted in LttngConsumerStatistics.
+    std::string Filter;
+
+    // When set, strings that repeat across events are delivered as JsonUInt
+    // ids rather than UTF-8 values: metadata.lttngName, eventHeader.trace,
+    // enum labels and the strings in packetContext and streamEventContext.
+    // LttngConsumer::LookupInternedString() maps an id back to its string.
+    bool InternStrings = false;
+
+    // When set, the delay between each event's timestamp and its delivery
+    // is recorded in histograms returned by
+    // LttngConsumer::GetLatencyHistograms()
+    bool TrackLatency = false;
+
+    // When set, only events timestamped within [Begin, End] are delivered.
+    // A recorded trace is read from the first packet that may hold Begin,
+    // found through the packet index LTTng stores next to each stream
+    // file, and reading stops at End. A live session and the synthetic
+    // source can't seek, so every event is read and those outside the
+    // window are dropped undecoded, before Filter, and counted in
+    // LttngConsumerStatistics. A live session keeps running past End.
+    std::optional<std::chrono::system_clock::time_point> Begin;
+    std::optional<std::chrono::system_clock::time_point> End;
+
+    // When above one and reading a recorded trace, its streams are dealt
+    // out to this many threads, each decoding its share with its own
+    // babeltrace graph. Their events are merged back into timestamp order
+    // on the thread that called StartConsuming(), unless Ordering is
+    // Unordered: then each thread invokes the callback, which must be
+    // thread safe. Can't be combined with ShardCount or Aggregation.
+    uint32_t OfflineWorkerCount = 1;
+
+    // Bytes held in flight are always reported in LttngConsumerStatistics,
+    // and only limited when MaxBytes is set
+    MemoryBudgetOptions MemoryBudget;
+
+    // Applied to the thread running StartConsuming() until it returns, and
+    // to every shard thread and offline worker. StartConsuming() throws
+    // std::system_error if the CPUs or node aren't available, right away
+    // for its own thread, or once the graph has stopped when one of its
+    // threads fails.
+    ThreadPlacementOptions Placement;
+
+    // Captures every message the consumer reads, before Filter, RateLimits
+    // or the MemoryBudget drop anything. Only a recorded trace is limited
+    // to Begin and End, a live session is captured in full. Writing
+    // happens on the thread running the graph, mostly while it would
+    // otherwise wait for the trace. Can't be combined with
+    // OfflineWorkerCount.
+    CaptureOptions Capture;
+
+    // Events generated when the listening URL is "synthetic://", so the
+    // consumer can be tested and measured without lttng. Timestamps start
+    // when the graph is built, a nanosecond apart across streams, or
+    // evenly spaced at EventsPerSecond.
+    SyntheticSourceOptions Synthetic;
+};
+
+}
@@ -0,0 +1,83 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace LttngConsume {
+
+// Running totals since the consumer was constructed
+struct LttngConsumerStatistics
+{
+    // Events of a live session or the synthetic source timestamped outside
+    // LttngConsumerOptions::Begin and End
+    uint64_t EventsOutsideWindow = 0;
+
+    // Events for which LttngConsumerOptions::Filter didn't hold
+    uint64_t EventsFilteredOut = 0;
+
+    // Events dropped by an EventRateLimit's SampleRatio
+    uint64_t EventsSampledOut = 0;
+
+    // Events dropped by an EventRateLimit's token bucket
+    uint64_t EventsRateLimited = 0;
+
+    // Events and packets the tracer reported as lost before they reached
+    // the consumer, e.g. because its ring buffers filled up
+    uint64_t EventsDiscarded = 0;
+    uint64_t PacketsDiscarded = 0;
+
+    // Bytes of decoded events on their way to the callback, held with
+    // LttngEventBatch::Hold() or by subscribers, now and at most so far.
+    // See MemoryBudgetOptions.
+    uint64_t InFlightBytes = 0;
+    uint64_t InFlightBytesHighWater = 0;
+
+    // Events dropped undecoded under MemoryBudgetPolicy::Drop
+    uint64_t EventsOverBudget = 0;
+
+    // Events counted in a later aggregation window than their own, because
+    // that window had already been emitted or a later one was open, e.g.
+    // under MessageOrdering::Unordered or after an idle flush. See
+    // AggregationOptions.
+    uint64_t EventsAggregatedLate = 0;
+
+    // Event classes named by a typed event whose bound fields are missing
+    // or can't be converted to their members. Their events are decoded to
+    // JSON instead.
+    uint64_t TypedBindingFailures = 0;
+
+    // Segments of LttngConsumerOptions::Capture started and deleted to stay
+    // within its MaxBytes
+    uint64_t CaptureSegments = 0;
+    uint64_t CaptureSegmentsDeleted = 0;
+
+    // Messages left out of the capture because writing a segment failed,
+    // e.g. for lack of disk space. The next segment is tried regardless.
+    uint64_t MessagesNotCaptured = 0;
+};
+
+// How long after being emitted events reached the callback, going by the
+// event timestamp and the wall clock just before the callback ran
+struct LttngLatencyHistogram
+{
+    static constexpr size_t c_bucketCount = 32;
+
+    // The trace_name of the trace, which lttng sets to the session name
+    std::string Session;
+
+    // Empty, with a StreamId of zero, for the total of a whole session
+    std::string Stream;
+    uint64_t StreamId = 0;
+
+    // Bucket i counts events delivered less than 2^i microseconds after
+    // their timestamp, and the last bucket also counts anything slower.
+    // Timestamps ahead of the wall clock count as no latency.
+    std::array<uint64_t, c_bucketCount> Buckets{};
+};
+
+}
@@ -0,0 +1,88 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <jsonbuilder/JsonBuilder.h>
+
+namespace LttngConsume {
+
+class InFlightMemory;
+struct InFlightAccount;
+
+// Events decoded from one batch of upstream messages, delivered together.
+//
+// The builders are owned by the consumer and reused for later batches once
+// the callback returns: clearing a JsonBuilder keeps its buffer, so in a
+// steady state decoding doesn't allocate. Hold() an event to keep it longer;
+// its slot gets a fresh buffer next time.
+class LttngEventBatch
+{
+  public:
+    using iterator = std::vector<jsonbuilder::JsonBuilder>::iterator;
+    using const_iterator =
+        std::vector<jsonbuilder::JsonBuilder>::const_iterator;
+
+    size_t size() const { return _count; }
+
+    bool empty() const { return _count == 0; }
+
+    jsonbuilder::JsonBuilder& operator[](size_t index)
+    {
+        return _builders[index];
+    }
+
+    const jsonbuilder::JsonBuilder& operator[](size_t index) const
+    {
+        return _builders[index];
+    }
+
+    iterator begin() { return _builders.begin(); }
+
+    iterator end() { return _builders.begin() + _count; }
+
+    const_iterator begin() const { return _builders.begin(); }
+
+    const_iterator end() const { return _builders.begin() + _count; }
+
+    // Returns an empty builder for the next event, reusing the buffer of an
+    // event from an earlier batch when there is one
+    jsonbuilder::JsonBuilder& EmplaceBack()
+    {
+        if (_count == _builders.size())
+        {
+            _builders.emplace_back();
+        }
+
+        jsonbuilder::JsonBuilder& builder = _builders[_count++];
+        builder.clear();
+        return builder;
+    }
+
+    // Forgets the events while keeping their buffers for reuse
+    void Clear() { _count = 0; }
+
+    // Moves an event out of the batch to keep after the callback returns.
+    // Until the returned pointer is released, on any thread, the event's
+    // bytes count against MemoryBudgetOptions::MaxBytes of the consumer
+    // that delivered the batch, so events held too long block or drop
+    // reading instead of growing without bound. An event moved out
+    // directly is the caller's own to account for.
+    std::shared_ptr<jsonbuilder::JsonBuilder> Hold(size_t index);
+
+  private:
+    friend class InFlightMemory;
+
+    std::vector<jsonbuilder::JsonBuilder> _builders;
+    size_t _count = 0;
+
+    // Set on batches a consumer delivers
+    std::shared_ptr<InFlightAccount> _account;
+};
+
+}
@@ -0,0 +1,39 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <jsonbuilder/JsonBuilder.h>
+
+namespace LttngConsume {
+
+// One of several consumers of the same session, added with
+// LttngConsumer::Subscribe(). Each event is decoded once for every
+// subscriber it matches, and the same immutable event is shared with all
+// of them.
+struct LttngSubscription
+{
+    // Expression with the syntax of LttngConsumerOptions::Filter, checked
+    // on the raw fields before anything is decoded. Empty for every event.
+    std::string Filter;
+
+    // Top level members the subscriber needs: "packetContext",
+    // "eventHeader", "streamEventContext", "eventContext" or "data". Empty
+    // for all of them. "name", "time" and "metadata" are always decoded.
+    // Events are decoded with the members of every subscriber they match,
+    // so a subscriber may see more than it asked for.
+    std::vector<std::string> Fields;
+
+    // Invoked on the thread running the graph. The event stays valid for
+    // as long as the subscriber holds on to it, and its buffer is reused
+    // once every subscriber has let go.
+    std::function<void(const std::shared_ptr<const jsonbuilder::JsonBuilder>&)>
+        Callback;
+};
+
+}
@@ -0,0 +1,147 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <jsonbuilder/JsonBuilder.h>
+#include <jsonbuilder/JsonRenderer.h>
+#include <lttng-consume/LttngConsumerOptions.h>
+#include <lttng-consume/LttngEventBatch.h>
+
+namespace LttngConsume {
+
+enum class NdjsonFsyncPolicy
+{
+    Never,
+
+    // Before a file is closed for rotation or when the writer is destroyed
+    OnRotate,
+
+    // After every batch of writes, and by Flush()
+    OnWrite
+};
+
+struct NdjsonWriterOptions
+{
+    // Files are named <FilePrefix>-<UTC start time>-<sequence>.ndjson
+    std::string Directory = ".";
+    std::string FilePrefix = "events";
+
+    // A new file is started once the current one would grow past this many
+    // bytes, or has been open this long. Zero disables either limit.
+    uint64_t MaxFileBytes = 256 * 1024 * 1024;
+    std::chrono::seconds MaxFileAge{ 0 };
+
+    NdjsonFsyncPolicy Fsync = NdjsonFsyncPolicy::OnRotate;
+
+    // Events are rendered into page aligned buffers of this size, and full
+    // buffers are written together with one writev(). A line that doesn't
+    // fit gets a buffer of its own.
+    size_t BufferBytes = 1024 * 1024;
+
+    // Partly filled buffers are written once they are this old
+    std::chrono::milliseconds FlushInterval{ 100 };
+
+    // Write() blocks while this many events wait to be rendered
+    size_t MaxQueuedEvents = 64 * 1024;
+
+    // Applied to the writer thread. Write() throws once it has failed.
+    ThreadPlacementOptions Placement;
+};
+
+// Renders events as newline delimited JSON and appends them to rotating
+// files, on its own thread. Meant to be fed from
+// LttngConsumer::StartConsumingBatches():
+//
+//     consumer.StartConsumingBatches(
+//         [&writer](LttngEventBatch& batch) { writer.Write(batch); });
+class NdjsonWriter
+{
+  public:
+    // Opens the first file. Throws std::system_error if that fails, and
+    // std::invalid_argument for a CPU in Placement beyond CPU_SETSIZE.
+    explicit NdjsonWriter(const NdjsonWriterOptions& options);
+
+    // Writes everything handed over so far
+    ~NdjsonWriter();
+
+    NdjsonWriter(const NdjsonWriter&) = delete;
+    NdjsonWriter& operator=(const NdjsonWriter&) = delete;
+
+    // Takes the events out of batch without copying them. Their slots get
+    // builders whose buffers were already written, so the batch keeps its
+    // storage. Throws std::system_error once a write has failed, or what
+    // else stopped the writer, e.g. std::bad_alloc.
+    void Write(LttngEventBatch& batch);
+
+    // Blocks until every event handed over so far is written, and synced
+    // under NdjsonFsyncPolicy::OnWrite. Throws like Write().
+    void Flush();
+
+  private:
+    // Holds whole lines only, so writes and rotations, which happen
+    // between buffers, never split a line across files
+    struct AlignedBuffer
+    {
+        std::unique_ptr<char, void (*)(void*)> Data{ nullptr, nullptr };
+        size_t Capacity = 0;
+        size_t Used = 0;
+    };
+
+    void Run();
+
+    void Render(const jsonbuilder::JsonBuilder& event);
+
+    // Returns a buffer with room for a line of this many bytes
+    AlignedBuffer& BufferFor(size_t lineBytes);
+
+    void WriteBuffers(bool includePartial);
+
+    void WriteToFile(size_t first, size_t last);
+
+    void OpenFile();
+
+    void CloseFile();
+
+    void ThrowIfFailed();
+
+  private:
+    NdjsonWriterOptions _options;
+
+    std::mutex _mutex;
+    std::condition_variable _wakeWriter;
+    std::condition_variable _wakeProducers;
+    std::vector<jsonbuilder::JsonBuilder> _pending;
+    std::vector<jsonbuilder::JsonBuilder> _recycled;
+    uint64_t _handedOver = 0;
+    uint64_t _written = 0;
+    size_t _flushWaiters = 0;
+    bool _stopping = false;
+    std::exception_ptr _error;
+
+    // Writer thread only, once started
+    jsonbuilder::JsonRenderer _renderer;
+    std::vector<AlignedBuffer> _buffers;
+    std::vector<AlignedBuffer> _freeBuffers;
+    int _fd = -1;
+    uint64_t _fileBytes = 0;
+    uint64_t _fileSequence = 0;
+    std::chrono::steady_clock::time_point _fileOpened;
+    std::chrono::steady_clock::time_point _lastWrite;
+
+    std::thread _thread;
+};
+
+}
@@ -0,0 +1,93 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace LttngConsume {
+
+namespace ShmRingLayout {
+struct Header;
+}
+
+// One event as stored by ShmRingWriter: the serialized buffer of its
+// JsonBuilder. jsonbuilder::JsonBuilder{ Data, Size } rebuilds it, or the
+// bytes can be forwarded as they are.
+struct ShmRingEvent
+{
+    const void* Data;
+    size_t Size;
+};
+
+// Reads the events published by a ShmRingWriter in another process. Part of
+// the lttng-consume-shmreader library, which depends on neither babeltrace
+// nor jsonbuilder.
+//
+// Events are handed out in place and their space is returned to the writer
+// when Read() returns, so reading costs no copy and no system call per
+// event. A reader isn't thread safe, but any number of readers may attach
+// to the same ring and each sees every event.
+class ShmRingReader
+{
+  public:
+    // Maps the ring and takes a reader slot, starting after the newest
+    // event. Throws std::system_error if the ring can't be opened and
+    // std::runtime_error if it isn't ready yet or all slots are taken.
+    explicit ShmRingReader(const std::string& name);
+
+    ~ShmRingReader();
+
+    ShmRingReader(const ShmRingReader&) = delete;
+    ShmRingReader& operator=(const ShmRingReader&) = delete;
+
+    // Invokes callback(const ShmRingEvent&) for up to maxEvents of the
+    // events published so far. Their data stays valid until Read() returns.
+    template <typename Callback>
+    size_t Read(Callback&& callback, size_t maxEvents = SIZE_MAX)
+    {
+        size_t count = 0;
+
+        ShmRingEvent event;
+        while (count < maxEvents && Next(event))
+        {
+            callback(const_cast<const ShmRingEvent&>(event));
+            count++;
+        }
+
+        Release();
+
+        return count;
+    }
+
+    // Blocks on a futex until events are published, the writer goes away
+    // or the timeout passes. Returns whether events are available.
+    bool Wait(std::chrono::milliseconds timeout);
+
+    // Whether the writer went away and every event was read
+    bool IsClosed() const;
+
+  private:
+    bool Next(ShmRingEvent& event);
+
+    // Lets the writer reuse the space of the events read so far
+    void Release();
+
+    bool Available() const;
+
+  private:
+    ShmRingLayout::Header* _header = nullptr;
+    const char* _data = nullptr;
+    size_t _mappedBytes = 0;
+    uint64_t _capacity = 0;
+    uint32_t _slot = 0;
+
+    uint64_t _position = 0;
+    uint64_t _released = 0;
+    uint64_t _published = 0;
+};
+
+}
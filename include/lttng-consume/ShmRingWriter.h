@@ -0,0 +1,82 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <jsonbuilder/JsonBuilder.h>
+#include <lttng-consume/LttngEventBatch.h>
+
+namespace LttngConsume {
+
+namespace ShmRingLayout {
+struct Header;
+}
+
+struct ShmRingOptions
+{
+    // POSIX shared memory name, starting with '/'
+    std::string Name = "/lttng-consume";
+
+    // Size of the data area, rounded up to a power of two
+    size_t CapacityBytes = 64 * 1024 * 1024;
+};
+
+// Publishes events to other processes on the same host through a shared
+// memory ring. Each event is stored as its serialized JsonBuilder buffer,
+// which ShmRingReader hands out in place. Every reader sees every event.
+//
+// Writes never block. An event that doesn't fit before the slowest reader
+// is dropped and counted, and readers whose process has exited are
+// detached. Meant to be fed from LttngConsumer::StartConsumingBatches():
+//
+//     consumer.StartConsumingBatches(
+//         [&writer](LttngEventBatch& batch) { writer.Write(batch); });
+class ShmRingWriter
+{
+  public:
+    // Creates the shared memory object, replacing any left behind by an
+    // earlier writer. Throws std::invalid_argument for a bad name and
+    // std::system_error if it can't be created.
+    explicit ShmRingWriter(const ShmRingOptions& options);
+
+    // Marks the ring closed, wakes readers and unlinks the name. Readers
+    // that are attached keep their mapping.
+    ~ShmRingWriter();
+
+    ShmRingWriter(const ShmRingWriter&) = delete;
+    ShmRingWriter& operator=(const ShmRingWriter&) = delete;
+
+    // Copies each event into the ring and publishes them together, waking
+    // waiting readers once per batch. Returns the number written.
+    size_t Write(const LttngEventBatch& batch);
+
+    // Returns whether the event was written
+    bool Write(const jsonbuilder::JsonBuilder& event);
+
+    uint64_t GetDroppedEvents() const { return _droppedEvents; }
+
+  private:
+    bool Append(const jsonbuilder::JsonBuilder& event);
+
+    void Publish();
+
+    // Recomputes how far the writer may go before overwriting a reader
+    void UpdateLimit();
+
+  private:
+    std::string _name;
+    ShmRingLayout::Header* _header = nullptr;
+    char* _data = nullptr;
+    size_t _mappedBytes = 0;
+    uint64_t _capacity = 0;
+
+    uint64_t _writeOffset = 0;
+    uint64_t _limit = 0;
+    uint64_t _droppedEvents = 0;
+};
+
+}
@@ -0,0 +1,234 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace LttngConsume {
+
+// What a bound struct member holds, which decides how the event field is
+// read and converted
+enum class TypedFieldKind
+{
+    Signed,
+    Unsigned,
+    Real,
+    Bool,
+    String
+};
+
+// One field value as read from an event. Only the member matching the
+// field's TypedFieldKind is set. String points into the event and is only
+// valid until the handler returns.
+struct TypedFieldValue
+{
+    union
+    {
+        int64_t Signed;
+        uint64_t Unsigned;
+        double Real;
+        bool Bool;
+    };
+
+    std::string_view String;
+};
+
+// A struct member bound to an event field, made with Bind<>()
+template<typename Event>
+struct TypedField
+{
+    // FieldPath syntax, e.g. "data.status" or "streamEventContext.vpid"
+    std::string Path;
+    TypedFieldKind Kind;
+    void (*Store)(Event& event, const TypedFieldValue& value);
+};
+
+namespace Detail {
+
+template<typename MemberPointer>
+struct MemberPointerTraits;
+
+template<typename Class, typename Type>
+struct MemberPointerTraits<Type Class::*>
+{
+    using ClassType = Class;
+    using MemberType = Type;
+};
+
+template<typename T>
+constexpr TypedFieldKind GetTypedFieldKind()
+{
+    if constexpr (std::is_same_v<T, bool>)
+    {
+        return TypedFieldKind::Bool;
+    }
+    else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+    {
+        return TypedFieldKind::Signed;
+    }
+    else if constexpr (std::is_integral_v<T>)
+    {
+        return TypedFieldKind::Unsigned;
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+        return TypedFieldKind::Real;
+    }
+    else
+    {
+        static_assert(
+            std::is_same_v<T, std::string> ||
+                std::is_same_v<T, std::string_view>,
+            "Bound members must be arithmetic, std::string or "
+            "std::string_view");
+        return TypedFieldKind::String;
+    }
+}
+
+template<auto Member>
+void StoreTypedField(
+    typename MemberPointerTraits<decltype(Member)>::ClassType& event,
+    const TypedFieldValue& value)
+{
+    using Type = typename MemberPointerTraits<decltype(Member)>::MemberType;
+    constexpr TypedFieldKind kind = GetTypedFieldKind<Type>();
+
+    if constexpr (kind == TypedFieldKind::Bool)
+    {
+        event.*Member = value.Bool;
+    }
+    else if constexpr (kind == TypedFieldKind::Signed)
+    {
+        event.*Member = static_cast<Type>(value.Signed);
+    }
+    else if constexpr (kind == TypedFieldKind::Unsigned)
+    {
+        event.*Member = static_cast<Type>(value.Unsigned);
+    }
+    else if constexpr (kind == TypedFieldKind::Real)
+    {
+        event.*Member = static_cast<Type>(value.Real);
+    }
+    else
+    {
+        event.*Member = Type{ value.String };
+    }
+}
+
+}
+
+// Binds the struct member Member to the event field at path:
+//
+//     LttngConsume::Bind<&MyEvent::Status>("data.status")
+//
+// The member type picks the conversion, so checking it against the field
+// class only happens once per event class. A std::string_view member
+// points into the event and is only valid during the callback.
+template<auto Member>
+TypedField<typename Detail::MemberPointerTraits<decltype(Member)>::ClassType>
+Bind(std::string_view path)
+{
+    using Traits = Detail::MemberPointerTraits<decltype(Member)>;
+
+    return { std::string{ path },
+             Detail::GetTypedFieldKind<typename Traits::MemberType>(),
+             &Detail::StoreTypedField<Member> };
+}
+
+// Type erased side of a typed event, as the consumer sees it
+class TypedEventHandler
+{
+  public:
+    virtual ~TypedEventHandler() = default;
+
+    // Event name as delivered, e.g. "hello_world.my_first_tracepoint"
+    const std::string& EventName() const { return _eventName; }
+
+    const std::vector<std::pair<std::string, TypedFieldKind>>& Fields() const
+    {
+        return _fields;
+    }
+
+    // Receives one value per field, in the order of Fields()
+    virtual void Deliver(const TypedFieldValue* values) = 0;
+
+  protected:
+    TypedEventHandler(
+        std::string eventName,
+        std::vector<std::pair<std::string, TypedFieldKind>> fields)
+        : _eventName(std::move(eventName)), _fields(std::move(fields))
+    {
+    }
+
+  private:
+    std::string _eventName;
+    std::vector<std::pair<std::string, TypedFieldKind>> _fields;
+};
+
+// Fills an Event from each matching event and passes it to Callback, which
+// is called directly so it can be inlined. The same Event is reused, so
+// string members keep their capacity.
+template<typename Event, typename Callback>
+class TypedEventBinding final : public TypedEventHandler
+{
+  public:
+    TypedEventBinding(
+        std::string eventName,
+        std::vector<TypedField<Event>> fields,
+        Callback callback)
+        : TypedEventHandler(std::move(eventName), GetFieldSpecs(fields))
+        , _fields(std::move(fields))
+        , _callback(std::move(callback))
+    {
+    }
+
+    void Deliver(const TypedFieldValue* values) override
+    {
+        for (size_t i = 0; i < _fields.size(); i++)
+        {
+            _fields[i].Store(_event, values[i]);
+        }
+
+        _callback(static_cast<const Event&>(_event));
+    }
+
+  private:
+    static std::vector<std::pair<std::string, TypedFieldKind>>
+    GetFieldSpecs(const std::vector<TypedField<Event>>& fields)
+    {
+        std::vector<std::pair<std::string, TypedFieldKind>> specs;
+        for (const TypedField<Event>& field : fields)
+        {
+            specs.emplace_back(field.Path, field.Kind);
+        }
+
+        return specs;
+    }
+
+  private:
+    std::vector<TypedField<Event>> _fields;
+    Callback _callback;
+    Event _event{};
+};
+
+template<typename Event, typename Callback>
+std::shared_ptr<TypedEventHandler> MakeTypedEvent(
+    std::string eventName,
+    std::vector<TypedField<Event>> fields,
+    Callback&& callback)
+{
+    return std::make_shared<
+        TypedEventBinding<Event, std::decay_t<Callback>>>(
+        std::move(eventName),
+        std::move(fields),
+        std::forward<Callback>(callback));
+}
+
+}
@@ -114,10 +114,23 @@ class BabelPtr
 
 MAKE_PTR_TYPE(bt_plugin)
 MAKE_PTR_TYPE(bt_component_class_sink)
+MAKE_PTR_TYPE(bt_component_class_filter)
+MAKE_PTR_TYPE(bt_message_iterator_class)
 MAKE_PTR_TYPE(bt_value)
 MAKE_PTR_TYPE(bt_graph)
 MAKE_PTR_TYPE(bt_component_source)
 MAKE_PTR_TYPE(bt_component_filter)
 MAKE_PTR_TYPE(bt_component_sink)
 MAKE_PTR_TYPE(bt_message_iterator)
+MAKE_PTR_TYPE(bt_component_class_source)
+MAKE_PTR_TYPE(bt_trace_class)
+MAKE_PTR_TYPE(bt_stream_class)
+MAKE_PTR_TYPE(bt_clock_class)
+MAKE_PTR_TYPE(bt_event_class)
+MAKE_PTR_TYPE(bt_field_class)
+MAKE_PTR_TYPE(bt_trace)
+MAKE_PTR_TYPE(bt_packet)
+MAKE_PTR_TYPE(bt_stream)
+MAKE_PTR_TYPE(bt_message)
+MAKE_PTR_TYPE(bt_integer_range_set_unsigned)
 }
@@ -0,0 +1,63 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <lttng-consume/LttngConsumerStatistics.h>
+
+namespace LttngConsume {
+
+// Counters behind LttngConsumerStatistics. Written by the graph thread and
+// read from any thread, so each one is atomic but they aren't read as one
+// consistent snapshot.
+struct ConsumerCounters
+{
+    std::atomic<uint64_t> EventsOutsideWindow{ 0 };
+    std::atomic<uint64_t> EventsFilteredOut{ 0 };
+    std::atomic<uint64_t> EventsSampledOut{ 0 };
+    std::atomic<uint64_t> EventsRateLimited{ 0 };
+    std::atomic<uint64_t> EventsDiscarded{ 0 };
+    std::atomic<uint64_t> PacketsDiscarded{ 0 };
+    std::atomic<uint64_t> EventsOverBudget{ 0 };
+    std::atomic<uint64_t> EventsAggregatedLate{ 0 };
+    std::atomic<uint64_t> TypedBindingFailures{ 0 };
+    std::atomic<uint64_t> CaptureSegments{ 0 };
+    std::atomic<uint64_t> CaptureSegmentsDeleted{ 0 };
+    std::atomic<uint64_t> MessagesNotCaptured{ 0 };
+
+    LttngConsumerStatistics Snapshot() const
+    {
+        LttngConsumerStatistics statistics;
+        statistics.EventsOutsideWindow =
+            EventsOutsideWindow.load(std::memory_order_relaxed);
+        statistics.EventsFilteredOut =
+            EventsFilteredOut.load(std::memory_order_relaxed);
+        statistics.EventsSampledOut =
+            EventsSampledOut.load(std::memory_order_relaxed);
+        statistics.EventsRateLimited =
+            EventsRateLimited.load(std::memory_order_relaxed);
+        statistics.EventsDiscarded =
+            EventsDiscarded.load(std::memory_order_relaxed);
+        statistics.PacketsDiscarded =
+            PacketsDiscarded.load(std::memory_order_relaxed);
+        statistics.EventsOverBudget =
+            EventsOverBudget.load(std::memory_order_relaxed);
+        statistics.EventsAggregatedLate =
+            EventsAggregatedLate.load(std::memory_order_relaxed);
+        statistics.TypedBindingFailures =
+            TypedBindingFailures.load(std::memory_order_relaxed);
+        statistics.CaptureSegments =
+            CaptureSegments.load(std::memory_order_relaxed);
+        statistics.CaptureSegmentsDeleted =
+            CaptureSegmentsDeleted.load(std::memory_order_relaxed);
+        statistics.MessagesNotCaptured =
+            MessagesNotCaptured.load(std::memory_order_relaxed);
+
+        return statistics;
+    }
+};
+
+}
@@ -0,0 +1,584 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "CtfCapture.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <babeltrace2/babeltrace.h>
+
+#include "ConsumerCounters.h"
+
+namespace LttngConsume {
+
+static bt_message_iterator_class_initialize_method_status
+CaptureReplayIterator_InitStatic(
+    bt_self_message_iterator* self,
+    bt_self_message_iterator_configuration*,
+    bt_self_component_port_output*)
+{
+    auto capture = static_cast<CtfCapture*>(bt_self_component_get_data(
+        bt_self_message_iterator_borrow_component(self)));
+
+    capture->AttachReplayIterator(self);
+    bt_self_message_iterator_set_data(self, capture);
+
+    return BT_MESSAGE_ITERATOR_CLASS_INITIALIZE_METHOD_STATUS_OK;
+}
+
+static bt_message_iterator_class_next_method_status
+CaptureReplayIterator_NextStatic(
+    bt_self_message_iterator* self,
+    bt_message_array_const messages,
+    uint64_t capacity,
+    uint64_t* count)
+{
+    auto capture =
+        static_cast<CtfCapture*>(bt_self_message_iterator_get_data(self));
+
+    return capture->Replay(messages, capacity, count);
+}
+
+static void CaptureReplayIterator_FinalizeStatic(bt_self_message_iterator* self)
+{
+    auto capture =
+        static_cast<CtfCapture*>(bt_self_message_iterator_get_data(self));
+
+    capture->AttachReplayIterator(nullptr);
+}
+
+static bt_component_class_initialize_method_status CaptureReplay_InitStatic(
+    bt_self_component_source* self,
+    bt_self_component_source_configuration*,
+    const bt_value*,
+    void* initData)
+{
+    bt_self_component_add_port_status addPortStatus =
+        bt_self_component_source_add_output_port(self, "out", nullptr, nullptr);
+    if (addPortStatus != BT_SELF_COMPONENT_ADD_PORT_STATUS_OK)
+    {
+        return static_cast<bt_component_class_initialize_method_status>(
+            addPortStatus);
+    }
+
+    // The capture outlives each segment graph, so it isn't owned here
+    bt_self_component_set_data(
+        bt_self_component_source_as_self_component(self), initData);
+
+    return BT_COMPONENT_CLASS_INITIALIZE_METHOD_STATUS_OK;
+}
+
+static BabelPtr<const bt_component_class_source>
+GetCaptureReplayComponentClass()
+{
+    BabelPtr<bt_message_iterator_class> replayIteratorClass =
+        bt_message_iterator_class_create(CaptureReplayIterator_NextStatic);
+    bt_message_iterator_class_set_initialize_method(
+        replayIteratorClass.Get(), CaptureReplayIterator_InitStatic);
+    bt_message_iterator_class_set_finalize_method(
+        replayIteratorClass.Get(), CaptureReplayIterator_FinalizeStatic);
+
+    BabelPtr<bt_component_class_source> replayClass =
+        bt_component_class_source_create(
+            "capture-replay", replayIteratorClass.Get());
+    bt_component_class_source_set_initialize_method(
+        replayClass.Get(), CaptureReplay_InitStatic);
+
+    BabelPtr<const bt_component_class_source> returnVal = replayClass.Detach();
+
+    return returnVal;
+}
+
+CtfCapture::CtfCapture(
+    const CaptureOptions& options,
+    ConsumerCounters& counters)
+    : _options(options)
+    , _counters(counters)
+{}
+
+CtfCapture::~CtfCapture()
+{
+    Pump();
+    CloseSegment();
+
+    for (const bt_message* message : _pending)
+    {
+        bt_message_put_ref(message);
+    }
+}
+
+void CtfCapture::Tee(const bt_message* const* messages, uint64_t count)
+{
+    for (uint64_t i = 0; i < count; i++)
+    {
+        bt_message_get_ref(messages[i]);
+        _pending.push_back(messages[i]);
+    }
+
+    if (_pending.size() >= c_maxPendingMessages)
+    {
+        Pump();
+    }
+}
+
+void CtfCapture::Pump()
+{
+    if (_pending.empty())
+    {
+        return;
+    }
+
+    if (!_segmentGraph && !OpenSegment())
+    {
+        AbandonSegment();
+        return;
+    }
+
+    while (!_pending.empty() || !_injected.empty())
+    {
+        bt_graph_run_once_status status =
+            bt_graph_run_once(_segmentGraph.Get());
+        if (status == BT_GRAPH_RUN_ONCE_STATUS_AGAIN)
+        {
+            break;
+        }
+
+        if (status != BT_GRAPH_RUN_ONCE_STATUS_OK)
+        {
+            AbandonSegment();
+            return;
+        }
+    }
+
+    // sink.ctf.fs writes whole packets, so the size only needs checking
+    // now and then
+    auto now = std::chrono::steady_clock::now();
+    if (now >= _nextSizeCheck)
+    {
+        _nextSizeCheck = now + c_sizeCheckInterval;
+        if (DirectorySize(_segmentDirectory) >= _options.SegmentBytes)
+        {
+            CloseSegment();
+        }
+    }
+}
+
+void CtfCapture::AttachReplayIterator(bt_self_message_iterator* iterator)
+{
+    _replayIterator = iterator;
+}
+
+bt_message_iterator_class_next_method_status CtfCapture::Replay(
+    bt_message_array_const messages,
+    uint64_t capacity,
+    uint64_t* count)
+{
+    uint64_t emitted = 0;
+    while (emitted < capacity)
+    {
+        if (!_injected.empty())
+        {
+            messages[emitted++] = _injected.front().Detach();
+            _injected.pop_front();
+            continue;
+        }
+
+        if (_segmentClosing || _pending.empty())
+        {
+            break;
+        }
+
+        // Reference ownership moves to the output array
+        const bt_message* message = _pending.front();
+        _pending.pop_front();
+
+        if (!Observe(message))
+        {
+            bt_message_put_ref(message);
+            continue;
+        }
+
+        messages[emitted++] = message;
+    }
+
+    if (emitted > 0)
+    {
+        *count = emitted;
+        return BT_MESSAGE_ITERATOR_CLASS_NEXT_METHOD_STATUS_OK;
+    }
+
+    return _segmentClosing ? BT_MESSAGE_ITERATOR_CLASS_NEXT_METHOD_STATUS_END :
+                             BT_MESSAGE_ITERATOR_CLASS_NEXT_METHOD_STATUS_AGAIN;
+}
+
+bool CtfCapture::OpenSegment()
+{
+    EnforceRetention();
+
+    // Zero padded so segments sort by name in the order they were written
+    long long nanoseconds =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count();
+
+    char segmentName[32];
+    snprintf(segmentName, sizeof(segmentName), "capture-%020lld", nanoseconds);
+    _segmentDirectory = std::filesystem::path(_options.Directory) / segmentName;
+
+    BabelPtr<const bt_plugin> ctfPlugin;
+    bt_plugin_find_status pluginFindStatus = bt_plugin_find(
+        "ctf", BT_FALSE, BT_FALSE, BT_TRUE, BT_FALSE, BT_TRUE, &ctfPlugin);
+    if (pluginFindStatus != BT_PLUGIN_FIND_STATUS_OK)
+    {
+        return false;
+    }
+
+    const bt_component_class_sink* fsSinkClass =
+        bt_plugin_borrow_sink_component_class_by_name_const(
+            ctfPlugin.Get(), "fs");
+
+    BabelPtr<bt_value> paramsMap = bt_value_map_create();
+    if (!paramsMap ||
+        bt_value_map_insert_string_entry(
+            paramsMap.Get(), "path", _segmentDirectory.c_str()) !=
+            BT_VALUE_MAP_INSERT_ENTRY_STATUS_OK ||
+        bt_value_map_insert_bool_entry(paramsMap.Get(), "quiet", BT_TRUE) !=
+            BT_VALUE_MAP_INSERT_ENTRY_STATUS_OK)
+    {
+        return false;
+    }
+
+    BabelPtr<bt_graph> graph = bt_graph_create(0);
+    if (!graph)
+    {
+        return false;
+    }
+
+    BabelPtr<const bt_component_class_source> replayClass =
+        GetCaptureReplayComponentClass();
+
+    const bt_component_source* replaySource = nullptr;
+    const bt_component_sink* fsSink = nullptr;
+    if (bt_graph_add_source_component_with_initialize_method_data(
+            graph.Get(),
+            replayClass.Get(),
+            "captureReplay",
+            nullptr,
+            this,
+            BT_LOGGING_LEVEL_WARNING,
+            &replaySource) != BT_GRAPH_ADD_COMPONENT_STATUS_OK ||
+        bt_graph_add_sink_component(
+            graph.Get(),
+            fsSinkClass,
+            "captureOutput",
+            paramsMap.Get(),
+            BT_LOGGING_LEVEL_WARNING,
+            &fsSink) != BT_GRAPH_ADD_COMPONENT_STATUS_OK ||
+        bt_graph_connect_ports(
+            graph.Get(),
+            bt_component_source_borrow_output_port_by_name_const(
+                replaySource, "out"),
+            bt_component_sink_borrow_input_port_by_name_const(fsSink, "in"),
+            nullptr) != BT_GRAPH_CONNECT_PORTS_STATUS_OK)
+    {
+        return false;
+    }
+
+    // Streams and packets still open in the previous segment begin again
+    // here. The same messages are reused, which sink.ctf.fs is fine with
+    // since it only reads them.
+    for (auto& [stream, state] : _streams)
+    {
+        _injected.push_back(state.Beginning);
+        if (state.PacketBeginning)
+        {
+            _injected.push_back(state.PacketBeginning);
+        }
+
+        state.SegmentHasPacketEnd = false;
+    }
+
+    _segmentGraph = std::move(graph);
+    _nextSizeCheck = std::chrono::steady_clock::now() + c_sizeCheckInterval;
+    _counters.CaptureSegments.fetch_add(1, std::memory_order_relaxed);
+
+    return true;
+}
+
+void CtfCapture::CloseSegment()
+{
+    if (!_segmentGraph)
+    {
+        return;
+    }
+
+    // End whatever is still open so the segment's last packets are written
+    // out instead of dropped
+    if (_replayIterator)
+    {
+        for (auto& [stream, state] : _streams)
+        {
+            if (state.PacketBeginning)
+            {
+                const bt_packet* packet =
+                    bt_message_packet_beginning_borrow_packet_const(
+                        state.PacketBeginning.Get());
+                const bt_stream_class* streamClass =
+                    bt_stream_borrow_class_const(stream);
+
+                BabelPtr<const bt_message> packetEnd =
+                    bt_stream_class_packets_have_end_default_clock_snapshot(
+                        streamClass) ?
+                        bt_message_packet_end_create_with_default_clock_snapshot(
+                            _replayIterator, packet, state.LastClockValue) :
+                        bt_message_packet_end_create(_replayIterator, packet);
+                if (!packetEnd)
+                {
+                    AbandonSegment();
+                    return;
+                }
+
+                _injected.push_back(std::move(packetEnd));
+            }
+
+            BabelPtr<const bt_message> streamEnd =
+                bt_message_stream_end_create(_replayIterator, stream);
+            if (!streamEnd)
+            {
+                AbandonSegment();
+                return;
+            }
+
+            _injected.push_back(std::move(streamEnd));
+        }
+
+        _segmentClosing = true;
+
+        bt_graph_run_once_status status;
+        do
+        {
+            status = bt_graph_run_once(_segmentGraph.Get());
+        } while (status == BT_GRAPH_RUN_ONCE_STATUS_OK);
+
+        if (status != BT_GRAPH_RUN_ONCE_STATUS_END)
+        {
+            AbandonSegment();
+            return;
+        }
+    }
+
+    // sink.ctf.fs writes the trace's metadata as it is finalized
+    _segmentGraph.Reset();
+    _segmentClosing = false;
+}
+
+void CtfCapture::AbandonSegment()
+{
+    // Whatever went wrong is reported through the statistics rather than
+    // left for the consumer's own graph to trip over
+    bt_current_thread_clear_error();
+
+    _injected.clear();
+    _segmentGraph.Reset();
+    _segmentClosing = false;
+
+    // The queued messages would likely fail the next segment too. They
+    // still open and close streams and packets for the segments after it.
+    _counters.MessagesNotCaptured.fetch_add(
+        _pending.size(), std::memory_order_relaxed);
+
+    while (!_pending.empty())
+    {
+        const bt_message* message = _pending.front();
+        _pending.pop_front();
+
+        Observe(message);
+        bt_message_put_ref(message);
+    }
+}
+
+bool CtfCapture::Observe(const bt_message* message)
+{
+    switch (bt_message_get_type(message))
+    {
+    case BT_MESSAGE_TYPE_STREAM_BEGINNING:
+    {
+        const bt_stream* stream =
+            bt_message_stream_beginning_borrow_stream_const(message);
+
+        bt_message_get_ref(message);
+        _streams[stream].Beginning = message;
+        return true;
+    }
+    case BT_MESSAGE_TYPE_STREAM_END:
+    {
+        const bt_stream* stream =
+            bt_message_stream_end_borrow_stream_const(message);
+        if (stream == _lastStream)
+        {
+            _lastStream = nullptr;
+            _lastStreamState = nullptr;
+        }
+
+        _streams.erase(stream);
+        return true;
+    }
+    case BT_MESSAGE_TYPE_PACKET_BEGINNING:
+    {
+        const bt_packet* packet =
+            bt_message_packet_beginning_borrow_packet_const(message);
+        const bt_stream* stream = bt_packet_borrow_stream_const(packet);
+
+        StreamState* state = FindStream(stream);
+        if (state)
+        {
+            bt_message_get_ref(message);
+            state->PacketBeginning = message;
+
+            if (bt_stream_class_packets_have_beginning_default_clock_snapshot(
+                    bt_stream_borrow_class_const(stream)))
+            {
+                state->LastClockValue = bt_clock_snapshot_get_value(
+                    bt_message_packet_beginning_borrow_default_clock_snapshot_const(
+                        message));
+            }
+        }
+        return true;
+    }
+    case BT_MESSAGE_TYPE_PACKET_END:
+    {
+        StreamState* state =
+            FindStream(bt_packet_borrow_stream_const(
+                bt_message_packet_end_borrow_packet_const(message)));
+        if (state)
+        {
+            state->PacketBeginning.Reset();
+            state->SegmentHasPacketEnd = true;
+        }
+        return true;
+    }
+    case BT_MESSAGE_TYPE_EVENT:
+    {
+        const bt_stream* stream = bt_event_borrow_stream_const(
+            bt_message_event_borrow_event_const(message));
+
+        StreamState* state = FindStream(stream);
+        if (state && bt_stream_class_borrow_default_clock_class_const(
+                         bt_stream_borrow_class_const(stream)))
+        {
+            state->LastClockValue = bt_clock_snapshot_get_value(
+                bt_message_event_borrow_default_clock_snapshot_const(message));
+        }
+        return true;
+    }
+    case BT_MESSAGE_TYPE_DISCARDED_EVENTS:
+    {
+        StreamState* state = FindStream(
+            bt_message_discarded_events_borrow_stream_const(message));
+        return !state || state->SegmentHasPacketEnd;
+    }
+    case BT_MESSAGE_TYPE_DISCARDED_PACKETS:
+    {
+        StreamState* state = FindStream(
+            bt_message_discarded_packets_borrow_stream_const(message));
+        return !state || state->SegmentHasPacketEnd;
+    }
+    default:
+        return true;
+    }
+}
+
+CtfCapture::StreamState* CtfCapture::FindStream(const bt_stream* stream)
+{
+    // Events mostly come in runs from the same stream. Elements of an
+    // unordered_map don't move, so the cached pointer stays valid until
+    // its stream is erased.
+    if (stream == _lastStream)
+    {
+        return _lastStreamState;
+    }
+
+    auto itr = _streams.find(stream);
+    if (itr == _streams.end())
+    {
+        return nullptr;
+    }
+
+    _lastStream = stream;
+    _lastStreamState = &itr->second;
+    return _lastStreamState;
+}
+
+void CtfCapture::EnforceRetention()
+{
+    if (_options.MaxBytes == 0)
+    {
+        return;
+    }
+
+    std::vector<std::pair<std::filesystem::path, uint64_t>> segments;
+    uint64_t totalBytes = 0;
+
+    std::error_code error;
+    for (std::filesystem::directory_iterator itr(_options.Directory, error);
+         !error && itr != std::filesystem::directory_iterator();
+         itr.increment(error))
+    {
+        std::error_code entryError;
+        if (itr->path().filename().string().rfind("capture-", 0) != 0 ||
+            !itr->is_directory(entryError))
+        {
+            continue;
+        }
+
+        uint64_t bytes = DirectorySize(itr->path());
+        segments.emplace_back(itr->path(), bytes);
+        totalBytes += bytes;
+    }
+
+    std::sort(segments.begin(), segments.end());
+
+    // Leave room for the segment about to be written
+    for (const auto& [segment, bytes] : segments)
+    {
+        if (totalBytes + _options.SegmentBytes <= _options.MaxBytes)
+        {
+            break;
+        }
+
+        std::error_code removeError;
+        std::filesystem::remove_all(segment, removeError);
+        totalBytes -= bytes;
+        _counters.CaptureSegmentsDeleted.fetch_add(
+            1, std::memory_order_relaxed);
+    }
+}
+
+uint64_t CtfCapture::DirectorySize(const std::filesystem::path& directory)
+{
+    uint64_t bytes = 0;
+
+    std::error_code error;
+    for (std::filesystem::recursive_directory_iterator itr(directory, error);
+         !error && itr != std::filesystem::recursive_directory_iterator();
+         itr.increment(error))
+    {
+        // Files may come and go while sink.ctf.fs writes
+        std::error_code entryError;
+        if (itr->is_regular_file(entryError))
+        {
+            uint64_t fileBytes = itr->file_size(entryError);
+            bytes += entryError ? 0 : fileBytes;
+        }
+    }
+
+    return bytes;
+}
+
+}
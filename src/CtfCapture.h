@@ -0,0 +1,115 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <unordered_map>
+
+#include <lttng-consume/LttngConsumerOptions.h>
+
+#include "BabelPtr.h"
+
+namespace LttngConsume {
+
+struct ConsumerCounters;
+
+// Writes the messages the sink reads to sink.ctf.fs, in a babeltrace graph
+// of its own whose source replays them. That graph is torn down and built
+// again for every segment, with the streams and packets still open carried
+// over, so each segment directory holds a complete trace that can be read
+// on its own.
+//
+// Babeltrace's reference counts aren't thread safe, so everything happens
+// on the graph thread. Writing is deferred until the sink is idle or enough
+// messages are queued, and never fails the consumer: a segment that can't
+// be written is abandoned and counted.
+class CtfCapture
+{
+  public:
+    CtfCapture(const CaptureOptions& options, ConsumerCounters& counters);
+
+    ~CtfCapture();
+
+    CtfCapture(const CtfCapture&) = delete;
+    CtfCapture& operator=(const CtfCapture&) = delete;
+
+    // Takes a reference to each message, writing queued ones out if there
+    // are too many
+    void Tee(const bt_message* const* messages, uint64_t count);
+
+    // Writes out every queued message, and starts a new segment when the
+    // current one has grown past SegmentBytes
+    void Pump();
+
+    // Used by the replay source of the segment graph
+    void AttachReplayIterator(bt_self_message_iterator* iterator);
+    bt_message_iterator_class_next_method_status
+    Replay(bt_message_array_const messages, uint64_t capacity, uint64_t* count);
+
+  public:
+    // Queued messages that trigger a write from Tee()
+    static constexpr size_t c_maxPendingMessages = 16384;
+
+    // How often the size of the current segment is checked
+    static constexpr std::chrono::seconds c_sizeCheckInterval{ 1 };
+
+  private:
+    struct StreamState
+    {
+        BabelPtr<const bt_message> Beginning;
+
+        // Set while a packet is open
+        BabelPtr<const bt_message> PacketBeginning;
+
+        // Raw value of the last clock snapshot in the stream, used to end
+        // its open packet when a segment closes
+        uint64_t LastClockValue = 0;
+
+        // Discarded events and packets are only passed on once the segment
+        // has the packet they follow, since sink.ctf.fs checks their times
+        // against it
+        bool SegmentHasPacketEnd = false;
+    };
+
+    bool OpenSegment();
+
+    void CloseSegment();
+
+    void AbandonSegment();
+
+    // Returns false when the message should be left out of the segment
+    bool Observe(const bt_message* message);
+
+    StreamState* FindStream(const bt_stream* stream);
+
+    void EnforceRetention();
+
+    static uint64_t DirectorySize(const std::filesystem::path& directory);
+
+  private:
+    CaptureOptions _options;
+    ConsumerCounters& _counters;
+
+    // Owned references waiting to be written
+    std::deque<const bt_message*> _pending;
+
+    // Messages the replay source hands out before _pending: the beginnings
+    // carried over into a new segment, or the ends closing the current one
+    std::deque<BabelPtr<const bt_message>> _injected;
+
+    std::unordered_map<const bt_stream*, StreamState> _streams;
+    const bt_stream* _lastStream = nullptr;
+    StreamState* _lastStreamState = nullptr;
+
+    BabelPtr<bt_graph> _segmentGraph;
+    std::filesystem::path _segmentDirectory;
+    bt_self_message_iterator* _replayIterator = nullptr;
+    bool _segmentClosing = false;
+    std::chrono::steady_clock::time_point _nextSizeCheck;
+};
+
+}
@@ -0,0 +1,164 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "DecodeLane.h"
+
+#include <babeltrace2/babeltrace.h>
+#include <jsonbuilder/JsonBuilder.h>
+
+#include "FailureHelpers.h"
+#include "ThreadPlacement.h"
+
+using namespace jsonbuilder;
+
+namespace LttngConsume {
+
+DecodeLane::DecodeLane(
+    std::function<void(LttngEventBatch&)>& outputFunc,
+    size_t maxQueuedBatches,
+    StringInterner* interner,
+    LatencyTracker* latencyTracker,
+    InFlightMemory& inFlight,
+    const ThreadPlacementOptions& placement,
+    PlacementErrors& placementErrors)
+    : _outputFunc(outputFunc)
+    , _maxQueuedBatches(maxQueuedBatches)
+    , _reader(interner)
+    , _inFlight(inFlight)
+    , _placement(placement)
+    , _placementErrors(placementErrors)
+{
+    FAIL_FAST_IF(_maxQueuedBatches == 0);
+
+    if (latencyTracker)
+    {
+        _latencyRecorder = std::make_unique<LatencyRecorder>(*latencyTracker);
+    }
+
+    _thread = std::thread{ &DecodeLane::Run, this };
+}
+
+DecodeLane::~DecodeLane()
+{
+    Drain();
+}
+
+bool DecodeLane::CanEnqueue()
+{
+    std::lock_guard<std::mutex> lock{ _mutex };
+    return _pending.size() < _maxQueuedBatches;
+}
+
+void DecodeLane::Enqueue(MessageBatch&& batch, uint64_t streamGeneration)
+{
+    uint64_t estimatedBytes = _inFlight.Estimate(batch.size());
+    _inFlight.Charge(estimatedBytes);
+
+    {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        FAIL_FAST_IF(_stopping);
+        _pending.push_back(QueuedBatch{ std::move(batch), estimatedBytes });
+        _streamGeneration = streamGeneration;
+    }
+
+    _wakeWorker.notify_one();
+}
+
+void DecodeLane::ReleaseDelivered()
+{
+    std::vector<MessageBatch> delivered;
+    {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        delivered.swap(_delivered);
+    }
+
+    for (const MessageBatch& batch : delivered)
+    {
+        for (const bt_message* message : batch)
+        {
+            bt_message_put_ref(message);
+        }
+    }
+}
+
+void DecodeLane::Drain()
+{
+    {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        _stopping = true;
+    }
+    _wakeWorker.notify_one();
+
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+
+    ReleaseDelivered();
+}
+
+void DecodeLane::Run()
+{
+    // The graph stops once it sees the error. Whatever was queued before
+    // then is still delivered, just not from where it was asked for.
+    std::error_code placementError = ApplyThreadPlacement(_placement);
+    if (placementError)
+    {
+        _placementErrors.Set(placementError);
+    }
+
+    std::unique_lock<std::mutex> lock{ _mutex };
+
+    while (true)
+    {
+        _wakeWorker.wait(lock, [this]() { return !_pending.empty() || _stopping; });
+
+        // Anything queued before Drain() is still delivered
+        if (_pending.empty())
+        {
+            return;
+        }
+
+        QueuedBatch batch = std::move(_pending.front());
+        _pending.pop_front();
+
+        // At least as new as the generation batch was queued with, which is
+        // all the caches need
+        uint64_t streamGeneration = _streamGeneration;
+
+        lock.unlock();
+
+        _reader.SetStreamGeneration(streamGeneration);
+
+        if (_latencyRecorder)
+        {
+            _latencyRecorder->SetStreamGeneration(streamGeneration);
+        }
+
+        for (const bt_message* message : batch.Messages)
+        {
+            _reader.DecodeEvent(message, _eventBatch.EmplaceBack());
+
+            if (_latencyRecorder)
+            {
+                _latencyRecorder->Add(message);
+            }
+        }
+
+        if (_latencyRecorder)
+        {
+            _latencyRecorder->Commit();
+        }
+
+        uint64_t decodedBytes = _inFlight.ChargeDecoded(_eventBatch);
+        _outputFunc(_eventBatch);
+        _inFlight.Release(decodedBytes + batch.EstimatedBytes);
+
+        _eventBatch.Clear();
+
+        lock.lock();
+        _delivered.push_back(std::move(batch.Messages));
+    }
+}
+
+}
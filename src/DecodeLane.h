@@ -0,0 +1,100 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <lttng-consume/LttngConsumerOptions.h>
+#include <lttng-consume/LttngEventBatch.h>
+
+#include "InFlightMemory.h"
+#include "LatencyTracker.h"
+#include "LttngJsonReader.h"
+#include "ThreadPlacement.h"
+
+struct bt_message;
+
+namespace LttngConsume {
+
+// Decodes batches of event messages and invokes the output callback on a
+// dedicated thread.
+//
+// Babeltrace objects aren't thread safe, so the graph thread keeps doing
+// every ref count operation: it hands message references over with
+// Enqueue() and gets them back through ReleaseDelivered() once the worker
+// is done reading them. The worker itself only borrows.
+class DecodeLane
+{
+  public:
+    using MessageBatch = std::vector<const bt_message*>;
+
+    DecodeLane(
+        std::function<void(LttngEventBatch&)>& outputFunc,
+        size_t maxQueuedBatches,
+        StringInterner* interner,
+        LatencyTracker* latencyTracker,
+        InFlightMemory& inFlight,
+        const ThreadPlacementOptions& placement,
+        PlacementErrors& placementErrors);
+
+    ~DecodeLane();
+
+    DecodeLane(const DecodeLane&) = delete;
+    DecodeLane& operator=(const DecodeLane&) = delete;
+
+    // Graph thread only. Once true it stays true until the next Enqueue(),
+    // since the worker only ever shrinks the queue.
+    bool CanEnqueue();
+
+    // Graph thread only. Takes ownership of the references in batch, and
+    // charges inFlight an estimate of its events until they are delivered.
+    // streamGeneration changes whenever a stream has ended since the
+    // previous batch, so per-stream caches know to forget stale streams.
+    void Enqueue(MessageBatch&& batch, uint64_t streamGeneration);
+
+    // Graph thread only. Puts the references of delivered batches.
+    void ReleaseDelivered();
+
+    // Graph thread only. Delivers everything still queued, stops the worker
+    // and releases all references.
+    void Drain();
+
+  private:
+    struct QueuedBatch
+    {
+        MessageBatch Messages;
+        uint64_t EstimatedBytes = 0;
+    };
+
+    void Run();
+
+  private:
+    std::function<void(LttngEventBatch&)>& _outputFunc;
+    size_t _maxQueuedBatches;
+    LttngJsonReader _reader;
+    LttngEventBatch _eventBatch;
+    InFlightMemory& _inFlight;
+    ThreadPlacementOptions _placement;
+    PlacementErrors& _placementErrors;
+
+    // Set when delivery latency is tracked
+    std::unique_ptr<LatencyRecorder> _latencyRecorder;
+
+    std::mutex _mutex;
+    std::condition_variable _wakeWorker;
+    std::deque<QueuedBatch> _pending;
+    std::vector<MessageBatch> _delivered;
+    uint64_t _streamGeneration = 0;
+    bool _stopping = false;
+
+    std::thread _thread;
+};
+
+}
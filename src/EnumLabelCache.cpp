@@ -0,0 +1,156 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "EnumLabelCache.h"
+
+#include <babeltrace2/babeltrace.h>
+
+namespace LttngConsume {
+
+// bt_field_enumeration_*_get_mapping_labels() fills a scratch buffer owned by
+// the shared field class, so it can't be used while other threads decode
+// events of the same class. Scanning the mapping ranges only reads, and
+// yields the same first matching label.
+static const char*
+FindSignedEnumLabel(const bt_field_class* fieldClass, int64_t val)
+{
+    uint64_t mappingCount =
+        bt_field_class_enumeration_get_mapping_count(fieldClass);
+    for (uint64_t i = 0; i < mappingCount; i++)
+    {
+        const bt_field_class_enumeration_signed_mapping* mapping =
+            bt_field_class_enumeration_signed_borrow_mapping_by_index_const(
+                fieldClass, i);
+        const bt_integer_range_set_signed* ranges =
+            bt_field_class_enumeration_signed_mapping_borrow_ranges_const(
+                mapping);
+
+        uint64_t rangeCount = bt_integer_range_set_get_range_count(
+            bt_integer_range_set_signed_as_range_set_const(ranges));
+        for (uint64_t j = 0; j < rangeCount; j++)
+        {
+            const bt_integer_range_signed* range =
+                bt_integer_range_set_signed_borrow_range_by_index_const(
+                    ranges, j);
+            if (val >= bt_integer_range_signed_get_lower(range) &&
+                val <= bt_integer_range_signed_get_upper(range))
+            {
+                return bt_field_class_enumeration_mapping_get_label(
+                    bt_field_class_enumeration_signed_mapping_as_mapping_const(
+                        mapping));
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+static const char*
+FindUnsignedEnumLabel(const bt_field_class* fieldClass, uint64_t val)
+{
+    uint64_t mappingCount =
+        bt_field_class_enumeration_get_mapping_count(fieldClass);
+    for (uint64_t i = 0; i < mappingCount; i++)
+    {
+        const bt_field_class_enumeration_unsigned_mapping* mapping =
+            bt_field_class_enumeration_unsigned_borrow_mapping_by_index_const(
+                fieldClass, i);
+        const bt_integer_range_set_unsigned* ranges =
+            bt_field_class_enumeration_unsigned_mapping_borrow_ranges_const(
+                mapping);
+
+        uint64_t rangeCount = bt_integer_range_set_get_range_count(
+            bt_integer_range_set_unsigned_as_range_set_const(ranges));
+        for (uint64_t j = 0; j < rangeCount; j++)
+        {
+            const bt_integer_range_unsigned* range =
+                bt_integer_range_set_unsigned_borrow_range_by_index_const(
+                    ranges, j);
+            if (val >= bt_integer_range_unsigned_get_lower(range) &&
+                val <= bt_integer_range_unsigned_get_upper(range))
+            {
+                return bt_field_class_enumeration_mapping_get_label(
+                    bt_field_class_enumeration_unsigned_mapping_as_mapping_const(
+                        mapping));
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+void EnumLabelCache::SetStreamGeneration(uint64_t streamGeneration)
+{
+    if (streamGeneration != _streamGeneration)
+    {
+        _fieldClasses.clear();
+        _lastFieldClass = nullptr;
+        _lastLabels = nullptr;
+        _streamGeneration = streamGeneration;
+    }
+}
+
+std::string_view
+EnumLabelCache::GetSignedLabel(const bt_field_class* fieldClass, int64_t val)
+{
+    Labels& labels = GetLabels(fieldClass);
+
+    uint64_t key = static_cast<uint64_t>(val);
+    auto itr = labels.find(key);
+    if (itr != labels.end())
+    {
+        return itr->second;
+    }
+
+    const char* label = FindSignedEnumLabel(fieldClass, val);
+    return Store(labels, key, label, label ? "" : std::to_string(val));
+}
+
+std::string_view
+EnumLabelCache::GetUnsignedLabel(const bt_field_class* fieldClass, uint64_t val)
+{
+    Labels& labels = GetLabels(fieldClass);
+
+    auto itr = labels.find(val);
+    if (itr != labels.end())
+    {
+        return itr->second;
+    }
+
+    const char* label = FindUnsignedEnumLabel(fieldClass, val);
+    return Store(labels, val, label, label ? "" : std::to_string(val));
+}
+
+EnumLabelCache::Labels&
+EnumLabelCache::GetLabels(const bt_field_class* fieldClass)
+{
+    if (fieldClass != _lastFieldClass)
+    {
+        _lastLabels = &_fieldClasses[fieldClass];
+        _lastFieldClass = fieldClass;
+    }
+
+    return *_lastLabels;
+}
+
+std::string_view EnumLabelCache::Store(
+    Labels& labels,
+    uint64_t key,
+    const char* label,
+    std::string text)
+{
+    if (label)
+    {
+        text = label;
+    }
+
+    if (labels.size() >= c_maxLabelsPerClass)
+    {
+        _uncached = std::move(text);
+        return _uncached;
+    }
+
+    return labels.emplace(key, std::move(text)).first->second;
+}
+
+}
@@ -0,0 +1,58 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+struct bt_field_class;
+
+namespace LttngConsume {
+
+// Labels of enumeration values per field class, found by scanning the
+// mapping ranges the first time a value is seen and then looked up in a
+// small hash. Values no mapping holds are cached as their decimal text.
+// Not thread safe, so each decoding thread keeps its own.
+class EnumLabelCache
+{
+  public:
+    // Field classes are cached by address, which a new trace can reuse once
+    // an older one ends. Drops the cache when the generation moves on.
+    void SetStreamGeneration(uint64_t streamGeneration);
+
+    // Views stay valid until the next call
+    std::string_view
+    GetSignedLabel(const bt_field_class* fieldClass, int64_t val);
+    std::string_view
+    GetUnsignedLabel(const bt_field_class* fieldClass, uint64_t val);
+
+  private:
+    // Keyed by the value's bits, so signed and unsigned classes share it
+    using Labels = std::unordered_map<uint64_t, std::string>;
+
+    // Beyond this many values of one class, such as an enum used as a
+    // bitmask, labels are found and formatted again on every event
+    static constexpr size_t c_maxLabelsPerClass = 4096;
+
+    Labels& GetLabels(const bt_field_class* fieldClass);
+
+    std::string_view
+    Store(Labels& labels, uint64_t key, const char* label, std::string text);
+
+  private:
+    std::unordered_map<const bt_field_class*, Labels> _fieldClasses;
+
+    // Consecutive lookups are usually of the same field
+    const bt_field_class* _lastFieldClass = nullptr;
+    Labels* _lastLabels = nullptr;
+
+    uint64_t _streamGeneration = 0;
+
+    // Holds the result when a class's labels are full
+    std::string _uncached;
+};
+
+}
@@ -0,0 +1,262 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "EventAggregator.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <babeltrace2/babeltrace.h>
+#include <jsonbuilder/JsonBuilder.h>
+
+#include "ConsumerCounters.h"
+#include "FailureHelpers.h"
+#include "LttngJsonReader.h"
+
+using namespace jsonbuilder;
+
+namespace LttngConsume {
+
+static std::optional<double> ReadNumericField(const bt_field* field)
+{
+    switch (bt_field_get_class_type(field))
+    {
+    case BT_FIELD_CLASS_TYPE_BOOL:
+        return bt_field_bool_get_value(field) ? 1.0 : 0.0;
+    case BT_FIELD_CLASS_TYPE_UNSIGNED_INTEGER:
+    case BT_FIELD_CLASS_TYPE_UNSIGNED_ENUMERATION:
+        return static_cast<double>(bt_field_integer_unsigned_get_value(field));
+    case BT_FIELD_CLASS_TYPE_SIGNED_INTEGER:
+    case BT_FIELD_CLASS_TYPE_SIGNED_ENUMERATION:
+        return static_cast<double>(bt_field_integer_signed_get_value(field));
+    case BT_FIELD_CLASS_TYPE_SINGLE_PRECISION_REAL:
+        return bt_field_real_single_precision_get_value(field);
+    case BT_FIELD_CLASS_TYPE_DOUBLE_PRECISION_REAL:
+        return bt_field_real_double_precision_get_value(field);
+    default:
+        return std::nullopt;
+    }
+}
+
+EventAggregator::EventAggregator(
+    const AggregationOptions& options,
+    std::function<void(LttngEventBatch&)>& outputFunc,
+    ConsumerCounters& counters)
+    : _outputFunc(outputFunc)
+    , _counters(counters)
+    , _intervalNs(options.Interval.count())
+    , _idleFlushDelayNs(options.IdleFlushDelay.count())
+    , _histogramBounds(options.HistogramBounds)
+{
+    FAIL_FAST_IF(_intervalNs <= 0);
+
+    if (!options.ValueField.empty())
+    {
+        _valueField.emplace(FieldPath(options.ValueField));
+    }
+}
+
+void EventAggregator::Add(const bt_message* message)
+{
+    const bt_clock_snapshot* clock =
+        bt_message_event_borrow_default_clock_snapshot_const(message);
+
+    int64_t nanosFromEpoch = 0;
+    bt_clock_snapshot_get_ns_from_origin_status clockStatus =
+        bt_clock_snapshot_get_ns_from_origin(clock, &nanosFromEpoch);
+    FAIL_FAST_IF(clockStatus != BT_CLOCK_SNAPSHOT_GET_NS_FROM_ORIGIN_STATUS_OK);
+
+    // Round down, including before the epoch
+    int64_t windowStartNs = nanosFromEpoch - nanosFromEpoch % _intervalNs;
+    if (nanosFromEpoch % _intervalNs < 0)
+    {
+        windowStartNs -= _intervalNs;
+    }
+
+    // A window can't be reopened once emitted, nor go back in time while
+    // open, so a late event goes in the next window emitted
+    int64_t earliestStartNs = _windowOpen ? _windowStartNs : _emittedUntilNs;
+    if (windowStartNs < earliestStartNs)
+    {
+        _counters.EventsAggregatedLate.fetch_add(1, std::memory_order_relaxed);
+        windowStartNs = earliestStartNs;
+    }
+
+    if (!_windowOpen)
+    {
+        _windowOpen = true;
+        _windowStartNs = windowStartNs;
+    }
+    else if (windowStartNs > _windowStartNs)
+    {
+        Flush();
+        _windowOpen = true;
+        _windowStartNs = windowStartNs;
+    }
+
+    const bt_event* event = bt_message_event_borrow_event_const(message);
+    EventAccumulator& accumulator =
+        GetAccumulator(bt_event_borrow_class_const(event));
+
+    accumulator.Count++;
+
+    if (_valueField)
+    {
+        AddValue(accumulator, event);
+    }
+}
+
+void EventAggregator::AddValue(
+    EventAccumulator& accumulator,
+    const bt_event* event)
+{
+    const bt_field* field = _valueField->Borrow(event);
+    if (field == nullptr)
+    {
+        return;
+    }
+
+    std::optional<double> value = ReadNumericField(field);
+    if (!value)
+    {
+        return;
+    }
+
+    if (accumulator.ValueCount == 0)
+    {
+        accumulator.Min = *value;
+        accumulator.Max = *value;
+    }
+    else
+    {
+        accumulator.Min = std::min(accumulator.Min, *value);
+        accumulator.Max = std::max(accumulator.Max, *value);
+    }
+
+    accumulator.ValueCount++;
+    accumulator.Sum += *value;
+
+    if (!_histogramBounds.empty())
+    {
+        // Bucket i counts values up to and including bound i, and the last
+        // bucket counts everything above the final bound
+        auto boundItr = std::lower_bound(
+            _histogramBounds.begin(), _histogramBounds.end(), *value);
+        accumulator.Buckets[boundItr - _histogramBounds.begin()]++;
+    }
+}
+
+EventAggregator::EventAccumulator&
+EventAggregator::GetAccumulator(const bt_event_class* eventClass)
+{
+    auto itr = _classes.find(eventClass);
+    if (itr != _classes.end())
+    {
+        return *itr->second.Accumulator;
+    }
+
+    ClassEntry entry;
+
+    bt_event_class_get_ref(eventClass);
+    entry.EventClass = eventClass;
+
+    auto [accumulatorItr, inserted] =
+        _accumulators.try_emplace(GetEventName(eventClass));
+    if (inserted)
+    {
+        accumulatorItr->second.Buckets.resize(
+            _histogramBounds.empty() ? 0 : _histogramBounds.size() + 1);
+    }
+    entry.Accumulator = &accumulatorItr->second;
+
+    return *_classes.emplace(eventClass, std::move(entry))
+                .first->second.Accumulator;
+}
+
+void EventAggregator::FlushIfIdle()
+{
+    if (!_windowOpen || _idleFlushDelayNs <= 0)
+    {
+        return;
+    }
+
+    int64_t nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::system_clock::now().time_since_epoch())
+                        .count();
+    if (nowNs - _idleFlushDelayNs >= _windowStartNs + _intervalNs)
+    {
+        Flush();
+    }
+}
+
+void EventAggregator::Flush()
+{
+    if (!_windowOpen)
+    {
+        return;
+    }
+    _windowOpen = false;
+    _emittedUntilNs = _windowStartNs + _intervalNs;
+
+    JsonBuilder& builder = _summaryBatch.EmplaceBack();
+
+    builder.push_back(builder.root(), "name", "lttng-consume.aggregate");
+
+    std::chrono::system_clock::time_point windowStart{ std::chrono::nanoseconds{
+        _windowStartNs } };
+    builder.push_back(builder.root(), "time", windowStart);
+
+    auto metadataItr = builder.push_back(builder.root(), "metadata", JsonObject);
+    builder.push_back(metadataItr, "intervalNs", _intervalNs);
+
+    if (!_histogramBounds.empty())
+    {
+        auto boundsItr =
+            builder.push_back(metadataItr, "histogramBounds", JsonArray);
+        for (double bound : _histogramBounds)
+        {
+            builder.push_back(boundsItr, {}, bound);
+        }
+    }
+
+    auto dataItr = builder.push_back(builder.root(), "data", JsonObject);
+
+    for (auto& [name, accumulator] : _accumulators)
+    {
+        if (accumulator.Count == 0)
+        {
+            continue;
+        }
+
+        auto classItr = builder.push_back(dataItr, name, JsonObject);
+        builder.push_back(classItr, "count", accumulator.Count);
+
+        if (accumulator.ValueCount > 0)
+        {
+            builder.push_back(classItr, "valueCount", accumulator.ValueCount);
+            builder.push_back(classItr, "sum", accumulator.Sum);
+            builder.push_back(classItr, "min", accumulator.Min);
+            builder.push_back(classItr, "max", accumulator.Max);
+
+            if (!accumulator.Buckets.empty())
+            {
+                auto histogramItr =
+                    builder.push_back(classItr, "histogram", JsonArray);
+                for (uint64_t& bucket : accumulator.Buckets)
+                {
+                    builder.push_back(histogramItr, {}, bucket);
+                    bucket = 0;
+                }
+            }
+        }
+
+        accumulator.Count = 0;
+        accumulator.ValueCount = 0;
+        accumulator.Sum = 0;
+    }
+
+    _outputFunc(_summaryBatch);
+    _summaryBatch.Clear();
+}
+
+}
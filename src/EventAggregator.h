@@ -0,0 +1,94 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <lttng-consume/LttngConsumerOptions.h>
+#include <lttng-consume/LttngEventBatch.h>
+
+#include "BabelPtr.h"
+#include "FieldPath.h"
+
+namespace LttngConsume {
+
+struct ConsumerCounters;
+
+// Counts events per class, and optionally sums and buckets one numeric
+// field, over fixed windows of event time. Reads straight from the
+// babeltrace fields and emits one summary JsonBuilder per window instead of
+// decoding every event. Graph thread only.
+class EventAggregator
+{
+  public:
+    EventAggregator(
+        const AggregationOptions& options,
+        std::function<void(LttngEventBatch&)>& outputFunc,
+        ConsumerCounters& counters);
+
+    // Emits the open window before adding an event from a later one. Events
+    // older than the open window, or than one already emitted, are counted
+    // as late in the next window emitted.
+    void Add(const bt_message* message);
+
+    // Emits the open window, if it has any events
+    void Flush();
+
+    // Emits the open window once the wall clock is IdleFlushDelay past its
+    // end, for when no later event comes along to close it
+    void FlushIfIdle();
+
+  private:
+    struct EventAccumulator
+    {
+        uint64_t Count = 0;
+        uint64_t ValueCount = 0;
+        double Sum = 0;
+        double Min = 0;
+        double Max = 0;
+        std::vector<uint64_t> Buckets;
+    };
+
+    struct ClassEntry
+    {
+        BabelPtr<const bt_event_class> EventClass;
+        EventAccumulator* Accumulator = nullptr;
+    };
+
+    EventAccumulator& GetAccumulator(const bt_event_class* eventClass);
+
+    void AddValue(EventAccumulator& accumulator, const bt_event* event);
+
+  private:
+    std::function<void(LttngEventBatch&)>& _outputFunc;
+    ConsumerCounters& _counters;
+    int64_t _intervalNs;
+    int64_t _idleFlushDelayNs;
+    std::optional<FieldPathCache> _valueField;
+    std::vector<double> _histogramBounds;
+
+    // By event name, so the classes of one event in several traces, e.g.
+    // lttng's per-PID buffers, are summed into one entry
+    std::unordered_map<std::string, EventAccumulator> _accumulators;
+
+    // Kept across windows so names are only formatted once per class
+    std::unordered_map<const bt_event_class*, ClassEntry> _classes;
+
+    // Holds the one summary delivered per window
+    LttngEventBatch _summaryBatch;
+
+    bool _windowOpen = false;
+    int64_t _windowStartNs = 0;
+
+    // End of the last window emitted
+    int64_t _emittedUntilNs = std::numeric_limits<int64_t>::min();
+};
+
+}
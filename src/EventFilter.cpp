@@ -0,0 +1,615 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "EventFilter.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <stdexcept>
+
+#include <babeltrace2/babeltrace.h>
+
+#include "FailureHelpers.h"
+
+namespace LttngConsume {
+
+// Recursive descent over
+//
+//     or         := and ("||" and)*
+//     and        := unary ("&&" unary)*
+//     unary      := "!" unary | "(" or ")" | comparison
+//     comparison := path ("==" | "!=" | "<" | "<=" | ">" | ">=") literal
+//                 | path "in" "{" literal ("," literal)* "}"
+//     literal    := integer | real | "string" | true | false
+class EventFilter::Parser
+{
+  public:
+    explicit Parser(std::string_view text) : _text(text) {}
+
+    std::unique_ptr<Node> Parse()
+    {
+        std::unique_ptr<Node> root = ParseOr();
+
+        SkipSpace();
+        if (_pos != _text.size())
+        {
+            Fail("unexpected text");
+        }
+
+        return root;
+    }
+
+  private:
+    static bool IsPathChar(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+               (c >= '0' && c <= '9') || c == '_' || c == '.';
+    }
+
+    [[noreturn]] void Fail(const std::string& message)
+    {
+        throw std::invalid_argument(
+            "Filter: " + message + " at offset " + std::to_string(_pos) +
+            " in \"" + std::string{ _text } + "\"");
+    }
+
+    void SkipSpace()
+    {
+        while (_pos < _text.size() &&
+               (_text[_pos] == ' ' || _text[_pos] == '\t' ||
+                _text[_pos] == '\n' || _text[_pos] == '\r'))
+        {
+            _pos++;
+        }
+    }
+
+    bool Accept(std::string_view token)
+    {
+        SkipSpace();
+        if (_text.substr(_pos, token.size()) != token)
+        {
+            return false;
+        }
+
+        // Keywords must not just be the start of a longer name
+        bool keyword = IsPathChar(token.back());
+        if (keyword && _pos + token.size() < _text.size() &&
+            IsPathChar(_text[_pos + token.size()]))
+        {
+            return false;
+        }
+
+        _pos += token.size();
+        return true;
+    }
+
+    void Expect(std::string_view token)
+    {
+        if (!Accept(token))
+        {
+            Fail("expected '" + std::string{ token } + "'");
+        }
+    }
+
+    std::unique_ptr<Node> MakeBinary(
+        NodeType type,
+        std::unique_ptr<Node> left,
+        std::unique_ptr<Node> right)
+    {
+        auto node = std::make_unique<Node>();
+        node->Type = type;
+        node->Left = std::move(left);
+        node->Right = std::move(right);
+        return node;
+    }
+
+    std::unique_ptr<Node> ParseOr()
+    {
+        std::unique_ptr<Node> left = ParseAnd();
+        while (Accept("||"))
+        {
+            left = MakeBinary(NodeType::Or, std::move(left), ParseAnd());
+        }
+
+        return left;
+    }
+
+    std::unique_ptr<Node> ParseAnd()
+    {
+        std::unique_ptr<Node> left = ParseUnary();
+        while (Accept("&&"))
+        {
+            left = MakeBinary(NodeType::And, std::move(left), ParseUnary());
+        }
+
+        return left;
+    }
+
+    std::unique_ptr<Node> ParseUnary()
+    {
+        if (Accept("!"))
+        {
+            auto node = std::make_unique<Node>();
+            node->Type = NodeType::Not;
+            node->Left = ParseUnary();
+            return node;
+        }
+
+        if (Accept("("))
+        {
+            std::unique_ptr<Node> node = ParseOr();
+            Expect(")");
+            return node;
+        }
+
+        return ParseComparison();
+    }
+
+    std::unique_ptr<Node> ParseComparison()
+    {
+        SkipSpace();
+
+        size_t start = _pos;
+        while (_pos < _text.size() && IsPathChar(_text[_pos]))
+        {
+            _pos++;
+        }
+
+        if (_pos == start)
+        {
+            Fail("expected a field path");
+        }
+
+        auto node = std::make_unique<Node>();
+        node->Type = NodeType::Compare;
+
+        try
+        {
+            node->Path.emplace(_text.substr(start, _pos - start));
+        }
+        catch (const std::invalid_argument& e)
+        {
+            _pos = start;
+            Fail(e.what());
+        }
+
+        // Two character operators first, so "<=" isn't read as "<"
+        static constexpr std::pair<std::string_view, Op> c_ops[] = {
+            { "==", Op::Equal },      { "!=", Op::NotEqual },
+            { "<=", Op::LessEqual },  { ">=", Op::GreaterEqual },
+            { "<", Op::Less },        { ">", Op::Greater },
+        };
+
+        for (const auto& [token, op] : c_ops)
+        {
+            if (Accept(token))
+            {
+                node->CompareOp = op;
+                node->Literals.push_back(ParseLiteral());
+                return node;
+            }
+        }
+
+        if (!Accept("in"))
+        {
+            Fail("expected a comparison operator or 'in'");
+        }
+
+        node->CompareOp = Op::In;
+
+        Expect("{");
+        do
+        {
+            node->Literals.push_back(ParseLiteral());
+        } while (Accept(","));
+        Expect("}");
+
+        return node;
+    }
+
+    Literal ParseLiteral()
+    {
+        Literal literal;
+
+        // Booleans compare as the integers babeltrace reads them as
+        if (Accept("true"))
+        {
+            literal.Integer = 1;
+            return literal;
+        }
+
+        if (Accept("false"))
+        {
+            return literal;
+        }
+
+        SkipSpace();
+        if (_pos < _text.size() && _text[_pos] == '"')
+        {
+            literal.LiteralType = Literal::Type::String;
+
+            _pos++;
+            while (_pos < _text.size() && _text[_pos] != '"')
+            {
+                if (_text[_pos] == '\\' && _pos + 1 < _text.size())
+                {
+                    _pos++;
+                }
+
+                literal.String.push_back(_text[_pos++]);
+            }
+
+            Expect("\"");
+            return literal;
+        }
+
+        size_t start = _pos;
+        while (_pos < _text.size() &&
+               (IsPathChar(_text[_pos]) || _text[_pos] == '-' ||
+                _text[_pos] == '+'))
+        {
+            _pos++;
+        }
+
+        std::string token{ _text.substr(start, _pos - start) };
+        if (token.empty())
+        {
+            Fail("expected a literal");
+        }
+
+        // Integers unless they only parse as reals, which includes integers
+        // too large for 64 bits. Decimal even with leading zeros, or hex
+        // after 0x.
+        std::string_view digits = token;
+        if (digits[0] == '-' || digits[0] == '+')
+        {
+            digits.remove_prefix(1);
+        }
+        bool hex = digits.size() > 2 && digits[0] == '0' &&
+                   (digits[1] == 'x' || digits[1] == 'X');
+
+        char* end = nullptr;
+        errno = 0;
+        literal.Integer = std::strtoll(token.c_str(), &end, hex ? 16 : 10);
+        if (*end == '\0' && errno == 0)
+        {
+            return literal;
+        }
+
+        literal.LiteralType = Literal::Type::Real;
+        literal.Real = std::strtod(token.c_str(), &end);
+        if (*end != '\0')
+        {
+            _pos = start;
+            Fail("malformed number");
+        }
+
+        return literal;
+    }
+
+  private:
+    std::string_view _text;
+    size_t _pos = 0;
+};
+
+EventFilter::EventFilter(std::string_view expression)
+    : _root(Parser(expression).Parse())
+{}
+
+EventFilter::~EventFilter() = default;
+
+bool EventFilter::Matches(const bt_message* message)
+{
+    const bt_event* event = bt_message_event_borrow_event_const(message);
+    const bt_event_class* eventClass = bt_event_borrow_class_const(event);
+
+    if (eventClass != _lastEventClass)
+    {
+        _lastProgram = &GetClassProgram(eventClass);
+        _lastEventClass = eventClass;
+    }
+
+    return Evaluate(_lastProgram->Nodes, _lastProgram->Root, event);
+}
+
+EventFilter::ClassProgram&
+EventFilter::GetClassProgram(const bt_event_class* eventClass)
+{
+    auto itr = _programs.find(eventClass);
+    if (itr != _programs.end())
+    {
+        return itr->second;
+    }
+
+    ClassProgram program;
+    bt_event_class_get_ref(eventClass);
+    program.EventClass = eventClass;
+    program.Root = Compile(*_root, eventClass, program.Nodes);
+
+    return _programs.emplace(eventClass, std::move(program)).first->second;
+}
+
+uint32_t EventFilter::Compile(
+    const Node& node,
+    const bt_event_class* eventClass,
+    std::vector<CompiledNode>& nodes)
+{
+    CompiledNode compiled;
+    compiled.Type = node.Type;
+
+    switch (node.Type)
+    {
+    case NodeType::Constant:
+        compiled.Value = node.Value;
+        break;
+    case NodeType::Not:
+    {
+        uint32_t operand = Compile(*node.Left, eventClass, nodes);
+        if (nodes[operand].Type == NodeType::Constant)
+        {
+            nodes[operand].Value = !nodes[operand].Value;
+            return operand;
+        }
+
+        compiled.Left = operand;
+        break;
+    }
+    case NodeType::And:
+    case NodeType::Or:
+    {
+        // A constant operand either decides the result or drops out.
+        // Folded nodes stay in the vector, unreferenced.
+        bool isAnd = node.Type == NodeType::And;
+
+        uint32_t left = Compile(*node.Left, eventClass, nodes);
+        if (nodes[left].Type == NodeType::Constant)
+        {
+            return nodes[left].Value == isAnd ?
+                       Compile(*node.Right, eventClass, nodes) :
+                       left;
+        }
+
+        uint32_t right = Compile(*node.Right, eventClass, nodes);
+        if (nodes[right].Type == NodeType::Constant)
+        {
+            return nodes[right].Value == isAnd ? left : right;
+        }
+
+        compiled.Left = left;
+        compiled.Right = right;
+        break;
+    }
+    case NodeType::Compare:
+        CompileComparison(node, eventClass, compiled);
+        break;
+    }
+
+    nodes.push_back(std::move(compiled));
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void EventFilter::CompileComparison(
+    const Node& node,
+    const bt_event_class* eventClass,
+    CompiledNode& compiled)
+{
+    // Anything that can't be compared for this class is false
+    compiled.Type = NodeType::Constant;
+    compiled.Value = false;
+
+    std::optional<ResolvedFieldPath> resolved =
+        ResolvedFieldPath::Resolve(*node.Path, eventClass);
+    std::optional<FieldReader> reader =
+        resolved ? GetFieldReader(resolved->FieldClass()) : std::nullopt;
+    if (!reader)
+    {
+        return;
+    }
+
+    bool hasString = false;
+    bool hasReal = false;
+    bool hasNegative = false;
+    for (const Literal& literal : node.Literals)
+    {
+        hasString |= literal.LiteralType == Literal::Type::String;
+        hasReal |= literal.LiteralType == Literal::Type::Real;
+        hasNegative |= literal.LiteralType == Literal::Type::Integer &&
+                       literal.Integer < 0;
+    }
+
+    bool isString = *reader == FieldReader::String;
+    if (hasString != isString ||
+        (isString && node.Literals.size() > 1 && node.CompareOp != Op::In))
+    {
+        return;
+    }
+
+    if (isString)
+    {
+        compiled.FieldDomain = Domain::String;
+    }
+    else if (
+        hasReal || *reader == FieldReader::SingleReal ||
+        *reader == FieldReader::DoubleReal)
+    {
+        compiled.FieldDomain = Domain::Real;
+    }
+    else if (*reader == FieldReader::Unsigned)
+    {
+        compiled.FieldDomain = Domain::Unsigned;
+
+        // An unsigned field is above any negative literal
+        if (hasNegative && node.CompareOp != Op::In)
+        {
+            Op op = node.CompareOp;
+            compiled.Value = op == Op::NotEqual || op == Op::Greater ||
+                             op == Op::GreaterEqual;
+            return;
+        }
+    }
+    else
+    {
+        compiled.FieldDomain = Domain::Signed;
+    }
+
+    for (const Literal& literal : node.Literals)
+    {
+        CompiledLiteral converted;
+        switch (compiled.FieldDomain)
+        {
+        case Domain::Signed:
+            converted.Signed = literal.Integer;
+            break;
+        case Domain::Unsigned:
+            if (literal.Integer < 0)
+            {
+                continue;
+            }
+
+            converted.Unsigned = static_cast<uint64_t>(literal.Integer);
+            break;
+        case Domain::Real:
+            converted.Real = literal.LiteralType == Literal::Type::Real ?
+                                 literal.Real :
+                                 static_cast<double>(literal.Integer);
+            break;
+        case Domain::String:
+            converted.String = literal.String;
+            break;
+        }
+
+        compiled.Literals.push_back(converted);
+    }
+
+    // Only In can be left without literals, when all were negative
+    if (compiled.Literals.empty())
+    {
+        return;
+    }
+
+    compiled.Type = NodeType::Compare;
+    compiled.CompareOp = node.CompareOp;
+    compiled.Path = std::move(resolved);
+    compiled.Reader = *reader;
+}
+
+bool EventFilter::Evaluate(
+    const std::vector<CompiledNode>& nodes,
+    uint32_t index,
+    const bt_event* event)
+{
+    const CompiledNode& node = nodes[index];
+    switch (node.Type)
+    {
+    case NodeType::And:
+        return Evaluate(nodes, node.Left, event) &&
+               Evaluate(nodes, node.Right, event);
+    case NodeType::Or:
+        return Evaluate(nodes, node.Left, event) ||
+               Evaluate(nodes, node.Right, event);
+    case NodeType::Not:
+        return !Evaluate(nodes, node.Left, event);
+    case NodeType::Compare:
+        return EvaluateComparison(node, event);
+    case NodeType::Constant:
+        return node.Value;
+    }
+
+    FAIL_FAST_IF(true);
+    return false;
+}
+
+bool EventFilter::EvaluateComparison(
+    const CompiledNode& node,
+    const bt_event* event)
+{
+    auto compare = [&node](auto value, auto member) {
+        if (node.CompareOp == Op::In)
+        {
+            for (const CompiledLiteral& literal : node.Literals)
+            {
+                if (value == literal.*member)
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        const auto& literal = node.Literals.front().*member;
+        switch (node.CompareOp)
+        {
+        case Op::Equal:
+            return value == literal;
+        case Op::NotEqual:
+            return value != literal;
+        case Op::Less:
+            return value < literal;
+        case Op::LessEqual:
+            return value <= literal;
+        case Op::Greater:
+            return value > literal;
+        case Op::GreaterEqual:
+            return value >= literal;
+        case Op::In:
+            break;
+        }
+
+        return false;
+    };
+
+    const bt_field* field = node.Path->Borrow(event);
+
+    switch (node.FieldDomain)
+    {
+    case Domain::Signed:
+        return compare(
+            node.Reader == FieldReader::Bool ?
+                static_cast<int64_t>(bt_field_bool_get_value(field)) :
+                bt_field_integer_signed_get_value(field),
+            &CompiledLiteral::Signed);
+    case Domain::Unsigned:
+        return compare(
+            bt_field_integer_unsigned_get_value(field),
+            &CompiledLiteral::Unsigned);
+    case Domain::Real:
+    {
+        double value = 0;
+        switch (node.Reader)
+        {
+        case FieldReader::Bool:
+            value = bt_field_bool_get_value(field);
+            break;
+        case FieldReader::Unsigned:
+            value = static_cast<double>(
+                bt_field_integer_unsigned_get_value(field));
+            break;
+        case FieldReader::Signed:
+            value =
+                static_cast<double>(bt_field_integer_signed_get_value(field));
+            break;
+        case FieldReader::SingleReal:
+            value = bt_field_real_single_precision_get_value(field);
+            break;
+        case FieldReader::DoubleReal:
+            value = bt_field_real_double_precision_get_value(field);
+            break;
+        case FieldReader::String:
+            FAIL_FAST_IF(true);
+        }
+
+        return compare(value, &CompiledLiteral::Real);
+    }
+    case Domain::String:
+        return compare(
+            std::string_view{ bt_field_string_get_value(field),
+                              bt_field_string_get_length(field) },
+            &CompiledLiteral::String);
+    }
+
+    FAIL_FAST_IF(true);
+    return false;
+}
+
+}
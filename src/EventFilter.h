@@ -0,0 +1,161 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "BabelPtr.h"
+#include "FieldPath.h"
+
+namespace LttngConsume {
+
+// Predicate on field values, e.g.
+//
+//     data.status != 0 && streamEventContext.vpid in { 12, 34 }
+//
+// parsed once and compiled per event class: paths are resolved to member
+// indexes, literals converted to the type of their field and comparisons
+// that can't hold for the class folded away. Events are then checked on
+// their raw babeltrace fields before anything is decoded. Graph thread
+// only, since it holds references on the event classes it has seen.
+class EventFilter
+{
+  public:
+    // Throws std::invalid_argument, with the offset of the problem, if the
+    // expression is malformed
+    explicit EventFilter(std::string_view expression);
+
+    ~EventFilter();
+
+    bool Matches(const bt_message* message);
+
+  private:
+    enum class NodeType
+    {
+        And,
+        Or,
+        Not,
+        Compare,
+        Constant
+    };
+
+    enum class Op
+    {
+        Equal,
+        NotEqual,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        In
+    };
+
+    struct Literal
+    {
+        enum class Type
+        {
+            Integer,
+            Real,
+            String
+        };
+
+        Type LiteralType = Type::Integer;
+        int64_t Integer = 0;
+        double Real = 0;
+        std::string String;
+    };
+
+    // Parsed form, shared by every event class
+    struct Node
+    {
+        NodeType Type = NodeType::Constant;
+        std::unique_ptr<Node> Left;
+        std::unique_ptr<Node> Right;
+
+        // Compare only. In takes any number of literals, the others one.
+        Op CompareOp = Op::Equal;
+        std::optional<FieldPath> Path;
+        std::vector<Literal> Literals;
+
+        bool Value = false;
+    };
+
+    // Type a compiled comparison runs in, from its field and literals
+    enum class Domain
+    {
+        Signed,
+        Unsigned,
+        Real,
+        String
+    };
+
+    struct CompiledLiteral
+    {
+        int64_t Signed = 0;
+        uint64_t Unsigned = 0;
+        double Real = 0;
+        std::string_view String;
+    };
+
+    struct CompiledNode
+    {
+        NodeType Type = NodeType::Constant;
+        uint32_t Left = 0;
+        uint32_t Right = 0;
+
+        Op CompareOp = Op::Equal;
+        Domain FieldDomain = Domain::Signed;
+        std::optional<ResolvedFieldPath> Path;
+        FieldReader Reader = FieldReader::Signed;
+        std::vector<CompiledLiteral> Literals;
+
+        bool Value = false;
+    };
+
+    struct ClassProgram
+    {
+        BabelPtr<const bt_event_class> EventClass;
+        std::vector<CompiledNode> Nodes;
+        uint32_t Root = 0;
+    };
+
+    class Parser;
+
+    ClassProgram& GetClassProgram(const bt_event_class* eventClass);
+
+    // Appends node, folded for the class, and returns its index
+    uint32_t Compile(
+        const Node& node,
+        const bt_event_class* eventClass,
+        std::vector<CompiledNode>& nodes);
+
+    void CompileComparison(
+        const Node& node,
+        const bt_event_class* eventClass,
+        CompiledNode& compiled);
+
+    bool Evaluate(
+        const std::vector<CompiledNode>& nodes,
+        uint32_t index,
+        const bt_event* event);
+
+    bool EvaluateComparison(const CompiledNode& node, const bt_event* event);
+
+  private:
+    std::unique_ptr<Node> _root;
+
+    std::unordered_map<const bt_event_class*, ClassProgram> _programs;
+
+    // Consecutive events are usually of the same class
+    const bt_event_class* _lastEventClass = nullptr;
+    ClassProgram* _lastProgram = nullptr;
+};
+
+}
@@ -0,0 +1,141 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "EventRateLimiter.h"
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+#include <babeltrace2/babeltrace.h>
+
+#include "FailureHelpers.h"
+#include "LttngJsonReader.h"
+
+namespace LttngConsume {
+
+static bool MatchesEventName(std::string_view pattern, std::string_view name)
+{
+    if (!pattern.empty() && pattern.back() == '*')
+    {
+        pattern.remove_suffix(1);
+        return name.substr(0, pattern.size()) == pattern;
+    }
+
+    return name == pattern;
+}
+
+EventRateLimiter::EventRateLimiter(
+    const std::vector<EventRateLimit>& limits,
+    ConsumerCounters& counters)
+    : _limits(limits), _counters(counters)
+{}
+
+bool EventRateLimiter::Admit(const bt_message* message)
+{
+    const bt_event_class* eventClass = bt_event_borrow_class_const(
+        bt_message_event_borrow_event_const(message));
+
+    if (eventClass != _lastEventClass)
+    {
+        _lastNameState = &GetNameState(eventClass);
+        _lastEventClass = eventClass;
+    }
+
+    NameState& state = *_lastNameState;
+    if (state.Limit == nullptr)
+    {
+        return true;
+    }
+
+    if (state.Limit->SampleRatio < 1.0)
+    {
+        state.SampleCredit += state.Limit->SampleRatio;
+        if (state.SampleCredit < 1.0)
+        {
+            _counters.EventsSampledOut.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        state.SampleCredit -= 1.0;
+    }
+
+    if (state.Limit->EventsPerSecond > 0 && !TakeToken(state, message))
+    {
+        _counters.EventsRateLimited.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    return true;
+}
+
+bool EventRateLimiter::TakeToken(NameState& state, const bt_message* message)
+{
+    // Refill by event time rather than wall time, so a backlog that is
+    // caught up on quickly is limited the same way it was produced
+    const bt_clock_snapshot* clock =
+        bt_message_event_borrow_default_clock_snapshot_const(message);
+
+    int64_t nanosFromEpoch = 0;
+    bt_clock_snapshot_get_ns_from_origin_status clockStatus =
+        bt_clock_snapshot_get_ns_from_origin(clock, &nanosFromEpoch);
+    FAIL_FAST_IF(clockStatus != BT_CLOCK_SNAPSHOT_GET_NS_FROM_ORIGIN_STATUS_OK);
+
+    double burst = std::max<double>(state.Limit->Burst, 1);
+
+    if (!state.Refilled)
+    {
+        state.Refilled = true;
+        state.Tokens = burst;
+    }
+    else if (nanosFromEpoch > state.LastRefillNs)
+    {
+        double elapsedSeconds = (nanosFromEpoch - state.LastRefillNs) / 1e9;
+        state.Tokens = std::min(
+            burst, state.Tokens + elapsedSeconds * state.Limit->EventsPerSecond);
+    }
+
+    state.LastRefillNs = std::max(state.LastRefillNs, nanosFromEpoch);
+
+    if (state.Tokens < 1.0)
+    {
+        return false;
+    }
+
+    state.Tokens -= 1.0;
+    return true;
+}
+
+EventRateLimiter::NameState&
+EventRateLimiter::GetNameState(const bt_event_class* eventClass)
+{
+    auto itr = _classes.find(eventClass);
+    if (itr != _classes.end())
+    {
+        return *itr->second.State;
+    }
+
+    ClassEntry entry;
+
+    bt_event_class_get_ref(eventClass);
+    entry.EventClass = eventClass;
+
+    auto [stateItr, inserted] =
+        _nameStates.try_emplace(GetEventName(eventClass));
+    if (inserted)
+    {
+        for (const EventRateLimit& limit : _limits)
+        {
+            if (MatchesEventName(limit.EventName, stateItr->first))
+            {
+                stateItr->second.Limit = &limit;
+                break;
+            }
+        }
+    }
+    entry.State = &stateItr->second;
+
+    return *_classes.emplace(eventClass, std::move(entry)).first->second.State;
+}
+
+}
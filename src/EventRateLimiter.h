@@ -0,0 +1,71 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <lttng-consume/LttngConsumerOptions.h>
+
+#include "BabelPtr.h"
+#include "ConsumerCounters.h"
+
+namespace LttngConsume {
+
+// Applies the configured EventRateLimits to event messages before they are
+// decoded. Limits are matched once per event class, so admitting or
+// rejecting an event is a lookup and a little arithmetic. Each event name
+// is limited once, however many traces define its class, e.g. lttng's
+// per-PID buffers. Graph thread only.
+class EventRateLimiter
+{
+  public:
+    EventRateLimiter(
+        const std::vector<EventRateLimit>& limits,
+        ConsumerCounters& counters);
+
+    // Returns false, and counts the event, if it should be dropped
+    bool Admit(const bt_message* message);
+
+  private:
+    struct NameState
+    {
+        // Null when no limit applies to the name
+        const EventRateLimit* Limit = nullptr;
+
+        // Events are kept each time the credit reaches one
+        double SampleCredit = 0;
+
+        double Tokens = 0;
+        int64_t LastRefillNs = 0;
+        bool Refilled = false;
+    };
+
+    struct ClassEntry
+    {
+        BabelPtr<const bt_event_class> EventClass;
+        NameState* State = nullptr;
+    };
+
+    NameState& GetNameState(const bt_event_class* eventClass);
+
+    bool TakeToken(NameState& state, const bt_message* message);
+
+  private:
+    std::vector<EventRateLimit> _limits;
+    ConsumerCounters& _counters;
+
+    std::unordered_map<std::string, NameState> _nameStates;
+
+    // So names are only formatted once per class
+    std::unordered_map<const bt_event_class*, ClassEntry> _classes;
+
+    // Consecutive events are usually of the same class
+    const bt_event_class* _lastEventClass = nullptr;
+    NameState* _lastNameState = nullptr;
+};
+
+}
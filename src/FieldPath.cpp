@@ -0,0 +1,213 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "FieldPath.h"
+
+#include <stdexcept>
+
+#include <babeltrace2/babeltrace.h>
+
+#include "FailureHelpers.h"
+
+namespace LttngConsume {
+
+FieldPath::FieldPath(std::string_view path) : _path(path)
+{
+    size_t dotPos = path.find('.');
+    std::string_view scopeName = path.substr(0, dotPos);
+
+    if (scopeName == "packetContext")
+    {
+        _scope = Scope::PacketContext;
+    }
+    else if (scopeName == "streamEventContext")
+    {
+        _scope = Scope::StreamEventContext;
+    }
+    else if (scopeName == "eventContext")
+    {
+        _scope = Scope::EventContext;
+    }
+    else if (scopeName == "data")
+    {
+        _scope = Scope::Payload;
+    }
+    else
+    {
+        throw std::invalid_argument("Unknown field scope in " + _path);
+    }
+
+    while (dotPos != std::string_view::npos)
+    {
+        size_t nameStart = dotPos + 1;
+        dotPos = path.find('.', nameStart);
+
+        std::string_view memberName =
+            path.substr(nameStart, dotPos - nameStart);
+        if (memberName.empty())
+        {
+            throw std::invalid_argument("Empty member name in " + _path);
+        }
+
+        _memberNames.emplace_back(memberName);
+    }
+
+    if (_memberNames.empty())
+    {
+        throw std::invalid_argument("No member name in " + _path);
+    }
+}
+
+static const bt_field_class*
+BorrowScopeFieldClass(FieldPath::Scope scope, const bt_event_class* eventClass)
+{
+    const bt_stream_class* streamClass =
+        bt_event_class_borrow_stream_class_const(eventClass);
+
+    switch (scope)
+    {
+    case FieldPath::Scope::PacketContext:
+        return bt_stream_class_borrow_packet_context_field_class_const(
+            streamClass);
+    case FieldPath::Scope::StreamEventContext:
+        return bt_stream_class_borrow_event_common_context_field_class_const(
+            streamClass);
+    case FieldPath::Scope::EventContext:
+        return bt_event_class_borrow_specific_context_field_class_const(
+            eventClass);
+    case FieldPath::Scope::Payload:
+        return bt_event_class_borrow_payload_field_class_const(eventClass);
+    }
+
+    return nullptr;
+}
+
+static const bt_field*
+BorrowScopeField(FieldPath::Scope scope, const bt_event* event)
+{
+    switch (scope)
+    {
+    case FieldPath::Scope::PacketContext:
+        return bt_packet_borrow_context_field_const(
+            bt_event_borrow_packet_const(event));
+    case FieldPath::Scope::StreamEventContext:
+        return bt_event_borrow_common_context_field_const(event);
+    case FieldPath::Scope::EventContext:
+        return bt_event_borrow_specific_context_field_const(event);
+    case FieldPath::Scope::Payload:
+        return bt_event_borrow_payload_field_const(event);
+    }
+
+    return nullptr;
+}
+
+std::optional<ResolvedFieldPath> ResolvedFieldPath::Resolve(
+    const FieldPath& path,
+    const bt_event_class* eventClass)
+{
+    ResolvedFieldPath resolved;
+    resolved._scope = path.GetScope();
+
+    const bt_field_class* fieldClass =
+        BorrowScopeFieldClass(path.GetScope(), eventClass);
+
+    for (const std::string& memberName : path.MemberNames())
+    {
+        if (!fieldClass || bt_field_class_get_type(fieldClass) !=
+                               BT_FIELD_CLASS_TYPE_STRUCTURE)
+        {
+            return std::nullopt;
+        }
+
+        uint64_t memberCount =
+            bt_field_class_structure_get_member_count(fieldClass);
+        uint64_t memberIndex = 0;
+        for (; memberIndex < memberCount; memberIndex++)
+        {
+            const bt_field_class_structure_member* member =
+                bt_field_class_structure_borrow_member_by_index_const(
+                    fieldClass, memberIndex);
+            if (memberName == bt_field_class_structure_member_get_name(member))
+            {
+                fieldClass =
+                    bt_field_class_structure_member_borrow_field_class_const(
+                        member);
+                break;
+            }
+        }
+
+        if (memberIndex == memberCount)
+        {
+            return std::nullopt;
+        }
+
+        resolved._memberIndexes.push_back(memberIndex);
+    }
+
+    resolved._fieldClass = fieldClass;
+    return resolved;
+}
+
+const bt_field* ResolvedFieldPath::Borrow(const bt_event* event) const
+{
+    const bt_field* field = BorrowScopeField(_scope, event);
+    FAIL_FAST_IF(field == nullptr);
+
+    for (uint64_t memberIndex : _memberIndexes)
+    {
+        field = bt_field_structure_borrow_member_field_by_index_const(
+            field, memberIndex);
+    }
+
+    return field;
+}
+
+std::optional<FieldReader> GetFieldReader(const bt_field_class* fieldClass)
+{
+    switch (bt_field_class_get_type(fieldClass))
+    {
+    case BT_FIELD_CLASS_TYPE_BOOL:
+        return FieldReader::Bool;
+    case BT_FIELD_CLASS_TYPE_UNSIGNED_INTEGER:
+    case BT_FIELD_CLASS_TYPE_UNSIGNED_ENUMERATION:
+        return FieldReader::Unsigned;
+    case BT_FIELD_CLASS_TYPE_SIGNED_INTEGER:
+    case BT_FIELD_CLASS_TYPE_SIGNED_ENUMERATION:
+        return FieldReader::Signed;
+    case BT_FIELD_CLASS_TYPE_SINGLE_PRECISION_REAL:
+        return FieldReader::SingleReal;
+    case BT_FIELD_CLASS_TYPE_DOUBLE_PRECISION_REAL:
+        return FieldReader::DoubleReal;
+    case BT_FIELD_CLASS_TYPE_STRING:
+        return FieldReader::String;
+    default:
+        return std::nullopt;
+    }
+}
+
+const ResolvedFieldPath*
+FieldPathCache::Resolve(const bt_event_class* eventClass)
+{
+    auto itr = _entries.find(eventClass);
+    if (itr == _entries.end())
+    {
+        Entry entry;
+        bt_event_class_get_ref(eventClass);
+        entry.EventClass = eventClass;
+        entry.Resolved = ResolvedFieldPath::Resolve(_path, eventClass);
+
+        itr = _entries.emplace(eventClass, std::move(entry)).first;
+    }
+
+    return itr->second.Resolved ? &*itr->second.Resolved : nullptr;
+}
+
+const bt_field* FieldPathCache::Borrow(const bt_event* event)
+{
+    const ResolvedFieldPath* resolved =
+        Resolve(bt_event_borrow_class_const(event));
+
+    return resolved ? resolved->Borrow(event) : nullptr;
+}
+
+}
@@ -0,0 +1,104 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "BabelPtr.h"
+
+namespace LttngConsume {
+
+// Path to a field inside one of an event's scopes, written the same way the
+// decoded JSON nests it, e.g. "streamEventContext.vpid" or "data.status".
+class FieldPath
+{
+  public:
+    enum class Scope
+    {
+        PacketContext,
+        StreamEventContext,
+        EventContext,
+        Payload
+    };
+
+    // Throws std::invalid_argument if the scope is unknown or no member
+    // name follows it
+    explicit FieldPath(std::string_view path);
+
+    const std::string& ToString() const { return _path; }
+
+    Scope GetScope() const { return _scope; }
+
+    const std::vector<std::string>& MemberNames() const { return _memberNames; }
+
+  private:
+    std::string _path;
+    Scope _scope;
+    std::vector<std::string> _memberNames;
+};
+
+// A FieldPath resolved to structure member indexes for one event class, so
+// borrowing the field from an event never compares names.
+class ResolvedFieldPath
+{
+  public:
+    // Returns nothing when the event class has no such field
+    static std::optional<ResolvedFieldPath>
+    Resolve(const FieldPath& path, const bt_event_class* eventClass);
+
+    const bt_field* Borrow(const bt_event* event) const;
+
+    const bt_field_class* FieldClass() const { return _fieldClass; }
+
+  private:
+    FieldPath::Scope _scope = FieldPath::Scope::Payload;
+    std::vector<uint64_t> _memberIndexes;
+    const bt_field_class* _fieldClass = nullptr;
+};
+
+// How a field is read, from its field class
+enum class FieldReader
+{
+    Bool,
+    Unsigned,
+    Signed,
+    SingleReal,
+    DoubleReal,
+    String
+};
+
+// Returns nothing for a field class that isn't a bool, number or string
+std::optional<FieldReader> GetFieldReader(const bt_field_class* fieldClass);
+
+// Resolves a FieldPath once per event class. Graph thread only, since it
+// holds references on the event classes it has seen.
+class FieldPathCache
+{
+  public:
+    explicit FieldPathCache(FieldPath path) : _path(std::move(path)) {}
+
+    const FieldPath& Path() const { return _path; }
+
+    const ResolvedFieldPath* Resolve(const bt_event_class* eventClass);
+
+    // Returns nullptr when the event's class has no such field
+    const bt_field* Borrow(const bt_event* event);
+
+  private:
+    struct Entry
+    {
+        BabelPtr<const bt_event_class> EventClass;
+        std::optional<ResolvedFieldPath> Resolved;
+    };
+
+    FieldPath _path;
+    std::unordered_map<const bt_event_class*, Entry> _entries;
+};
+
+}
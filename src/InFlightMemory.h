@@ -0,0 +1,128 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <lttng-consume/LttngConsumerStatistics.h>
+#include <lttng-consume/LttngEventBatch.h>
+
+namespace LttngConsume {
+
+// Bytes charged for decoded events. Shared with the events callbacks hold
+// with LttngEventBatch::Hold() and those shared with subscribers, which may
+// outlive the consumer.
+struct InFlightAccount
+{
+    std::atomic<uint64_t> Bytes{ 0 };
+    std::atomic<uint64_t> HighWater{ 0 };
+
+    void Charge(uint64_t bytes)
+    {
+        uint64_t held = Bytes.fetch_add(bytes, std::memory_order_relaxed) +
+                        bytes;
+
+        uint64_t highWater = HighWater.load(std::memory_order_relaxed);
+        while (held > highWater &&
+               !HighWater.compare_exchange_weak(
+                   highWater, held, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void Release(uint64_t bytes)
+    {
+        Bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+};
+
+// Bytes held by decoded events on their way to the callback: queued for a
+// shard, in the batch being delivered, or queued between offline workers
+// and their merge, and by events callbacks and subscribers hold. Checked
+// against MemoryBudgetOptions::MaxBytes by the sink before it pulls more
+// messages. Thread safe.
+class InFlightMemory
+{
+  public:
+    explicit InFlightMemory(uint64_t maxBytes)
+        : _maxBytes(maxBytes), _account(std::make_shared<InFlightAccount>())
+    {}
+
+    bool Exceeded() const
+    {
+        return _maxBytes != 0 &&
+               _account->Bytes.load(std::memory_order_relaxed) > _maxBytes;
+    }
+
+    void Charge(uint64_t bytes) { _account->Charge(bytes); }
+
+    void Release(uint64_t bytes) { _account->Release(bytes); }
+
+    // For charging events shared beyond a batch, like Hold() does
+    const std::shared_ptr<InFlightAccount>& Account() const
+    {
+        return _account;
+    }
+
+    // Lets the callback given batch hold its events against this budget
+    void Attach(LttngEventBatch& batch) const
+    {
+        if (batch._account != _account)
+        {
+            batch._account = _account;
+        }
+    }
+
+    // Charges what a decoded batch holds, notes its size for Estimate(),
+    // and attaches it
+    uint64_t ChargeDecoded(LttngEventBatch& batch)
+    {
+        uint64_t bytes = 0;
+        for (const jsonbuilder::JsonBuilder& event : batch)
+        {
+            bytes += event.buffer_capacity();
+        }
+
+        _decodedEvents.fetch_add(batch.size(), std::memory_order_relaxed);
+        _decodedBytes.fetch_add(bytes, std::memory_order_relaxed);
+
+        Attach(batch);
+        Charge(bytes);
+        return bytes;
+    }
+
+    // Events still waiting to be decoded are charged what decoded events
+    // have averaged so far
+    uint64_t Estimate(size_t eventCount) const
+    {
+        uint64_t events = _decodedEvents.load(std::memory_order_relaxed);
+        uint64_t bytes = _decodedBytes.load(std::memory_order_relaxed);
+        uint64_t average = events == 0 ? c_initialEventBytes : bytes / events;
+
+        return average * eventCount;
+    }
+
+    void Snapshot(LttngConsumerStatistics& statistics) const
+    {
+        statistics.InFlightBytes =
+            _account->Bytes.load(std::memory_order_relaxed);
+        statistics.InFlightBytesHighWater =
+            _account->HighWater.load(std::memory_order_relaxed);
+    }
+
+  private:
+    // A typical small userspace event, until one has been decoded
+    static constexpr uint64_t c_initialEventBytes = 512;
+
+    uint64_t _maxBytes;
+    std::shared_ptr<InFlightAccount> _account;
+
+    std::atomic<uint64_t> _decodedEvents{ 0 };
+    std::atomic<uint64_t> _decodedBytes{ 0 };
+};
+
+}
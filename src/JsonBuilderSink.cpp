@@ -4,13 +4,32 @@
 #include "JsonBuilderSink.h"
 
 #include <array>
+#include <chrono>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include <babeltrace2/babeltrace.h>
 
 #include "BabelPtr.h"
+#include "ConsumerCounters.h"
+#include "CtfCapture.h"
+#include "DecodeLane.h"
+#include "EventAggregator.h"
+#include "EventFilter.h"
+#include "EventRateLimiter.h"
 #include "FailureHelpers.h"
+#include "FieldPath.h"
+#include "InFlightMemory.h"
+#include "LatencyTracker.h"
 #include "LttngJsonReader.h"
+#include "SubscriberFanOut.h"
+#include "TypedEventDecoder.h"
 
 using namespace jsonbuilder;
 
@@ -18,28 +37,278 @@ namespace LttngConsume {
 class JsonBuilderSink
 {
   public:
-    JsonBuilderSink(std::function<void(JsonBuilder&&)>& outputFunc)
-        : _outputFunc(outputFunc)
-    {}
+    JsonBuilderSink(const JsonBuilderSinkInitParams& params);
+
+    ~JsonBuilderSink();
 
     bt_component_class_sink_consume_method_status Run();
 
     bt_component_class_sink_graph_is_configured_method_status
     GraphIsConfigured(bt_self_component_sink* self);
 
+    bt_component_class_port_connected_method_status InputPortConnected(
+        bt_self_component_sink* self,
+        bt_self_component_port_input* port);
+
+    bt_self_component_add_port_status AddInputPort(bt_self_component_sink* self);
+
   public:
     static constexpr const char* c_inputPortName = "in";
 
+    // Bounds how far a shard's decode thread can fall behind before the
+    // graph stops pulling
+    static constexpr size_t c_maxQueuedBatchesPerLane = 64;
+
   private:
-    void HandleMessage(const bt_message* message);
+    struct InputIterator
+    {
+        BabelPtr<bt_message_iterator> MessageItr;
+    };
+
+    bt_message_iterator_next_status ConsumeMessages(InputIterator& inputItr);
+
+    void CountDiscarded(const bt_message* message, bt_message_type messageType);
+
+    size_t PickKeyedShard(const bt_message* message);
+
+    size_t PickStreamShard(const bt_message* message) const;
+
+    bool InTimeWindow(const bt_message* message) const;
+
+    // Hands the events decoded on the graph thread to the output, if any
+    void DeliverEventBatch();
+
+    bool CreatePendingMessageIterators();
 
   private:
-    BabelPtr<bt_message_iterator> _messageItr;
-    std::function<void(JsonBuilder&&)>& _outputFunc;
+    bt_self_component_sink* _self = nullptr;
+    std::vector<bt_self_component_port_input*> _pendingInputPorts;
+    std::vector<InputIterator> _inputItrs;
+    uint64_t _inputPortCount = 0;
+
+    std::function<void(LttngEventBatch&)>& _outputFunc;
+    ConsumerCounters& _counters;
+    InFlightMemory& _inFlight;
+    MemoryBudgetPolicy _budgetPolicy;
+    bool _multipleInputPorts;
+
+    // Decodes on the graph thread when there are no shards
+    LttngJsonReader _reader;
+    LttngEventBatch _eventBatch;
+    std::unique_ptr<LatencyRecorder> _latencyRecorder;
+
+    // Bumped whenever a stream ends, since its address may then be reused
+    uint64_t _streamGeneration = 0;
+
+    // One decode thread per shard, or none to decode on the graph thread
+    std::vector<std::unique_ptr<DecodeLane>> _lanes;
+
+    // Set when shards are picked by a field of each event, otherwise each
+    // stream is dealt a shard as it begins. _shardBatches collects one batch
+    // per shard while a message array is routed.
+    std::optional<FieldPathCache> _shardKey;
+    std::unordered_map<const bt_stream*, size_t> _streamShards;
+    size_t _nextStreamShard = 0;
+    std::vector<DecodeLane::MessageBatch> _shardBatches;
+
+    // Set when events are summarized per window instead of decoded
+    std::unique_ptr<EventAggregator> _aggregator;
+
+    // Nanoseconds since the epoch of the window events must fall in, when
+    // it is checked here rather than by trimmers
+    bool _checkTimeWindow = false;
+    int64_t _windowBegin = std::numeric_limits<int64_t>::min();
+    int64_t _windowEnd = std::numeric_limits<int64_t>::max();
+
+    // Set when a filter expression is configured
+    std::unique_ptr<EventFilter> _filter;
+
+    // Set when any rate limits are configured
+    std::unique_ptr<EventRateLimiter> _rateLimiter;
+
+    // Set when any typed events are registered
+    std::unique_ptr<TypedEventDecoder> _typedDecoder;
+
+    // Set when the consumer has subscriptions
+    std::unique_ptr<SubscriberFanOut> _fanOut;
+
+    // Set when the messages read are captured to disk
+    std::unique_ptr<CtfCapture> _capture;
 };
 
+JsonBuilderSink::JsonBuilderSink(const JsonBuilderSinkInitParams& params)
+    : _outputFunc(*params.OutputFunc)
+    , _counters(*params.Counters)
+    , _inFlight(*params.InFlight)
+    , _budgetPolicy(params.BudgetPolicy)
+    , _multipleInputPorts(params.MultipleInputPorts)
+    , _reader(params.Interner)
+{
+    // Only used when decoding on the graph thread
+    if (params.Latency)
+    {
+        _latencyRecorder = std::make_unique<LatencyRecorder>(*params.Latency);
+    }
+
+    if (params.Begin || params.End)
+    {
+        _checkTimeWindow = true;
+        if (params.Begin)
+        {
+            _windowBegin = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               params.Begin->time_since_epoch())
+                               .count();
+        }
+        if (params.End)
+        {
+            _windowEnd = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             params.End->time_since_epoch())
+                             .count();
+        }
+    }
+
+    if (!params.Filter.empty())
+    {
+        _filter = std::make_unique<EventFilter>(params.Filter);
+    }
+
+    if (!params.RateLimits.empty())
+    {
+        _rateLimiter = std::make_unique<EventRateLimiter>(
+            params.RateLimits, _counters);
+    }
+
+    if (!params.TypedHandlers.empty())
+    {
+        _typedDecoder = std::make_unique<TypedEventDecoder>(
+            params.TypedHandlers, _counters);
+    }
+
+    if (!params.Subscriptions.empty())
+    {
+        _fanOut = std::make_unique<SubscriberFanOut>(
+            params.Subscriptions, params.Interner, _inFlight);
+    }
+
+    if (!params.Capture.Directory.empty())
+    {
+        _capture = std::make_unique<CtfCapture>(params.Capture, _counters);
+    }
+
+    if (params.Aggregation.Interval.count() > 0)
+    {
+        _aggregator = std::make_unique<EventAggregator>(
+            params.Aggregation, _outputFunc, _counters);
+    }
+    else if (params.ShardCount > 1)
+    {
+        for (uint32_t i = 0; i < params.ShardCount; i++)
+        {
+            _lanes.push_back(std::make_unique<DecodeLane>(
+                _outputFunc,
+                c_maxQueuedBatchesPerLane,
+                params.Interner,
+                params.Latency,
+                _inFlight,
+                params.Placement,
+                *params.PlacementFailures));
+        }
+
+        if (!params.ShardKey.empty())
+        {
+            _shardKey.emplace(FieldPath(params.ShardKey));
+        }
+        _shardBatches.resize(_lanes.size());
+    }
+}
+
+JsonBuilderSink::~JsonBuilderSink()
+{
+    // The last window is never followed by a later event
+    if (_aggregator)
+    {
+        _aggregator->Flush();
+    }
+}
+
 bt_component_class_sink_consume_method_status JsonBuilderSink::Run()
 {
+    if (!CreatePendingMessageIterators())
+    {
+        return BT_COMPONENT_CLASS_SINK_CONSUME_METHOD_STATUS_ERROR;
+    }
+
+    for (auto& lane : _lanes)
+    {
+        lane->ReleaseDelivered();
+    }
+
+    // Give each upstream iterator one turn so a quiet port can't hold back
+    // the others. With a single muxed input this is just one call.
+    bool consumedMessages = false;
+    for (size_t i = 0; i < _inputItrs.size();)
+    {
+        bt_message_iterator_next_status status = ConsumeMessages(_inputItrs[i]);
+
+        switch (status)
+        {
+        case BT_MESSAGE_ITERATOR_NEXT_STATUS_END:
+            _inputItrs.erase(_inputItrs.begin() + i);
+            continue;
+        case BT_MESSAGE_ITERATOR_NEXT_STATUS_AGAIN:
+            break;
+        case BT_MESSAGE_ITERATOR_NEXT_STATUS_OK:
+            consumedMessages = true;
+            break;
+        default:
+            return BT_COMPONENT_CLASS_SINK_CONSUME_METHOD_STATUS_ERROR;
+        }
+
+        i++;
+    }
+
+    if (_inputItrs.empty() && _pendingInputPorts.empty())
+    {
+        return BT_COMPONENT_CLASS_SINK_CONSUME_METHOD_STATUS_END;
+    }
+
+    // Nothing is waiting to be delivered, so catch up on the capture
+    if (!consumedMessages && _capture)
+    {
+        _capture->Pump();
+    }
+
+    if (!consumedMessages && _aggregator)
+    {
+        _aggregator->FlushIfIdle();
+    }
+
+    return consumedMessages ? BT_COMPONENT_CLASS_SINK_CONSUME_METHOD_STATUS_OK :
+                              BT_COMPONENT_CLASS_SINK_CONSUME_METHOD_STATUS_AGAIN;
+}
+
+bt_message_iterator_next_status
+JsonBuilderSink::ConsumeMessages(InputIterator& inputItr)
+{
+    // Decoded events already hold the budget, so either leave the messages
+    // upstream until delivery catches up or drop their events undecoded
+    bool overBudget = _inFlight.Exceeded();
+    if (overBudget && _budgetPolicy == MemoryBudgetPolicy::Block)
+    {
+        return BT_MESSAGE_ITERATOR_NEXT_STATUS_AGAIN;
+    }
+
+    // Any shard may receive the next events, and skipping a full one would
+    // reorder its streams or keys, so every shard has to have room. Until
+    // then the messages are left upstream.
+    for (auto& lane : _lanes)
+    {
+        if (!lane->CanEnqueue())
+        {
+            return BT_MESSAGE_ITERATOR_NEXT_STATUS_AGAIN;
+        }
+    }
+
     struct MessageArray
     {
         const bt_message** Messages = nullptr;
@@ -57,58 +326,307 @@ bt_component_class_sink_consume_method_status JsonBuilderSink::Run()
     MessageArray messageArray;
 
     bt_message_iterator_next_status status = bt_message_iterator_next(
-        _messageItr.Get(), &messageArray.Messages, &messageArray.Count);
+        inputItr.MessageItr.Get(), &messageArray.Messages, &messageArray.Count);
+    if (status != BT_MESSAGE_ITERATOR_NEXT_STATUS_OK)
+    {
+        return status;
+    }
 
-    switch (status)
+    for (uint64_t i = 0; i < messageArray.Count; i++)
     {
-    case BT_MESSAGE_ITERATOR_NEXT_STATUS_END:
-        _messageItr.Reset();
-        return BT_COMPONENT_CLASS_SINK_CONSUME_METHOD_STATUS_END;
-    case BT_MESSAGE_ITERATOR_NEXT_STATUS_AGAIN:
-        return BT_COMPONENT_CLASS_SINK_CONSUME_METHOD_STATUS_AGAIN;
-    case BT_MESSAGE_ITERATOR_NEXT_STATUS_OK:
+        const bt_message* message = messageArray.Messages[i];
+        bt_message_type messageType = bt_message_get_type(message);
+        if (messageType == BT_MESSAGE_TYPE_STREAM_BEGINNING)
+        {
+            // A live session has a single source port, so streams rather
+            // than ports are spread over the shards
+            if (!_lanes.empty() && !_shardKey)
+            {
+                _streamShards[bt_message_stream_beginning_borrow_stream_const(
+                    message)] = _nextStreamShard++ % _lanes.size();
+            }
+        }
+        else if (messageType == BT_MESSAGE_TYPE_STREAM_END)
+        {
+            _streamGeneration++;
+            _streamShards.erase(
+                bt_message_stream_end_borrow_stream_const(message));
+        }
+        else if (
+            messageType == BT_MESSAGE_TYPE_DISCARDED_EVENTS ||
+            messageType == BT_MESSAGE_TYPE_DISCARDED_PACKETS)
+        {
+            CountDiscarded(message, messageType);
+        }
+
+        if (messageType != BT_MESSAGE_TYPE_EVENT)
+        {
+            continue;
+        }
+
+        if (_checkTimeWindow && !InTimeWindow(message))
+        {
+            _counters.EventsOutsideWindow.fetch_add(
+                1, std::memory_order_relaxed);
+            continue;
+        }
+
+        if (_filter && !_filter->Matches(message))
+        {
+            _counters.EventsFilteredOut.fetch_add(
+                1, std::memory_order_relaxed);
+            continue;
+        }
+
+        if (overBudget)
+        {
+            _counters.EventsOverBudget.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        if (_rateLimiter && !_rateLimiter->Admit(message))
+        {
+            continue;
+        }
+
+        if (_typedDecoder && _typedDecoder->IsBound(message))
+        {
+            // Events decoded so far go first, so typed and JSON callbacks
+            // see events in the order they were read
+            DeliverEventBatch();
+            _typedDecoder->Deliver(message);
+            continue;
+        }
+
+        if (_fanOut)
+        {
+            _fanOut->Deliver(message, _streamGeneration);
+            continue;
+        }
+
+        if (_aggregator)
+        {
+            _aggregator->Add(message);
+        }
+        else if (!_lanes.empty())
+        {
+            size_t shard = _shardKey ? PickKeyedShard(message) :
+                                       PickStreamShard(message);
+
+            bt_message_get_ref(message);
+            _shardBatches[shard].push_back(message);
+        }
+        else
+        {
+            _reader.SetStreamGeneration(_streamGeneration);
+            _reader.DecodeEvent(message, _eventBatch.EmplaceBack());
+
+            if (_latencyRecorder)
+            {
+                _latencyRecorder->SetStreamGeneration(_streamGeneration);
+                _latencyRecorder->Add(message);
+            }
+        }
+    }
+
+    DeliverEventBatch();
+
+    for (size_t shard = 0; shard < _shardBatches.size(); shard++)
+    {
+        if (!_shardBatches[shard].empty())
+        {
+            _lanes[shard]->Enqueue(
+                std::move(_shardBatches[shard]), _streamGeneration);
+            _shardBatches[shard].clear();
+        }
+    }
+
+    // Only once the events are delivered, in case this writes to disk
+    if (_capture)
+    {
+        _capture->Tee(messageArray.Messages, messageArray.Count);
+    }
+
+    return BT_MESSAGE_ITERATOR_NEXT_STATUS_OK;
+}
+
+void JsonBuilderSink::CountDiscarded(
+    const bt_message* message,
+    bt_message_type messageType)
+{
+    // The tracer doesn't always know how many were lost, so count at least
+    // one for each message
+    uint64_t count = 1;
+
+    if (messageType == BT_MESSAGE_TYPE_DISCARDED_EVENTS)
+    {
+        bt_message_discarded_events_get_count(message, &count);
+        _counters.EventsDiscarded.fetch_add(count, std::memory_order_relaxed);
+    }
+    else
+    {
+        bt_message_discarded_packets_get_count(message, &count);
+        _counters.PacketsDiscarded.fetch_add(count, std::memory_order_relaxed);
+    }
+}
+
+void JsonBuilderSink::DeliverEventBatch()
+{
+    if (_eventBatch.empty())
+    {
+        return;
+    }
+
+    if (_latencyRecorder)
+    {
+        _latencyRecorder->Commit();
+    }
+
+    uint64_t decodedBytes = _inFlight.ChargeDecoded(_eventBatch);
+    _outputFunc(_eventBatch);
+    _inFlight.Release(decodedBytes);
+
+    _eventBatch.Clear();
+}
+
+bool JsonBuilderSink::InTimeWindow(const bt_message* message) const
+{
+    const bt_clock_snapshot* clock =
+        bt_message_event_borrow_default_clock_snapshot_const(message);
+
+    int64_t nanosFromEpoch = 0;
+    bt_clock_snapshot_get_ns_from_origin_status clockStatus =
+        bt_clock_snapshot_get_ns_from_origin(clock, &nanosFromEpoch);
+    FAIL_FAST_IF(clockStatus != BT_CLOCK_SNAPSHOT_GET_NS_FROM_ORIGIN_STATUS_OK);
+
+    return nanosFromEpoch >= _windowBegin && nanosFromEpoch <= _windowEnd;
+}
+
+size_t JsonBuilderSink::PickKeyedShard(const bt_message* message)
+{
+    const bt_field* keyField =
+        _shardKey->Borrow(bt_message_event_borrow_event_const(message));
+    if (keyField == nullptr)
+    {
+        return 0;
+    }
+
+    uint64_t key = 0;
+    switch (bt_field_get_class_type(keyField))
+    {
+    case BT_FIELD_CLASS_TYPE_BOOL:
+        key = bt_field_bool_get_value(keyField);
+        break;
+    case BT_FIELD_CLASS_TYPE_UNSIGNED_INTEGER:
+    case BT_FIELD_CLASS_TYPE_UNSIGNED_ENUMERATION:
+        key = bt_field_integer_unsigned_get_value(keyField);
+        break;
+    case BT_FIELD_CLASS_TYPE_SIGNED_INTEGER:
+    case BT_FIELD_CLASS_TYPE_SIGNED_ENUMERATION:
+        key = static_cast<uint64_t>(
+            bt_field_integer_signed_get_value(keyField));
+        break;
+    case BT_FIELD_CLASS_TYPE_STRING:
+        key = std::hash<std::string_view>{}(std::string_view(
+            bt_field_string_get_value(keyField),
+            bt_field_string_get_length(keyField)));
         break;
     default:
-        return BT_COMPONENT_CLASS_SINK_CONSUME_METHOD_STATUS_ERROR;
+        break;
     }
 
-    for (uint64_t i = 0; i < messageArray.Count; i++)
+    // Pids and cpu ids are small and often share a stride, so mix the bits
+    // before taking the modulo
+    key *= 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>((key >> 32) % _lanes.size());
+}
+
+size_t JsonBuilderSink::PickStreamShard(const bt_message* message) const
+{
+    const bt_event* event = bt_message_event_borrow_event_const(message);
+    const bt_stream* stream = bt_event_borrow_stream_const(event);
+
+    // Every stream begins before its first event
+    auto itr = _streamShards.find(stream);
+    FAIL_FAST_IF(itr == _streamShards.end());
+
+    return itr->second;
+}
+
+bool JsonBuilderSink::CreatePendingMessageIterators()
+{
+    for (bt_self_component_port_input* inputPort : _pendingInputPorts)
     {
-        const bt_message* message = messageArray.Messages[i];
-        if (bt_message_get_type(message) == BT_MESSAGE_TYPE_EVENT)
+        InputIterator inputItr;
+        bt_message_iterator_create_from_sink_component_status status =
+            bt_message_iterator_create_from_sink_component(
+                _self, inputPort, &inputItr.MessageItr);
+        if (status != BT_MESSAGE_ITERATOR_CREATE_FROM_SINK_COMPONENT_STATUS_OK)
         {
-            HandleMessage(message);
+            return false;
         }
+        FAIL_FAST_IF(!inputItr.MessageItr);
+
+        _inputItrs.push_back(std::move(inputItr));
     }
 
-    return BT_COMPONENT_CLASS_SINK_CONSUME_METHOD_STATUS_OK;
+    _pendingInputPorts.clear();
+    return true;
 }
 
 bt_component_class_sink_graph_is_configured_method_status
 JsonBuilderSink::GraphIsConfigured(bt_self_component_sink* self)
 {
-    bt_self_component_port_input* inputPort =
-        bt_self_component_sink_borrow_input_port_by_name(self, c_inputPortName);
+    _self = self;
 
-    bt_message_iterator_create_from_sink_component_status status =
-        bt_message_iterator_create_from_sink_component(
-            self, inputPort, &_messageItr);
-    if (status != BT_MESSAGE_ITERATOR_CREATE_FROM_SINK_COMPONENT_STATUS_OK)
+    if (!CreatePendingMessageIterators())
     {
-        return static_cast<bt_component_class_sink_graph_is_configured_method_status>(
-            status);
+        return BT_COMPONENT_CLASS_SINK_GRAPH_IS_CONFIGURED_METHOD_STATUS_ERROR;
     }
-    FAIL_FAST_IF(!_messageItr);
 
     return BT_COMPONENT_CLASS_SINK_GRAPH_IS_CONFIGURED_METHOD_STATUS_OK;
 }
 
-void JsonBuilderSink::HandleMessage(const bt_message* message)
+bt_component_class_port_connected_method_status
+JsonBuilderSink::InputPortConnected(
+    bt_self_component_sink* self,
+    bt_self_component_port_input* port)
 {
-    LttngJsonReader reader;
-    JsonBuilder builder = reader.DecodeEvent(message);
+    // Message iterators can only be created once the graph is configured,
+    // so ports connected before or while running are picked up lazily.
+    _pendingInputPorts.push_back(port);
+
+    if (_multipleInputPorts)
+    {
+        bt_self_component_add_port_status addPortStatus = AddInputPort(self);
+        if (addPortStatus != BT_SELF_COMPONENT_ADD_PORT_STATUS_OK)
+        {
+            return static_cast<bt_component_class_port_connected_method_status>(
+                addPortStatus);
+        }
+    }
 
-    _outputFunc(std::move(builder));
+    return BT_COMPONENT_CLASS_PORT_CONNECTED_METHOD_STATUS_OK;
+}
+
+bt_self_component_add_port_status
+JsonBuilderSink::AddInputPort(bt_self_component_sink* self)
+{
+    std::string portName = c_inputPortName;
+    if (_multipleInputPorts)
+    {
+        portName += std::to_string(_inputPortCount);
+    }
+
+    bt_self_component_add_port_status status =
+        bt_self_component_sink_add_input_port(
+            self, portName.c_str(), nullptr, nullptr);
+    if (status == BT_SELF_COMPONENT_ADD_PORT_STATUS_OK)
+    {
+        _inputPortCount++;
+    }
+
+    return status;
 }
 
 bt_component_class_sink_consume_method_status
@@ -126,15 +644,6 @@ bt_component_class_initialize_method_status JsonBuilderSink_InitStatic(
     const bt_value*,
     void* init_method_data)
 {
-    bt_self_component_add_port_status addPortStatus =
-        bt_self_component_sink_add_input_port(
-            self, JsonBuilderSink::c_inputPortName, nullptr, nullptr);
-    if (addPortStatus != BT_SELF_COMPONENT_ADD_PORT_STATUS_OK)
-    {
-        return static_cast<bt_component_class_initialize_method_status>(
-            addPortStatus);
-    }
-
     // Construct the JsonBuilderSink instance
 
     FAIL_FAST_IF(init_method_data == nullptr);
@@ -143,11 +652,23 @@ bt_component_class_initialize_method_status JsonBuilderSink_InitStatic(
 
     // Check each param
     FAIL_FAST_IF(params->OutputFunc == nullptr);
+    FAIL_FAST_IF(params->Counters == nullptr);
+    FAIL_FAST_IF(params->InFlight == nullptr);
+
+    auto jsonBuilderSink = std::make_unique<JsonBuilderSink>(*params);
+
+    bt_self_component_add_port_status addPortStatus =
+        jsonBuilderSink->AddInputPort(self);
+    if (addPortStatus != BT_SELF_COMPONENT_ADD_PORT_STATUS_OK)
+    {
+        return static_cast<bt_component_class_initialize_method_status>(
+            addPortStatus);
+    }
 
     // Set the user data, passing ownership in the case of success
-    JsonBuilderSink* jsonBuilderSink = new JsonBuilderSink(*params->OutputFunc);
     bt_self_component_set_data(
-        bt_self_component_sink_as_self_component(self), jsonBuilderSink);
+        bt_self_component_sink_as_self_component(self),
+        jsonBuilderSink.release());
 
     return BT_COMPONENT_CLASS_INITIALIZE_METHOD_STATUS_OK;
 }
@@ -161,6 +682,18 @@ JsonBuilderSink_GraphIsConfiguredStatic(bt_self_component_sink* self)
     return jbSink->GraphIsConfigured(self);
 }
 
+bt_component_class_port_connected_method_status
+JsonBuilderSink_InputPortConnectedStatic(
+    bt_self_component_sink* self,
+    bt_self_component_port_input* selfPort,
+    const bt_port_output*)
+{
+    auto jbSink = static_cast<JsonBuilderSink*>(bt_self_component_get_data(
+        bt_self_component_sink_as_self_component(self)));
+
+    return jbSink->InputPortConnected(self, selfPort);
+}
+
 void JsonBuilderSink_FinalizeStatic(bt_self_component_sink* self)
 {
     auto jbSink = static_cast<JsonBuilderSink*>(bt_self_component_get_data(
@@ -177,6 +710,8 @@ BabelPtr<const bt_component_class_sink> GetJsonBuilderSinkComponentClass()
         jsonBuilderSinkClass.Get(), JsonBuilderSink_InitStatic);
     bt_component_class_sink_set_graph_is_configured_method(
         jsonBuilderSinkClass.Get(), JsonBuilderSink_GraphIsConfiguredStatic);
+    bt_component_class_sink_set_input_port_connected_method(
+        jsonBuilderSinkClass.Get(), JsonBuilderSink_InputPortConnectedStatic);
     bt_component_class_sink_set_finalize_method(
         jsonBuilderSinkClass.Get(), JsonBuilderSink_FinalizeStatic);
 
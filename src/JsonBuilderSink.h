@@ -3,23 +3,91 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <lttng-consume/LttngConsumerOptions.h>
 
 #include "BabelPtr.h"
 
 struct bt_component_class;
 
-namespace jsonbuilder {
-class JsonBuilder;
-}
-
 namespace LttngConsume {
 
+struct ConsumerCounters;
+class InFlightMemory;
+class LttngEventBatch;
+struct LttngSubscription;
+class LatencyTracker;
+class PlacementErrors;
+class StringInterner;
+class TypedEventHandler;
+
 BabelPtr<const bt_component_class_sink> GetJsonBuilderSinkComponentClass();
 
 struct JsonBuilderSinkInitParams
 {
-    std::function<void(jsonbuilder::JsonBuilder&&)>* OutputFunc = nullptr;
+    std::function<void(LttngEventBatch&)>* OutputFunc = nullptr;
+
+    // When set, the sink keeps one unconnected input port available and
+    // reads every connected port round-robin instead of a single "in" port.
+    bool MultipleInputPorts = false;
+
+    // When above one, events of each stream are decoded and delivered on
+    // one of this many threads instead of on the graph thread
+    uint32_t ShardCount = 1;
+
+    // FieldPath of the value that picks the shard of each event. Empty to
+    // pick shards by stream.
+    std::string ShardKey;
+
+    // Summarizes events instead of decoding them when Interval is set
+    AggregationOptions Aggregation;
+
+    // Events timestamped outside [Begin, End] are dropped undecoded, before
+    // Filter. Set where no trimmer can seek the source, e.g. a live session.
+    std::optional<std::chrono::system_clock::time_point> Begin;
+    std::optional<std::chrono::system_clock::time_point> End;
+
+    // EventFilter expression, empty for none. Checked before RateLimits.
+    std::string Filter;
+
+    // Applied before events are decoded, aggregated or handed to a shard
+    std::vector<EventRateLimit> RateLimits;
+
+    ConsumerCounters* Counters = nullptr;
+
+    // Charged with the decoded events on their way to OutputFunc. While
+    // over budget the sink blocks or drops as BudgetPolicy says.
+    InFlightMemory* InFlight = nullptr;
+    MemoryBudgetPolicy BudgetPolicy = MemoryBudgetPolicy::Block;
+
+    // Set when repeated strings are decoded as ids
+    StringInterner* Interner = nullptr;
+
+    // Set when delivery latency is tracked
+    LatencyTracker* Latency = nullptr;
+
+    // Events of the classes these are bound to are delivered to them on the
+    // graph thread, right after rate limiting, instead of being decoded
+    std::vector<std::shared_ptr<TypedEventHandler>> TypedHandlers;
+
+    // When any are set, events that get past the checks above go to these
+    // instead of OutputFunc
+    std::vector<std::shared_ptr<const LttngSubscription>> Subscriptions;
+
+    // Applied to each shard thread, which reports a failure to
+    // PlacementFailures
+    ThreadPlacementOptions Placement;
+    PlacementErrors* PlacementFailures = nullptr;
+
+    // Every message read is also written here when its Directory is set
+    CaptureOptions Capture;
 };
 
 }
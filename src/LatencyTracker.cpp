@@ -0,0 +1,147 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "LatencyTracker.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <babeltrace2/babeltrace.h>
+
+#include "FailureHelpers.h"
+
+namespace LttngConsume {
+
+static std::string GetSessionName(const bt_trace* trace)
+{
+    const bt_value* traceName =
+        bt_trace_borrow_environment_entry_value_by_name_const(
+            trace, "trace_name");
+    if (traceName && bt_value_is_string(traceName))
+    {
+        return bt_value_string_get(traceName);
+    }
+
+    const char* name = bt_trace_get_name(trace);
+    return name ? name : "";
+}
+
+static size_t GetBucketIndex(int64_t latencyNs)
+{
+    if (latencyNs < 1000)
+    {
+        return 0;
+    }
+
+    // Bucket i holds [2^(i-1), 2^i) microseconds
+    uint64_t latencyUs = static_cast<uint64_t>(latencyNs) / 1000;
+    size_t bitWidth = 64 - __builtin_clzll(latencyUs);
+
+    return std::min(bitWidth, LttngLatencyHistogram::c_bucketCount - 1);
+}
+
+LatencyTracker::Buckets&
+LatencyTracker::GetStreamBuckets(const bt_stream* stream)
+{
+    const char* streamName = bt_stream_get_name(stream);
+
+    StreamKey key{ GetSessionName(bt_stream_borrow_trace_const(stream)),
+                   streamName ? streamName : "",
+                   bt_stream_get_id(stream) };
+
+    std::lock_guard<std::mutex> lock{ _mutex };
+
+    std::unique_ptr<Buckets>& buckets = _streams[std::move(key)];
+    if (!buckets)
+    {
+        buckets = std::make_unique<Buckets>();
+        for (std::atomic<uint64_t>& bucket : *buckets)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    return *buckets;
+}
+
+std::vector<LttngLatencyHistogram> LatencyTracker::Snapshot() const
+{
+    std::vector<LttngLatencyHistogram> histograms;
+    std::map<std::string, LttngLatencyHistogram> sessions;
+
+    std::lock_guard<std::mutex> lock{ _mutex };
+
+    for (const auto& [key, buckets] : _streams)
+    {
+        LttngLatencyHistogram& histogram = histograms.emplace_back();
+        histogram.Session = std::get<0>(key);
+        histogram.Stream = std::get<1>(key);
+        histogram.StreamId = std::get<2>(key);
+
+        LttngLatencyHistogram& session = sessions[histogram.Session];
+        session.Session = histogram.Session;
+
+        for (size_t i = 0; i < LttngLatencyHistogram::c_bucketCount; i++)
+        {
+            histogram.Buckets[i] =
+                (*buckets)[i].load(std::memory_order_relaxed);
+            session.Buckets[i] += histogram.Buckets[i];
+        }
+    }
+
+    for (auto& [name, session] : sessions)
+    {
+        histograms.push_back(std::move(session));
+    }
+
+    return histograms;
+}
+
+void LatencyRecorder::SetStreamGeneration(uint64_t streamGeneration)
+{
+    if (streamGeneration != _streamGeneration)
+    {
+        _streams.clear();
+        _streamGeneration = streamGeneration;
+    }
+}
+
+void LatencyRecorder::Add(const bt_message* message)
+{
+    const bt_event* event = bt_message_event_borrow_event_const(message);
+    const bt_stream* stream = bt_event_borrow_stream_const(event);
+
+    LatencyTracker::Buckets*& streamBuckets = _streams[stream];
+    if (streamBuckets == nullptr)
+    {
+        streamBuckets = &_tracker.GetStreamBuckets(stream);
+    }
+
+    const bt_clock_snapshot* clock =
+        bt_message_event_borrow_default_clock_snapshot_const(message);
+
+    int64_t nanosFromEpoch = 0;
+    bt_clock_snapshot_get_ns_from_origin_status clockStatus =
+        bt_clock_snapshot_get_ns_from_origin(clock, &nanosFromEpoch);
+    FAIL_FAST_IF(clockStatus != BT_CLOCK_SNAPSHOT_GET_NS_FROM_ORIGIN_STATUS_OK);
+
+    _pending.push_back(PendingEvent{ streamBuckets, nanosFromEpoch });
+}
+
+void LatencyRecorder::Commit()
+{
+    int64_t nowNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count();
+
+    for (const PendingEvent& pending : _pending)
+    {
+        size_t bucket = GetBucketIndex(nowNanos - pending.NanosFromEpoch);
+        (*pending.StreamBuckets)[bucket].fetch_add(
+            1, std::memory_order_relaxed);
+    }
+
+    _pending.clear();
+}
+
+}
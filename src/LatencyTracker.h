@@ -0,0 +1,76 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <lttng-consume/LttngConsumerStatistics.h>
+
+struct bt_message;
+struct bt_stream;
+
+namespace LttngConsume {
+
+// Delivery latency histograms of every stream seen, shared by all the
+// threads that deliver events
+class LatencyTracker
+{
+  public:
+    using Buckets = std::array<
+        std::atomic<uint64_t>,
+        LttngLatencyHistogram::c_bucketCount>;
+
+    // Thread safe. The buckets live as long as the tracker.
+    Buckets& GetStreamBuckets(const bt_stream* stream);
+
+    // Thread safe. One histogram per stream followed by one per session.
+    std::vector<LttngLatencyHistogram> Snapshot() const;
+
+  private:
+    // Session, stream name and stream id
+    using StreamKey = std::tuple<std::string, std::string, uint64_t>;
+
+    mutable std::mutex _mutex;
+    std::map<StreamKey, std::unique_ptr<Buckets>> _streams;
+};
+
+// Records the latencies of the events one thread delivers. Not thread safe.
+class LatencyRecorder
+{
+  public:
+    explicit LatencyRecorder(LatencyTracker& tracker) : _tracker(tracker) {}
+
+    // Streams are cached by address, which a new stream can reuse once an
+    // older one ends. Drops the cache when the generation moves on.
+    void SetStreamGeneration(uint64_t streamGeneration);
+
+    // Notes the timestamp of an event that is about to be delivered
+    void Add(const bt_message* message);
+
+    // Records every noted event against the current wall clock
+    void Commit();
+
+  private:
+    struct PendingEvent
+    {
+        LatencyTracker::Buckets* StreamBuckets;
+        int64_t NanosFromEpoch;
+    };
+
+    LatencyTracker& _tracker;
+    uint64_t _streamGeneration = 0;
+    std::unordered_map<const bt_stream*, LatencyTracker::Buckets*> _streams;
+    std::vector<PendingEvent> _pending;
+};
+
+}
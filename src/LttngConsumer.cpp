@@ -9,9 +9,10 @@ namespace LttngConsume {
 
 LttngConsumer::LttngConsumer(
     std::string_view listeningUrl,
-    std::chrono::milliseconds pollInterval)
+    std::chrono::milliseconds pollInterval,
+    const LttngConsumerOptions& options)
 {
-    _impl.reset(new LttngConsumerImpl(listeningUrl, pollInterval));
+    _impl.reset(new LttngConsumerImpl(listeningUrl, pollInterval, options));
 }
 
 LttngConsumer::~LttngConsumer() = default;
@@ -22,9 +23,59 @@ void LttngConsumer::StartConsuming(
     _impl->StartConsuming(callback);
 }
 
+void LttngConsumer::StartConsumingBatches(
+    std::function<void(LttngEventBatch&)> callback)
+{
+    _impl->StartConsumingBatches(callback);
+}
+
 void LttngConsumer::StopConsuming()
 {
     _impl->StopConsuming();
 }
 
+bool LttngConsumer::NextBatch(
+    LttngEventBatch& batch,
+    size_t maxEvents,
+    std::chrono::milliseconds timeout)
+{
+    return _impl->NextBatch(batch, maxEvents, timeout);
+}
+
+int LttngConsumer::GetPollFd()
+{
+    return _impl->GetPollFd();
+}
+
+bool LttngConsumer::ProcessAvailable(
+    const std::function<void(LttngEventBatch&)>& callback)
+{
+    return _impl->ProcessAvailable(callback);
+}
+
+void LttngConsumer::AddTypedEvent(std::shared_ptr<TypedEventHandler> handler)
+{
+    _impl->AddTypedEvent(std::move(handler));
+}
+
+void LttngConsumer::Subscribe(LttngSubscription subscription)
+{
+    _impl->Subscribe(std::move(subscription));
+}
+
+LttngConsumerStatistics LttngConsumer::GetStatistics() const
+{
+    return _impl->GetStatistics();
+}
+
+std::string_view LttngConsumer::LookupInternedString(uint32_t id) const
+{
+    return _impl->LookupInternedString(id);
+}
+
+std::vector<LttngLatencyHistogram> LttngConsumer::GetLatencyHistograms() const
+{
+    return _impl->GetLatencyHistograms();
+}
+
 }
@@ -3,43 +3,316 @@
 
 #include "LttngConsumerImpl.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <system_error>
 #include <thread>
 
+#include <sys/timerfd.h>
+#include <unistd.h>
+
 #include <babeltrace2/babeltrace.h>
 #include <lttng-consume/LttngConsumer.h>
 
 #include "BabelPtr.h"
+#include "EventFilter.h"
 #include "FailureHelpers.h"
+#include "FieldPath.h"
 #include "JsonBuilderSink.h"
+#include "MergeFilter.h"
+#include "OfflineMerger.h"
+#include "SubscriberFanOut.h"
+#include "SyntheticSource.h"
+#include "ThreadPlacement.h"
 
 namespace LttngConsume {
 
+static constexpr std::string_view c_fileUrlPrefix = "file://";
+static constexpr std::string_view c_syntheticUrl = "synthetic://";
+
+static bool IsLiveUrl(std::string_view url)
+{
+    for (std::string_view scheme : { "net://", "net4://", "net6://" })
+    {
+        if (url.substr(0, scheme.size()) == scheme)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 LttngConsumerImpl::LttngConsumerImpl(
     std::string_view listeningUrl,
-    std::chrono::milliseconds pollInterval)
+    std::chrono::milliseconds pollInterval,
+    const LttngConsumerOptions& options)
     : _listeningUrl(listeningUrl)
+    , _offline(!IsLiveUrl(listeningUrl))
+    , _synthetic(listeningUrl == c_syntheticUrl)
     , _pollInterval(pollInterval)
+    , _options(options)
     , _stopConsuming(false)
-{}
+    , _inFlight(_options.MemoryBudget.MaxBytes)
+{
+    if (!_options.ShardKey.empty())
+    {
+        // Throws if the path is malformed, before any graph is built
+        FieldPath shardKey(_options.ShardKey);
+    }
+
+    const AggregationOptions& aggregation = _options.Aggregation;
+    if (aggregation.Interval.count() < 0)
+    {
+        throw std::invalid_argument("Aggregation interval is negative");
+    }
+
+    if (aggregation.IdleFlushDelay.count() < 0)
+    {
+        throw std::invalid_argument("Aggregation idle flush delay is negative");
+    }
+
+    if (!aggregation.ValueField.empty())
+    {
+        FieldPath valueField(aggregation.ValueField);
+    }
+
+    if (!std::is_sorted(
+            aggregation.HistogramBounds.begin(),
+            aggregation.HistogramBounds.end()))
+    {
+        throw std::invalid_argument("Histogram bounds are not ascending");
+    }
+
+    if (!_options.Filter.empty())
+    {
+        EventFilter filter(_options.Filter);
+    }
+
+    for (const EventRateLimit& limit : _options.RateLimits)
+    {
+        if (limit.SampleRatio < 0 || limit.SampleRatio > 1)
+        {
+            throw std::invalid_argument(
+                "Sample ratio for " + limit.EventName + " is outside [0, 1]");
+        }
+
+        if (limit.EventsPerSecond < 0)
+        {
+            throw std::invalid_argument(
+                "Event rate for " + limit.EventName + " is negative");
+        }
+    }
+
+    ValidateThreadPlacement(_options.Placement);
+
+    if (_options.OfflineWorkerCount > 1 &&
+        (_options.ShardCount > 1 || aggregation.Interval.count() > 0))
+    {
+        throw std::invalid_argument(
+            "Offline workers can't be combined with shards or aggregation");
+    }
+
+    if (_options.Begin && _options.End && *_options.Begin > *_options.End)
+    {
+        throw std::invalid_argument("Begin is after End");
+    }
+
+    if (_synthetic)
+    {
+        ValidateSyntheticSourceOptions(_options.Synthetic);
+    }
+
+    const CaptureOptions& capture = _options.Capture;
+    if (!capture.Directory.empty())
+    {
+        if (capture.SegmentBytes == 0 ||
+            (capture.MaxBytes != 0 && capture.MaxBytes < capture.SegmentBytes))
+        {
+            throw std::invalid_argument(
+                "Capture segments must be non-empty and fit within MaxBytes");
+        }
+
+        // Each worker would rotate and prune the same segments
+        if (_options.OfflineWorkerCount > 1)
+        {
+            throw std::invalid_argument(
+                "Capture can't be combined with offline workers");
+        }
+    }
+
+    if (_offline &&
+        _listeningUrl.compare(0, c_fileUrlPrefix.size(), c_fileUrlPrefix) == 0)
+    {
+        _listeningUrl.erase(0, c_fileUrlPrefix.size());
+    }
+}
+
+LttngConsumerImpl::~LttngConsumerImpl()
+{
+    if (_pollFd >= 0)
+    {
+        close(_pollFd);
+    }
+}
 
 void LttngConsumerImpl::StartConsuming(
     std::function<void(jsonbuilder::JsonBuilder&&)> callback)
 {
-    CreateGraph(callback);
+    // Moving each event out gives up its buffer, the same as decoding every
+    // event into a fresh builder
+    StartConsumingBatches([&callback](LttngEventBatch& batch) {
+        for (jsonbuilder::JsonBuilder& builder : batch)
+        {
+            callback(std::move(builder));
+        }
+    });
+}
+
+void LttngConsumerImpl::StartConsumingBatches(
+    std::function<void(LttngEventBatch&)> callback)
+{
+    ScopedThreadPlacement placement(_options.Placement);
 
-    bt_graph_run_status status;
-    while ((status = bt_graph_run(_graph.Get())) == BT_GRAPH_RUN_STATUS_AGAIN &&
-           !_stopConsuming)
+    if (_offline && _options.OfflineWorkerCount > 1)
     {
-        std::this_thread::sleep_for(_pollInterval);
+        RunOfflineWorkers(callback);
+        _placementErrors.Rethrow();
+        return;
     }
 
-    if (status != BT_GRAPH_RUN_STATUS_AGAIN)
+    TraceGraph graph;
+    CreateGraph(graph, callback);
+    RunGraph(graph);
+
+    // Tearing down the graph finalizes the sink, which delivers whatever its
+    // decode threads still hold while callback is alive
+    graph.Graph.Reset();
+
+    _placementErrors.Rethrow();
+}
+
+void LttngConsumerImpl::RunGraph(TraceGraph& graph)
+{
+    if (!_offline)
+    {
+        bt_graph_run_status status;
+        while ((status = bt_graph_run(graph.Graph.Get())) ==
+                   BT_GRAPH_RUN_STATUS_AGAIN &&
+               !_stopConsuming && !_placementErrors.Failed())
+        {
+            std::this_thread::sleep_for(_pollInterval);
+        }
+
+        // A live session only stops when asked to
+        if (status != BT_GRAPH_RUN_STATUS_AGAIN)
+        {
+            std::cerr << "Final graph status: " << status << std::endl;
+        }
+        FAIL_FAST_IF(status != BT_GRAPH_RUN_STATUS_AGAIN);
+        return;
+    }
+
+    // One sink iteration at a time, since bt_graph_run() only returns at
+    // the end of a recorded trace
+    bt_graph_run_once_status status = BT_GRAPH_RUN_ONCE_STATUS_OK;
+    while (!_stopConsuming && !_placementErrors.Failed())
+    {
+        status = bt_graph_run_once(graph.Graph.Get());
+        if (status == BT_GRAPH_RUN_ONCE_STATUS_AGAIN)
+        {
+            std::this_thread::sleep_for(_pollInterval);
+        }
+        else if (status != BT_GRAPH_RUN_ONCE_STATUS_OK)
+        {
+            break;
+        }
+    }
+
+    bool finished = status == BT_GRAPH_RUN_ONCE_STATUS_OK ||
+                    status == BT_GRAPH_RUN_ONCE_STATUS_AGAIN ||
+                    status == BT_GRAPH_RUN_ONCE_STATUS_END;
+    if (!finished)
     {
         std::cerr << "Final graph status: " << status << std::endl;
     }
-    FAIL_FAST_IF(status != BT_GRAPH_RUN_STATUS_AGAIN);
+    FAIL_FAST_IF(!finished);
+}
+
+void LttngConsumerImpl::RunOfflineWorkers(
+    std::function<void(LttngEventBatch&)>& callback)
+{
+    uint32_t workerCount = _options.OfflineWorkerCount;
+
+    std::unique_ptr<OfflineMerger> merger;
+    if (_options.Ordering != MessageOrdering::Unordered)
+    {
+        merger = std::make_unique<OfflineMerger>(workerCount, _inFlight);
+    }
+
+    // Graphs are built and torn down on this thread, and only run on the
+    // workers. Babeltrace objects aren't thread safe, and plugins and
+    // component classes are shared by the graphs.
+    std::vector<TraceGraph> graphs(workerCount);
+    std::vector<std::function<void(LttngEventBatch&)>> outputs(workerCount);
+    std::vector<bool> hasPorts(workerCount);
+
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        if (merger)
+        {
+            outputs[i] = [&merger, i](LttngEventBatch& batch) {
+                merger->Push(i, batch);
+            };
+        }
+
+        graphs[i].WorkerIndex = i;
+        graphs[i].WorkerCount = workerCount;
+        hasPorts[i] = CreateGraph(graphs[i], merger ? outputs[i] : callback);
+    }
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        workers.emplace_back([this, &graphs, &hasPorts, &merger, i]() {
+            // Skips the graph, and stops the others, if this worker can't be
+            // placed. The merger still needs to hear it has finished.
+            std::error_code placementError =
+                ApplyThreadPlacement(_options.Placement);
+            if (placementError)
+            {
+                _placementErrors.Set(placementError);
+            }
+            else if (hasPorts[i])
+            {
+                RunGraph(graphs[i]);
+            }
+
+            // Without shards or aggregation the sink holds nothing back,
+            // so every event was delivered by the end of the run
+            if (merger)
+            {
+                merger->Finish(i);
+            }
+        });
+    }
+
+    if (merger)
+    {
+        merger->Run(callback, _stopConsuming);
+    }
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    graphs.clear();
 }
 
 void LttngConsumerImpl::StopConsuming()
@@ -47,6 +320,272 @@ void LttngConsumerImpl::StopConsuming()
     _stopConsuming = true;
 }
 
+LttngConsumerImpl::TraceGraph& LttngConsumerImpl::GetCallerGraph()
+{
+    if (!_callerGraph)
+    {
+        if (_options.ShardCount > 1 ||
+            (_offline && _options.OfflineWorkerCount > 1))
+        {
+            throw std::invalid_argument(
+                "Can't run the graph on the caller's thread with shards or "
+                "offline workers");
+        }
+
+        // No callback is set when a consumer destroyed mid-trace tears the
+        // graph down, and its sink flushes with nobody left to deliver to
+        _callerOutput = [this](LttngEventBatch& batch) {
+            if (_callerCallback != nullptr)
+            {
+                (*_callerCallback)(batch);
+            }
+        };
+
+        _callerGraph = std::make_unique<TraceGraph>();
+        CreateGraph(*_callerGraph, _callerOutput);
+    }
+
+    return *_callerGraph;
+}
+
+void LttngConsumerImpl::FinishCallerGraph()
+{
+    if ((_callerGraphFinished || _stopConsuming) && _callerGraph)
+    {
+        _callerGraph.reset();
+        _callerGraphFinished = true;
+    }
+}
+
+bt_graph_run_once_status LttngConsumerImpl::RunCallerGraphOnce()
+{
+    bt_graph_run_once_status status =
+        bt_graph_run_once(GetCallerGraph().Graph.Get());
+    if (status == BT_GRAPH_RUN_ONCE_STATUS_END)
+    {
+        _callerGraphFinished = true;
+        return status;
+    }
+
+    bool running = status == BT_GRAPH_RUN_ONCE_STATUS_OK ||
+                   status == BT_GRAPH_RUN_ONCE_STATUS_AGAIN;
+    if (!running)
+    {
+        std::cerr << "Final graph status: " << status << std::endl;
+    }
+    FAIL_FAST_IF(!running);
+
+    return status;
+}
+
+bool LttngConsumerImpl::NextBatch(
+    LttngEventBatch& batch,
+    size_t maxEvents,
+    std::chrono::milliseconds timeout)
+{
+    if (!_pullCallback)
+    {
+        // Swapping leaves the sink the buffers of events already handed out
+        _pullCallback = [this](LttngEventBatch& decoded) {
+            for (jsonbuilder::JsonBuilder& event : decoded)
+            {
+                _pulled.EmplaceBack().swap(event);
+            }
+        };
+    }
+
+    batch.Clear();
+    _inFlight.Attach(batch);
+
+    _callerCallback = &_pullCallback;
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (_pulledIndex == _pulled.size() && !_callerGraphFinished &&
+           !_stopConsuming)
+    {
+        bt_graph_run_once_status status = RunCallerGraphOnce();
+        if (status == BT_GRAPH_RUN_ONCE_STATUS_END)
+        {
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+        {
+            break;
+        }
+
+        if (status == BT_GRAPH_RUN_ONCE_STATUS_AGAIN)
+        {
+            std::this_thread::sleep_for(std::min<std::chrono::nanoseconds>(
+                _pollInterval, deadline - now));
+        }
+    }
+
+    FinishCallerGraph();
+    _callerCallback = nullptr;
+
+    while (batch.size() < maxEvents && _pulledIndex < _pulled.size())
+    {
+        batch.EmplaceBack().swap(_pulled[_pulledIndex++]);
+    }
+
+    if (_pulledIndex == _pulled.size())
+    {
+        _pulled.Clear();
+        _pulledIndex = 0;
+    }
+
+    return !batch.empty() || !(_callerGraphFinished || _stopConsuming);
+}
+
+int LttngConsumerImpl::GetPollFd()
+{
+    if (_pollFd < 0)
+    {
+        // Fails early for options the caller's graph doesn't support
+        GetCallerGraph();
+
+        _pollFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (_pollFd < 0)
+        {
+            throw std::system_error(
+                errno, std::generic_category(), "timerfd_create");
+        }
+
+        ArmPollFd(std::chrono::nanoseconds{ 0 });
+    }
+
+    return _pollFd;
+}
+
+void LttngConsumerImpl::ArmPollFd(std::chrono::nanoseconds delay)
+{
+    // A zero it_value would disarm the timer instead
+    delay = std::max(delay, std::chrono::nanoseconds{ 1 });
+
+    itimerspec timer{};
+    timer.it_value.tv_sec =
+        std::chrono::duration_cast<std::chrono::seconds>(delay).count();
+    timer.it_value.tv_nsec = (delay % std::chrono::seconds{ 1 }).count();
+
+    FAIL_FAST_IF(timerfd_settime(_pollFd, 0, &timer, nullptr) != 0);
+}
+
+bool LttngConsumerImpl::ProcessAvailable(
+    const std::function<void(LttngEventBatch&)>& callback)
+{
+    if (_pollFd >= 0)
+    {
+        // Consumes the expiration so the fd stops being readable. Nothing
+        // to read just means the caller didn't wait for it.
+        uint64_t expirations = 0;
+        ssize_t bytesRead = read(_pollFd, &expirations, sizeof(expirations));
+        FAIL_FAST_IF(bytesRead < 0 && errno != EAGAIN);
+    }
+
+    _callerCallback = &callback;
+
+    // A recorded trace never blocks, so it is read a slice at a time to
+    // leave the event loop its other work
+    auto sliceEnd = std::chrono::steady_clock::now() + _pollInterval;
+
+    bt_graph_run_once_status status = BT_GRAPH_RUN_ONCE_STATUS_AGAIN;
+    while (!_callerGraphFinished && !_stopConsuming)
+    {
+        status = RunCallerGraphOnce();
+        if (status != BT_GRAPH_RUN_ONCE_STATUS_OK ||
+            std::chrono::steady_clock::now() >= sliceEnd)
+        {
+            break;
+        }
+    }
+
+    FinishCallerGraph();
+    _callerCallback = nullptr;
+
+    if (_callerGraphFinished || _stopConsuming)
+    {
+        return false;
+    }
+
+    if (_pollFd >= 0)
+    {
+        // Come back right away while there is more to read
+        ArmPollFd(
+            status == BT_GRAPH_RUN_ONCE_STATUS_OK ?
+                std::chrono::nanoseconds{ 0 } :
+                _pollInterval);
+    }
+
+    return true;
+}
+
+void LttngConsumerImpl::AddTypedEvent(
+    std::shared_ptr<TypedEventHandler> handler)
+{
+    // A handler fills a single struct, so only one graph may call it
+    if (_offline && _options.OfflineWorkerCount > 1)
+    {
+        throw std::invalid_argument(
+            "Typed events can't be combined with offline workers");
+    }
+
+    for (const auto& field : handler->Fields())
+    {
+        FieldPath path(field.first);
+    }
+
+    _typedHandlers.push_back(std::move(handler));
+}
+
+void LttngConsumerImpl::Subscribe(LttngSubscription subscription)
+{
+    // Subscribers are served on the graph thread, from a single graph
+    if (_options.ShardCount > 1 || _options.Aggregation.Interval.count() > 0 ||
+        (_offline && _options.OfflineWorkerCount > 1))
+    {
+        throw std::invalid_argument(
+            "Subscriptions can't be combined with shards, aggregation or "
+            "offline workers");
+    }
+
+    if (!subscription.Callback)
+    {
+        throw std::invalid_argument("Subscription has no callback");
+    }
+
+    // Throw for a malformed filter or unknown field before any graph is
+    // built
+    if (!subscription.Filter.empty())
+    {
+        EventFilter filter(subscription.Filter);
+    }
+
+    SubscriberFanOut::GetDecodeScopes(subscription);
+
+    _subscriptions.push_back(
+        std::make_shared<const LttngSubscription>(std::move(subscription)));
+}
+
+LttngConsumerStatistics LttngConsumerImpl::GetStatistics() const
+{
+    LttngConsumerStatistics statistics = _counters.Snapshot();
+    _inFlight.Snapshot(statistics);
+    return statistics;
+}
+
+std::string_view LttngConsumerImpl::LookupInternedString(uint32_t id) const
+{
+    return _interner.Lookup(id);
+}
+
+std::vector<LttngLatencyHistogram>
+LttngConsumerImpl::GetLatencyHistograms() const
+{
+    return _latencyTracker.Snapshot();
+}
+
 static void CheckBtError(int32_t status)
 {
     switch (status)
@@ -60,59 +599,159 @@ static void CheckBtError(int32_t status)
     }
 }
 
-void LttngConsumerImpl::CreateGraph(
-    std::function<void(jsonbuilder::JsonBuilder&&)>& callback)
+// Seconds since the epoch, the most precise format the trimmer accepts
+static std::string FormatTrimmerTime(std::chrono::system_clock::time_point time)
 {
-    bt_logging_set_global_level(BT_LOGGING_LEVEL_WARNING);
-
-    _graph = bt_graph_create(0);
+    int64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              time.time_since_epoch())
+                              .count();
+
+    char formatted[32];
+    snprintf(
+        formatted,
+        sizeof(formatted),
+        "%s%lld.%09lld",
+        nanoseconds < 0 ? "-" : "",
+        static_cast<long long>(std::abs(nanoseconds / 1000000000)),
+        static_cast<long long>(std::abs(nanoseconds % 1000000000)));
+
+    return formatted;
+}
 
-    BabelPtr<const bt_plugin> ctfPlugin;
+bool LttngConsumerImpl::CreateGraph(
+    TraceGraph& graph,
+    std::function<void(LttngEventBatch&)>& callback)
+{
+    bt_logging_set_global_level(BT_LOGGING_LEVEL_WARNING);
 
-    bt_plugin_find_status pluginFindStatus = bt_plugin_find(
-        "ctf", BT_FALSE, BT_FALSE, BT_TRUE, BT_FALSE, BT_TRUE, &ctfPlugin);
-    CheckBtError(pluginFindStatus);
+    graph.Consumer = this;
+    graph.Graph = bt_graph_create(0);
 
-    const bt_component_class_source* lttngLiveClass =
-        bt_plugin_borrow_source_component_class_by_name_const(
-            ctfPlugin.Get(), "lttng-live");
+    if (_synthetic)
+    {
+        BabelPtr<const bt_component_class_source> syntheticClass =
+            GetSyntheticSourceComponentClass();
+
+        CheckBtError(bt_graph_add_source_component_with_initialize_method_data(
+            graph.Graph.Get(),
+            syntheticClass.Get(),
+            "syntheticInput",
+            nullptr,
+            &_options.Synthetic,
+            BT_LOGGING_LEVEL_WARNING,
+            &graph.Source));
+    }
+    else
+    {
+        BabelPtr<const bt_plugin> ctfPlugin;
+
+        bt_plugin_find_status pluginFindStatus = bt_plugin_find(
+            "ctf", BT_FALSE, BT_FALSE, BT_TRUE, BT_FALSE, BT_TRUE, &ctfPlugin);
+        CheckBtError(pluginFindStatus);
+
+        // src.ctf.fs reads the packet index LTTng writes next to each stream
+        // file, or builds one from the packet headers when it is missing, so
+        // a trimmer downstream can seek straight to the packets it needs
+        const bt_component_class_source* sourceClass =
+            bt_plugin_borrow_source_component_class_by_name_const(
+                ctfPlugin.Get(), _offline ? "fs" : "lttng-live");
+
+        BabelPtr<bt_value> urlArray = bt_value_array_create();
+        CheckBtError(bt_value_array_append_string_element(
+            urlArray.Get(), _listeningUrl.c_str()));
+
+        BabelPtr<bt_value> paramsMap = bt_value_map_create();
+        CheckBtError(bt_value_map_insert_entry(
+            paramsMap.Get(), "inputs", urlArray.Get()));
+        if (!_offline)
+        {
+            CheckBtError(bt_value_map_insert_string_entry(
+                paramsMap.Get(), "session-not-found-action", "continue"));
+        }
 
-    BabelPtr<bt_value> urlArray = bt_value_array_create();
-    CheckBtError(bt_value_array_append_string_element(
-        urlArray.Get(), std::string{ _listeningUrl }.c_str()));
+        CheckBtError(bt_graph_add_source_component(
+            graph.Graph.Get(),
+            sourceClass,
+            _offline ? "fsInput" : "liveInput",
+            paramsMap.Get(),
+            BT_LOGGING_LEVEL_WARNING,
+            &graph.Source));
+    }
 
-    BabelPtr<bt_value> paramsMap = bt_value_map_create();
-    CheckBtError(
-        bt_value_map_insert_entry(paramsMap.Get(), "inputs", urlArray.Get()));
-    CheckBtError(bt_value_map_insert_string_entry(
-        paramsMap.Get(), "session-not-found-action", "continue"));
+    // Sharding by stream only keeps per-stream order, so there is nothing
+    // to merge. Keyed shards keep whatever order the graph produces.
+    bool shardByStream = _options.ShardCount > 1 && _options.ShardKey.empty();
+    MessageOrdering ordering =
+        shardByStream ? MessageOrdering::Unordered : _options.Ordering;
 
-    CheckBtError(bt_graph_add_source_component(
-        _graph.Get(),
-        lttngLiveClass,
-        "liveInput",
-        paramsMap.Get(),
-        BT_LOGGING_LEVEL_WARNING,
-        &_lttngLiveSource));
+    // Create filter component, unless the sink reads the source ports itself
+    if (ordering == MessageOrdering::Muxer || TrimsSourcePorts())
+    {
+        bt_plugin_find_status pluginFindStatus = bt_plugin_find(
+            "utils",
+            BT_FALSE,
+            BT_FALSE,
+            BT_TRUE,
+            BT_FALSE,
+            BT_TRUE,
+            &graph.UtilsPlugin);
+        CheckBtError(pluginFindStatus);
+    }
 
-    // Create filter component
-    BabelPtr<const bt_plugin> utilsPlugin;
+    // One trimmer per source port rather than one after the muxer, so each
+    // seeks its own stream even when nothing merges them. They all share
+    // the class and parameters found here.
+    if (TrimsSourcePorts())
+    {
+        graph.TrimmerClass =
+            bt_plugin_borrow_filter_component_class_by_name_const(
+                graph.UtilsPlugin.Get(), "trimmer");
 
-    pluginFindStatus = bt_plugin_find(
-        "utils", BT_FALSE, BT_FALSE, BT_TRUE, BT_FALSE, BT_TRUE, &utilsPlugin);
-    CheckBtError(pluginFindStatus);
+        graph.TrimmerParams = bt_value_map_create();
+        if (_options.Begin)
+        {
+            CheckBtError(bt_value_map_insert_string_entry(
+                graph.TrimmerParams.Get(),
+                "begin",
+                FormatTrimmerTime(*_options.Begin).c_str()));
+        }
 
-    const bt_component_class_filter* muxerClass =
-        bt_plugin_borrow_filter_component_class_by_name_const(
-            utilsPlugin.Get(), "muxer");
+        if (_options.End)
+        {
+            CheckBtError(bt_value_map_insert_string_entry(
+                graph.TrimmerParams.Get(),
+                "end",
+                FormatTrimmerTime(*_options.End).c_str()));
+        }
+    }
 
-    CheckBtError(bt_graph_add_filter_component(
-        _graph.Get(),
-        muxerClass,
-        "muxer",
-        nullptr,
-        BT_LOGGING_LEVEL_WARNING,
-        &_muxerFilter));
+    if (ordering == MessageOrdering::Muxer)
+    {
+        const bt_component_class_filter* muxerClass =
+            bt_plugin_borrow_filter_component_class_by_name_const(
+                graph.UtilsPlugin.Get(), "muxer");
+
+        CheckBtError(bt_graph_add_filter_component(
+            graph.Graph.Get(),
+            muxerClass,
+            "muxer",
+            nullptr,
+            BT_LOGGING_LEVEL_WARNING,
+            &graph.MuxerFilter));
+    }
+    else if (ordering == MessageOrdering::TimestampMerge)
+    {
+        BabelPtr<const bt_component_class_filter> mergeFilterClass =
+            GetMergeFilterComponentClass();
+
+        CheckBtError(bt_graph_add_filter_component(
+            graph.Graph.Get(),
+            mergeFilterClass.Get(),
+            "merge",
+            nullptr,
+            BT_LOGGING_LEVEL_WARNING,
+            &graph.MuxerFilter));
+    }
 
     // Create sink component
     BabelPtr<const bt_component_class_sink> jsonBuilderSinkClass =
@@ -120,36 +759,81 @@ void LttngConsumerImpl::CreateGraph(
 
     JsonBuilderSinkInitParams jbInitParams;
     jbInitParams.OutputFunc = &callback;
+    jbInitParams.MultipleInputPorts = ordering == MessageOrdering::Unordered;
+    jbInitParams.ShardCount = _options.ShardCount;
+    jbInitParams.ShardKey = _options.ShardKey;
+    jbInitParams.Aggregation = _options.Aggregation;
+    if (!TrimsSourcePorts())
+    {
+        jbInitParams.Begin = _options.Begin;
+        jbInitParams.End = _options.End;
+    }
+    jbInitParams.Filter = _options.Filter;
+    jbInitParams.RateLimits = _options.RateLimits;
+    jbInitParams.Counters = &_counters;
+    jbInitParams.InFlight = &_inFlight;
+    jbInitParams.BudgetPolicy = _options.MemoryBudget.Policy;
+    jbInitParams.Interner = _options.InternStrings ? &_interner : nullptr;
+    jbInitParams.Latency = _options.TrackLatency ? &_latencyTracker : nullptr;
+    jbInitParams.TypedHandlers = _typedHandlers;
+    jbInitParams.Subscriptions = _subscriptions;
+    jbInitParams.Placement = _options.Placement;
+    jbInitParams.PlacementFailures = &_placementErrors;
+    jbInitParams.Capture = _options.Capture;
 
-    const bt_component_sink* jsonBuilderSink = nullptr;
     CheckBtError(bt_graph_add_sink_component_with_initialize_method_data(
-        _graph.Get(),
+        graph.Graph.Get(),
         jsonBuilderSinkClass.Get(),
         "jsonbuildersinkinst",
         nullptr,
         &jbInitParams,
         BT_LOGGING_LEVEL_INFO,
-        &jsonBuilderSink));
+        &graph.Sink));
 
     CheckBtError(bt_graph_add_source_component_output_port_added_listener(
-        _graph.Get(), SourceComponentOutputPortAddedListenerStatic, this, nullptr));
+        graph.Graph.Get(),
+        SourceComponentOutputPortAddedListenerStatic,
+        &graph,
+        nullptr));
+
+    // Wire up existing ports. The live source has a single "out" port while
+    // src.ctf.fs and the synthetic source have one per stream.
+    int64_t sourcePortCount =
+        bt_component_source_get_output_port_count(graph.Source);
+    FAIL_FAST_IF(sourcePortCount < 0);
+
+    bool hasPorts = false;
+    for (int64_t i = 0; i < sourcePortCount; i++)
+    {
+        if (i % graph.WorkerCount != graph.WorkerIndex)
+        {
+            continue;
+        }
 
-    // Wire up existing ports
-    const bt_port_output* lttngLiveSourceOutputPort =
-        bt_component_source_borrow_output_port_by_name_const(
-            _lttngLiveSource, "out");
-    const bt_port_input* muxerFilterInputPort =
-        bt_component_filter_borrow_input_port_by_name_const(_muxerFilter, "in0");
+        ConnectSourcePort(
+            graph,
+            bt_component_source_borrow_output_port_by_index_const(
+                graph.Source, i));
+        hasPorts = true;
+    }
 
-    const bt_port_output* muxerFilterOutputPort =
-        bt_component_filter_borrow_output_port_by_name_const(_muxerFilter, "out");
-    const bt_port_input* jsonBuilderSinkInputPort =
-        bt_component_sink_borrow_input_port_by_name_const(jsonBuilderSink, "in");
+    if (graph.MuxerFilter)
+    {
+        const bt_port_output* muxerFilterOutputPort =
+            bt_component_filter_borrow_output_port_by_name_const(
+                graph.MuxerFilter, "out");
+        const bt_port_input* jsonBuilderSinkInputPort =
+            bt_component_sink_borrow_input_port_by_name_const(
+                graph.Sink, "in");
+
+        CheckBtError(bt_graph_connect_ports(
+            graph.Graph.Get(),
+            muxerFilterOutputPort,
+            jsonBuilderSinkInputPort,
+            nullptr));
+    }
 
-    CheckBtError(bt_graph_connect_ports(
-        _graph.Get(), lttngLiveSourceOutputPort, muxerFilterInputPort, nullptr));
-    CheckBtError(bt_graph_connect_ports(
-        _graph.Get(), muxerFilterOutputPort, jsonBuilderSinkInputPort, nullptr));
+    return hasPorts;
 }
 
 bt_graph_listener_func_status
@@ -158,31 +842,94 @@ LttngConsumerImpl::SourceComponentOutputPortAddedListenerStatic(
     const bt_port_output* port,
     void* data)
 {
-    return static_cast<LttngConsumerImpl*>(data)
-        ->SourceComponentOutputPortAddedListener(component, port);
+    auto graph = static_cast<TraceGraph*>(data);
+    return graph->Consumer->SourceComponentOutputPortAddedListener(
+        *graph, component, port);
 }
 
 bt_graph_listener_func_status
 LttngConsumerImpl::SourceComponentOutputPortAddedListener(
+    TraceGraph& graph,
     const bt_component_source* component,
     const bt_port_output* port)
 {
-    FAIL_FAST_IF(component != _lttngLiveSource);
+    FAIL_FAST_IF(component != graph.Source);
+
+    // Sources whose ports are dealt out to workers have all of them by the
+    // time the listener is added
+    FAIL_FAST_IF(graph.WorkerCount != 1);
+
+    ConnectSourcePort(graph, port);
+    return BT_GRAPH_LISTENER_FUNC_STATUS_OK;
+}
+
+bool LttngConsumerImpl::TrimsSourcePorts() const
+{
+    return (_options.Begin || _options.End) && _offline && !_synthetic;
+}
+
+void LttngConsumerImpl::ConnectSourcePort(
+    TraceGraph& graph,
+    const bt_port_output* port)
+{
+    if (!TrimsSourcePorts())
+    {
+        CheckBtError(bt_graph_connect_ports(
+            graph.Graph.Get(),
+            port,
+            BorrowUnconnectedInputPort(graph),
+            nullptr));
+        return;
+    }
 
-    int64_t muxerInputPortCount =
-        bt_component_filter_get_input_port_count(_muxerFilter);
-    FAIL_FAST_IF(muxerInputPortCount < 0);
+    std::string trimmerName =
+        "trimmer" + std::to_string(graph.TrimmerCount++);
 
-    for (int64_t i = 0; i < muxerInputPortCount; i++)
+    const bt_component_filter* trimmer = nullptr;
+    CheckBtError(bt_graph_add_filter_component(
+        graph.Graph.Get(),
+        graph.TrimmerClass,
+        trimmerName.c_str(),
+        graph.TrimmerParams.Get(),
+        BT_LOGGING_LEVEL_WARNING,
+        &trimmer));
+
+    CheckBtError(bt_graph_connect_ports(
+        graph.Graph.Get(),
+        port,
+        bt_component_filter_borrow_input_port_by_name_const(trimmer, "in"),
+        nullptr));
+
+    CheckBtError(bt_graph_connect_ports(
+        graph.Graph.Get(),
+        bt_component_filter_borrow_output_port_by_name_const(trimmer, "out"),
+        BorrowUnconnectedInputPort(graph),
+        nullptr));
+}
+
+const bt_port_input*
+LttngConsumerImpl::BorrowUnconnectedInputPort(TraceGraph& graph)
+{
+    // Source ports feed the muxer when there is one, otherwise the sink
+    // directly. Both always keep one spare input port available.
+    int64_t inputPortCount =
+        graph.MuxerFilter ?
+            bt_component_filter_get_input_port_count(graph.MuxerFilter) :
+            bt_component_sink_get_input_port_count(graph.Sink);
+    FAIL_FAST_IF(inputPortCount < 0);
+
+    for (int64_t i = 0; i < inputPortCount; i++)
     {
         const bt_port_input* downstreamPort =
-            bt_component_filter_borrow_input_port_by_index_const(_muxerFilter, i);
+            graph.MuxerFilter ?
+                bt_component_filter_borrow_input_port_by_index_const(
+                    graph.MuxerFilter, i) :
+                bt_component_sink_borrow_input_port_by_index_const(
+                    graph.Sink, i);
 
         if (!bt_port_is_connected(bt_port_input_as_port_const(downstreamPort)))
         {
-            CheckBtError(bt_graph_connect_ports(
-                _graph.Get(), port, downstreamPort, nullptr));
-            return BT_GRAPH_LISTENER_FUNC_STATUS_OK;
+            return downstreamPort;
         }
     }
 
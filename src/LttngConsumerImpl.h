@@ -5,11 +5,25 @@
 
 #include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <vector>
+
+#include <lttng-consume/LttngConsumerOptions.h>
+#include <lttng-consume/LttngEventBatch.h>
+#include <lttng-consume/LttngSubscription.h>
+#include <lttng-consume/TypedEvent.h>
 
 #include "BabelPtr.h"
+#include "ConsumerCounters.h"
+#include "InFlightMemory.h"
+#include "LatencyTracker.h"
+#include "StringInterner.h"
+#include "ThreadPlacement.h"
 
 namespace jsonbuilder {
 class JsonBuilder;
@@ -22,33 +36,152 @@ class LttngConsumerImpl
   public:
     LttngConsumerImpl(
         std::string_view listeningUrl,
-        std::chrono::milliseconds pollInterval);
+        std::chrono::milliseconds pollInterval,
+        const LttngConsumerOptions& options);
+
+    ~LttngConsumerImpl();
 
     void StartConsuming(std::function<void(jsonbuilder::JsonBuilder&&)> callback);
 
+    void StartConsumingBatches(std::function<void(LttngEventBatch&)> callback);
+
     void StopConsuming();
 
+    bool NextBatch(
+        LttngEventBatch& batch,
+        size_t maxEvents,
+        std::chrono::milliseconds timeout);
+
+    int GetPollFd();
+
+    bool ProcessAvailable(
+        const std::function<void(LttngEventBatch&)>& callback);
+
+    void AddTypedEvent(std::shared_ptr<TypedEventHandler> handler);
+
+    void Subscribe(LttngSubscription subscription);
+
+    LttngConsumerStatistics GetStatistics() const;
+
+    std::string_view LookupInternedString(uint32_t id) const;
+
+    std::vector<LttngLatencyHistogram> GetLatencyHistograms() const;
+
   private:
+    // One babeltrace graph and the components wired into it. Offline
+    // workers each build their own.
+    struct TraceGraph
+    {
+        LttngConsumerImpl* Consumer = nullptr;
+        BabelPtr<bt_graph> Graph;
+        // src.ctf.lttng-live, src.ctf.fs for a recorded trace, or the
+        // synthetic source
+        const bt_component_source* Source = nullptr;
+        // utils.muxer or our own merge filter, depending on _options.Ordering
+        const bt_component_filter* MuxerFilter = nullptr;
+        const bt_component_sink* Sink = nullptr;
+
+        // Looked up once per graph, when TrimsSourcePorts()
+        BabelPtr<const bt_plugin> UtilsPlugin;
+        const bt_component_class_filter* TrimmerClass = nullptr;
+        BabelPtr<bt_value> TrimmerParams;
+        uint32_t TrimmerCount = 0;
+
+        // Source ports are dealt out round robin, and this graph only
+        // connects those whose index modulo WorkerCount is WorkerIndex
+        uint32_t WorkerIndex = 0;
+        uint32_t WorkerCount = 1;
+    };
+
     static bt_graph_listener_func_status
     SourceComponentOutputPortAddedListenerStatic(
         const bt_component_source* component,
         const bt_port_output* port,
         void* data);
 
-    void CreateGraph(std::function<void(jsonbuilder::JsonBuilder&&)>& callback);
+    // Returns false when none of the source ports went to this graph
+    bool CreateGraph(
+        TraceGraph& graph,
+        std::function<void(LttngEventBatch&)>& callback);
+
+    // Returns at the end of a recorded trace or once asked to stop
+    void RunGraph(TraceGraph& graph);
+
+    void RunOfflineWorkers(std::function<void(LttngEventBatch&)>& callback);
 
     bt_graph_listener_func_status SourceComponentOutputPortAddedListener(
+        TraceGraph& graph,
         const bt_component_source* component,
         const bt_port_output* port);
 
+    // Whether a time window is applied by trimmers on the source ports. A
+    // trimmer has to seek its upstream first, which only src.ctf.fs can
+    // do, so otherwise the sink checks the window on each event instead.
+    bool TrimsSourcePorts() const;
+
+    // Connects a source port to the rest of the graph, through a trimmer
+    // when TrimsSourcePorts()
+    void ConnectSourcePort(TraceGraph& graph, const bt_port_output* port);
+
+    const bt_port_input* BorrowUnconnectedInputPort(TraceGraph& graph);
+
+    // Graph run by NextBatch() or ProcessAvailable() on the caller's thread,
+    // built on first use. Throws std::invalid_argument with shards or
+    // offline workers, which would decode on threads of their own.
+    TraceGraph& GetCallerGraph();
+
+    // Tears the caller's graph down once it finished or was asked to stop,
+    // while the callback of NextBatch() or ProcessAvailable() is still set,
+    // so what its sink holds back, e.g. the last aggregation window, still
+    // reaches the caller
+    void FinishCallerGraph();
+
+    // One sink iteration of the caller's graph. Sets _callerGraphFinished
+    // at the end of a recorded trace.
+    bt_graph_run_once_status RunCallerGraphOnce();
+
+    // Makes the poll fd readable after delay, or right away when zero
+    void ArmPollFd(std::chrono::nanoseconds delay);
+
   private:
     std::string _listeningUrl;
+    // A recorded trace directory rather than an lttng-live URL. Synthetic
+    // events are read the same way, since they may run out.
+    bool _offline;
+    bool _synthetic;
     std::chrono::milliseconds _pollInterval;
+    LttngConsumerOptions _options;
     std::atomic<bool> _stopConsuming;
+    ConsumerCounters _counters;
+    InFlightMemory _inFlight;
+
+    // Set by the threads StartConsuming() starts, and stops their graphs
+    PlacementErrors _placementErrors;
+
+    // Outlives every graph so ids stay valid across StartConsuming() calls
+    StringInterner _interner;
+    LatencyTracker _latencyTracker;
+
+    std::vector<std::shared_ptr<TypedEventHandler>> _typedHandlers;
+    std::vector<std::shared_ptr<const LttngSubscription>> _subscriptions;
+
+    // NextBatch() has the sink append what it decodes to _pulled, which is
+    // handed out from _pulledIndex on
+    std::function<void(LttngEventBatch&)> _pullCallback;
+    LttngEventBatch _pulled;
+    size_t _pulledIndex = 0;
+
+    // timerfd returned by GetPollFd(), or -1
+    int _pollFd = -1;
 
-    BabelPtr<bt_graph> _graph;
-    const bt_component_source* _lttngLiveSource = nullptr;
-    const bt_component_filter* _muxerFilter = nullptr;
+    // The caller's graph delivers to _callerOutput, which forwards to the
+    // callback of the NextBatch() or ProcessAvailable() call running it.
+    // Declared last so the graph is torn down before anything its sink
+    // refers to.
+    const std::function<void(LttngEventBatch&)>* _callerCallback = nullptr;
+    std::function<void(LttngEventBatch&)> _callerOutput;
+    bool _callerGraphFinished = false;
+    std::unique_ptr<TraceGraph> _callerGraph;
 };
 
 }
@@ -0,0 +1,34 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <lttng-consume/LttngEventBatch.h>
+
+#include "InFlightMemory.h"
+
+using namespace jsonbuilder;
+
+namespace LttngConsume {
+
+std::shared_ptr<JsonBuilder> LttngEventBatch::Hold(size_t index)
+{
+    if (!_account)
+    {
+        return std::make_shared<JsonBuilder>(std::move(_builders[index]));
+    }
+
+    uint64_t bytes = _builders[index].buffer_capacity();
+    auto event = std::make_unique<JsonBuilder>(std::move(_builders[index]));
+
+    // Charged before the pointer exists, as its deleter releases the bytes
+    // even if it fails to allocate
+    _account->Charge(bytes);
+
+    return std::shared_ptr<JsonBuilder>(
+        event.release(),
+        [account = _account, bytes](JsonBuilder* event) {
+            delete event;
+            account->Release(bytes);
+        });
+}
+
+}
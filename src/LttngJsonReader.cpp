@@ -3,6 +3,7 @@
 
 #include "LttngJsonReader.h"
 
+#include <algorithm>
 #include <bitset>
 #include <chrono>
 
@@ -16,11 +17,42 @@ using namespace jsonbuilder;
 
 namespace LttngConsume {
 
+// How strings are added while decoding one event
+struct FieldDecodeContext
+{
+    // Set when strings that repeat across events are added as ids
+    StringInterner::LocalCache* Interner = nullptr;
+
+    // Set while adding a scope whose plain strings are interned too, and
+    // not only its enum labels
+    bool InternStrings = false;
+
+    EnumLabelCache* EnumLabels = nullptr;
+};
+
 void AddField(
     JsonBuilder& builder,
     JsonBuilder::iterator itr,
     std::string_view fieldName,
-    const bt_field* field);
+    const bt_field* field,
+    FieldDecodeContext context);
+
+void AddString(
+    JsonBuilder& builder,
+    JsonBuilder::iterator itr,
+    std::string_view fieldName,
+    std::string_view val,
+    StringInterner::LocalCache* interner)
+{
+    if (interner)
+    {
+        builder.push_back(itr, fieldName, interner->Intern(val));
+    }
+    else
+    {
+        builder.push_back(itr, fieldName, val);
+    }
+}
 
 void AddTimestamp(JsonBuilder& builder, const bt_clock_snapshot* clock)
 {
@@ -38,11 +70,12 @@ void AddTimestamp(JsonBuilder& builder, const bt_clock_snapshot* clock)
 void AddEventName(
     JsonBuilder& builder,
     JsonIterator metadataItr,
-    const bt_event_class* eventClass)
+    const bt_event_class* eventClass,
+    StringInterner::LocalCache* interner)
 {
     std::string eventName{ bt_event_class_get_name(eventClass) };
 
-    builder.push_back(metadataItr, "lttngName", eventName);
+    AddString(builder, metadataItr, "lttngName", eventName, interner);
 
     // Replace the : separating provider and eventname with .
     std::replace(eventName.begin(), eventName.end(), ':', '.');
@@ -168,61 +201,53 @@ void AddFieldSignedEnum(
     JsonBuilder& builder,
     JsonBuilder::iterator itr,
     std::string_view fieldName,
-    const bt_field* field)
+    const bt_field* field,
+    FieldDecodeContext context)
 {
-    const char* const* labels = nullptr;
-    uint64_t labelsCount = 0;
-    bt_field_enumeration_signed_get_mapping_labels(field, &labels, &labelsCount);
+    int64_t val = bt_field_integer_signed_get_value(field);
+    std::string_view label = context.EnumLabels->GetSignedLabel(
+        bt_field_borrow_class_const(field), val);
 
-    if (labelsCount > 0)
-    {
-        builder.push_back(itr, fieldName, labels[0]);
-    }
-    else
-    {
-        int64_t val = bt_field_integer_signed_get_value(field);
-        builder.push_back(itr, fieldName, std::to_string(val));
-    }
+    AddString(builder, itr, fieldName, label, context.Interner);
 }
 
 void AddFieldUnsignedEnum(
     JsonBuilder& builder,
     JsonBuilder::iterator itr,
     std::string_view fieldName,
-    const bt_field* field)
+    const bt_field* field,
+    FieldDecodeContext context)
 {
-    const char* const* labels = nullptr;
-    uint64_t labelsCount = 0;
-    bt_field_enumeration_unsigned_get_mapping_labels(field, &labels, &labelsCount);
+    uint64_t val = bt_field_integer_unsigned_get_value(field);
+    std::string_view label = context.EnumLabels->GetUnsignedLabel(
+        bt_field_borrow_class_const(field), val);
 
-    if (labelsCount > 0)
-    {
-        builder.push_back(itr, fieldName, labels[0]);
-    }
-    else
-    {
-        uint64_t val = bt_field_integer_unsigned_get_value(field);
-        builder.push_back(itr, fieldName, std::to_string(val));
-    }
+    AddString(builder, itr, fieldName, label, context.Interner);
 }
 
 void AddFieldString(
     JsonBuilder& builder,
     JsonBuilder::iterator itr,
     std::string_view fieldName,
-    const bt_field* field)
+    const bt_field* field,
+    FieldDecodeContext context)
 {
     const char* val = bt_field_string_get_value(field);
     uint64_t len = bt_field_string_get_length(field);
-    builder.push_back(
-        itr, fieldName, std::string_view{ val, static_cast<size_t>(len) });
+    AddString(
+        builder,
+        itr,
+        fieldName,
+        std::string_view{ val, static_cast<size_t>(len) },
+        context.InternStrings ? context.Interner : nullptr);
 }
 
 void AddFieldStruct(
     JsonBuilder& builder,
     JsonBuilder::iterator itr,
     std::string_view fieldName,
-    const bt_field* field)
+    const bt_field* field,
+    FieldDecodeContext context)
 {
     auto structItr = builder.push_back(itr, fieldName, JsonObject);
 
@@ -240,7 +265,7 @@ void AddFieldStruct(
         const bt_field* structField =
             bt_field_structure_borrow_member_field_by_index_const(field, i);
 
-        AddField(builder, structItr, structFieldName, structField);
+        AddField(builder, structItr, structFieldName, structField, context);
     }
 }
 
@@ -248,7 +273,8 @@ void AddFieldArray(
     JsonBuilder& builder,
     JsonBuilder::iterator itr,
     std::string_view fieldName,
-    const bt_field* field)
+    const bt_field* field,
+    FieldDecodeContext context)
 {
     auto arrayItr = builder.push_back(itr, fieldName, JsonArray);
 
@@ -258,7 +284,7 @@ void AddFieldArray(
         const bt_field* elementField =
             bt_field_array_borrow_element_field_by_index_const(field, i);
 
-        AddField(builder, arrayItr, {}, elementField);
+        AddField(builder, arrayItr, {}, elementField, context);
     }
 }
 
@@ -266,12 +292,13 @@ void AddFieldOption(
     JsonBuilder& builder,
     JsonBuilder::iterator itr,
     std::string_view fieldName,
-    const bt_field* field)
+    const bt_field* field,
+    FieldDecodeContext context)
 {
     const bt_field* optionData = bt_field_option_borrow_field_const(field);
     if (optionData)
     {
-        AddField(builder, itr, fieldName, field);
+        AddField(builder, itr, fieldName, field, context);
     }
 }
 
@@ -279,7 +306,8 @@ void AddFieldVariant(
     JsonBuilder& builder,
     JsonBuilder::iterator itr,
     std::string_view fieldName,
-    const bt_field* field)
+    const bt_field* field,
+    FieldDecodeContext context)
 {
     const bt_field_class* fieldClass = bt_field_borrow_class_const(field);
 
@@ -300,7 +328,7 @@ void AddFieldVariant(
     variantFieldName += "_";
     variantFieldName += optionName;
 
-    AddField(builder, itr, variantFieldName, selectedOptionField);
+    AddField(builder, itr, variantFieldName, selectedOptionField, context);
 }
 
 bool StartsWith(std::string_view str, std::string_view queryPrefix)
@@ -327,7 +355,8 @@ void AddField(
     JsonBuilder& builder,
     JsonBuilder::iterator itr,
     std::string_view fieldName,
-    const bt_field* field)
+    const bt_field* field,
+    FieldDecodeContext context)
 {
     // Skip added '_foo_sequence_field_length' type fields
     if (StartsWith(fieldName, "_") && EndsWith(fieldName, "_length"))
@@ -351,10 +380,10 @@ void AddField(
         AddFieldSignedInteger(builder, itr, fieldName, field);
         break;
     case BT_FIELD_CLASS_TYPE_UNSIGNED_ENUMERATION:
-        AddFieldUnsignedEnum(builder, itr, fieldName, field);
+        AddFieldUnsignedEnum(builder, itr, fieldName, field, context);
         break;
     case BT_FIELD_CLASS_TYPE_SIGNED_ENUMERATION:
-        AddFieldSignedEnum(builder, itr, fieldName, field);
+        AddFieldSignedEnum(builder, itr, fieldName, field, context);
         break;
     case BT_FIELD_CLASS_TYPE_SINGLE_PRECISION_REAL:
         AddFieldFloat(builder, itr, fieldName, field);
@@ -363,40 +392,47 @@ void AddField(
         AddFieldDouble(builder, itr, fieldName, field);
         break;
     case BT_FIELD_CLASS_TYPE_STRING:
-        AddFieldString(builder, itr, fieldName, field);
+        AddFieldString(builder, itr, fieldName, field, context);
         break;
     case BT_FIELD_CLASS_TYPE_STRUCTURE:
-        AddFieldStruct(builder, itr, fieldName, field);
+        AddFieldStruct(builder, itr, fieldName, field, context);
         break;
     case BT_FIELD_CLASS_TYPE_STATIC_ARRAY:
     case BT_FIELD_CLASS_TYPE_DYNAMIC_ARRAY_WITHOUT_LENGTH_FIELD:
     case BT_FIELD_CLASS_TYPE_DYNAMIC_ARRAY_WITH_LENGTH_FIELD:
-        AddFieldArray(builder, itr, fieldName, field);
+        AddFieldArray(builder, itr, fieldName, field, context);
         break;
     case BT_FIELD_CLASS_TYPE_OPTION_WITHOUT_SELECTOR_FIELD:
     case BT_FIELD_CLASS_TYPE_OPTION_WITH_BOOL_SELECTOR_FIELD:
     case BT_FIELD_CLASS_TYPE_OPTION_WITH_UNSIGNED_INTEGER_SELECTOR_FIELD:
     case BT_FIELD_CLASS_TYPE_OPTION_WITH_SIGNED_INTEGER_SELECTOR_FIELD:
-        AddFieldOption(builder, itr, fieldName, field);
+        AddFieldOption(builder, itr, fieldName, field, context);
         break;
     case BT_FIELD_CLASS_TYPE_VARIANT_WITHOUT_SELECTOR_FIELD:
     case BT_FIELD_CLASS_TYPE_VARIANT_WITH_UNSIGNED_INTEGER_SELECTOR_FIELD:
     case BT_FIELD_CLASS_TYPE_VARIANT_WITH_SIGNED_INTEGER_SELECTOR_FIELD:
-        AddFieldVariant(builder, itr, fieldName, field);
+        AddFieldVariant(builder, itr, fieldName, field, context);
         break;
     default:
         FAIL_FAST_IF(true);
     }
 }
 
-void AddPacketContext(JsonBuilder& builder, const bt_event* event)
+void AddPacketContext(
+    JsonBuilder& builder,
+    const bt_event* event,
+    FieldDecodeContext context)
 {
     const bt_packet* packet = bt_event_borrow_packet_const(event);
     const bt_field* packetContext = bt_packet_borrow_context_field_const(packet);
-    AddFieldStruct(builder, builder.root(), "packetContext", packetContext);
+    AddFieldStruct(
+        builder, builder.root(), "packetContext", packetContext, context);
 }
 
-void AddEventHeader(JsonBuilder& builder, const bt_event* event)
+void AddEventHeader(
+    JsonBuilder& builder,
+    const bt_event* event,
+    StringInterner::LocalCache* interner)
 {
     const bt_packet* packet = bt_event_borrow_packet_const(event);
     const bt_stream* stream = bt_packet_borrow_stream_const(packet);
@@ -411,7 +447,7 @@ void AddEventHeader(JsonBuilder& builder, const bt_event* event)
             traceName = "Unknown";
         }
 
-        builder.push_back(itr, "trace", traceName);
+        AddString(builder, itr, "trace", traceName, interner);
 
         uint64_t count = bt_trace_get_environment_entry_count(trace);
         for (uint64_t i = 0; i < count; i++)
@@ -426,7 +462,10 @@ void AddEventHeader(JsonBuilder& builder, const bt_event* event)
     }
 }
 
-void AddStreamEventContext(JsonBuilder& builder, const bt_event* event)
+void AddStreamEventContext(
+    JsonBuilder& builder,
+    const bt_event* event,
+    FieldDecodeContext context)
 {
     const bt_field* streamEventContext =
         bt_event_borrow_common_context_field_const(event);
@@ -434,49 +473,116 @@ void AddStreamEventContext(JsonBuilder& builder, const bt_event* event)
     if (streamEventContext)
     {
         AddFieldStruct(
-            builder, builder.root(), "streamEventContext", streamEventContext);
+            builder,
+            builder.root(),
+            "streamEventContext",
+            streamEventContext,
+            context);
     }
 }
 
-void AddEventContext(JsonBuilder& builder, const bt_event* event)
+void AddEventContext(
+    JsonBuilder& builder,
+    const bt_event* event,
+    FieldDecodeContext context)
 {
     const bt_field* eventContext =
         bt_event_borrow_specific_context_field_const(event);
 
     if (eventContext)
     {
-        AddFieldStruct(builder, builder.root(), "eventContext", eventContext);
+        AddFieldStruct(
+            builder, builder.root(), "eventContext", eventContext, context);
     }
 }
 
-void AddPayload(JsonBuilder& builder, const bt_event* event)
+void AddPayload(
+    JsonBuilder& builder,
+    const bt_event* event,
+    FieldDecodeContext context)
 {
     const bt_field* payloadStruct = bt_event_borrow_payload_field_const(event);
-    AddFieldStruct(builder, builder.root(), "data", payloadStruct);
+    AddFieldStruct(builder, builder.root(), "data", payloadStruct, context);
+}
+
+std::string GetEventName(const bt_event_class* eventClass)
+{
+    std::string eventName{ bt_event_class_get_name(eventClass) };
+
+    std::replace(eventName.begin(), eventName.end(), ':', '.');
+    eventName.resize(std::min(eventName.find(';'), eventName.size()));
+
+    return eventName;
+}
+
+LttngJsonReader::LttngJsonReader(StringInterner* interner)
+{
+    if (interner)
+    {
+        _internCache = std::make_unique<StringInterner::LocalCache>(*interner);
+    }
 }
 
 JsonBuilder LttngJsonReader::DecodeEvent(const bt_message* message)
 {
     JsonBuilder builder;
+    DecodeEvent(message, builder);
+
+    return builder;
+}
+
+void LttngJsonReader::SetStreamGeneration(uint64_t streamGeneration)
+{
+    _enumLabels.SetStreamGeneration(streamGeneration);
+}
 
+void LttngJsonReader::DecodeEvent(
+    const bt_message* message,
+    JsonBuilder& builder,
+    const DecodeScopes& scopes)
+{
     const bt_event* event = bt_message_event_borrow_event_const(message);
     const bt_event_class* eventClass = bt_event_borrow_class_const(event);
 
     auto metadataItr = builder.push_back(builder.root(), "metadata", JsonObject);
 
-    AddEventName(builder, metadataItr, eventClass);
+    StringInterner::LocalCache* interner = _internCache.get();
+
+    AddEventName(builder, metadataItr, eventClass, interner);
 
     const bt_clock_snapshot* clock =
         bt_message_event_borrow_default_clock_snapshot_const(message);
 
     AddTimestamp(builder, clock);
 
-    AddPacketContext(builder, event);
-    AddEventHeader(builder, event);
-    AddStreamEventContext(builder, event);
-    AddEventContext(builder, event);
-    AddPayload(builder, event);
+    // Packet and stream contexts hold per-process values such as procname,
+    // so their strings repeat. Elsewhere only enum labels are interned.
+    FieldDecodeContext contextScopes{ interner, true, &_enumLabels };
+    FieldDecodeContext eventScopes{ interner, false, &_enumLabels };
 
-    return builder;
+    if (scopes.PacketContext)
+    {
+        AddPacketContext(builder, event, contextScopes);
+    }
+
+    if (scopes.EventHeader)
+    {
+        AddEventHeader(builder, event, interner);
+    }
+
+    if (scopes.StreamEventContext)
+    {
+        AddStreamEventContext(builder, event, contextScopes);
+    }
+
+    if (scopes.EventContext)
+    {
+        AddEventContext(builder, event, eventScopes);
+    }
+
+    if (scopes.Payload)
+    {
+        AddPayload(builder, event, eventScopes);
+    }
 }
 }
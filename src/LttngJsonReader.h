@@ -3,16 +3,57 @@
 
 #pragma once
 
+#include <cstdint>
+#include <memory>
+#include <string>
+
 #include <jsonbuilder/JsonBuilder.h>
 
+#include "EnumLabelCache.h"
+#include "StringInterner.h"
+
+struct bt_event_class;
 struct bt_message;
 
 namespace LttngConsume {
 
+// Parts of an event DecodeEvent() adds besides its name, time and metadata
+struct DecodeScopes
+{
+    bool PacketContext = true;
+    bool EventHeader = true;
+    bool StreamEventContext = true;
+    bool EventContext = true;
+    bool Payload = true;
+};
+
 class LttngJsonReader
 {
   public:
+    // With an interner, strings that repeat across events (lttngName, the
+    // trace name, enum labels and packet or stream context strings) are
+    // added as JsonUInt ids of interner instead of as UTF-8 values
+    explicit LttngJsonReader(StringInterner* interner = nullptr);
+
     jsonbuilder::JsonBuilder DecodeEvent(const bt_message* message);
+
+    // Decodes into an empty builder, so its buffer can be reused
+    void DecodeEvent(
+        const bt_message* message,
+        jsonbuilder::JsonBuilder& builder,
+        const DecodeScopes& scopes = {});
+
+    // Forgets cached field classes once the generation moves on, since a
+    // stream has ended and its classes may be gone. See DecodeLane.
+    void SetStreamGeneration(uint64_t streamGeneration);
+
+  private:
+    std::unique_ptr<StringInterner::LocalCache> _internCache;
+    EnumLabelCache _enumLabels;
 };
 
+// The "name" DecodeEvent() gives events of this class: provider.event,
+// without any TraceLogging keyword suffix
+std::string GetEventName(const bt_event_class* eventClass);
+
 }
@@ -0,0 +1,487 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "MergeFilter.h"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <babeltrace2/babeltrace.h>
+
+#include "BabelPtr.h"
+#include "FailureHelpers.h"
+#include "TimestampHeap.h"
+
+namespace LttngConsume {
+
+class MergeFilter
+{
+  public:
+    bt_self_component_add_port_status AddInputPort(bt_self_component_filter* self);
+
+    bt_component_class_port_connected_method_status InputPortConnected(
+        bt_self_component_filter* self,
+        bt_self_component_port_input* port);
+
+    const std::vector<bt_self_component_port_input*>& ConnectedInputPorts() const
+    {
+        return _connectedInputPorts;
+    }
+
+  public:
+    static constexpr const char* c_inputPortPrefix = "in";
+    static constexpr const char* c_outputPortName = "out";
+
+  private:
+    std::vector<bt_self_component_port_input*> _connectedInputPorts;
+    uint64_t _inputPortCount = 0;
+};
+
+bt_self_component_add_port_status
+MergeFilter::AddInputPort(bt_self_component_filter* self)
+{
+    std::string portName = c_inputPortPrefix;
+    portName += std::to_string(_inputPortCount);
+
+    bt_self_component_add_port_status status =
+        bt_self_component_filter_add_input_port(
+            self, portName.c_str(), nullptr, nullptr);
+    if (status == BT_SELF_COMPONENT_ADD_PORT_STATUS_OK)
+    {
+        _inputPortCount++;
+    }
+
+    return status;
+}
+
+bt_component_class_port_connected_method_status MergeFilter::InputPortConnected(
+    bt_self_component_filter* self,
+    bt_self_component_port_input* port)
+{
+    _connectedInputPorts.push_back(port);
+
+    // Always keep a spare port for the next source output port
+    bt_self_component_add_port_status addPortStatus = AddInputPort(self);
+    if (addPortStatus != BT_SELF_COMPONENT_ADD_PORT_STATUS_OK)
+    {
+        return static_cast<bt_component_class_port_connected_method_status>(
+            addPortStatus);
+    }
+
+    return BT_COMPONENT_CLASS_PORT_CONNECTED_METHOD_STATUS_OK;
+}
+
+class MergeFilterIterator
+{
+  public:
+    MergeFilterIterator(bt_self_message_iterator* self, MergeFilter& filter)
+        : _self(self)
+        , _filter(filter)
+    {}
+
+    ~MergeFilterIterator();
+
+    bool AttachNewInputPorts();
+
+    bt_message_iterator_class_next_method_status
+    Next(bt_message_array_const messages, uint64_t capacity, uint64_t* count);
+
+  private:
+    struct Upstream
+    {
+        BabelPtr<bt_message_iterator> MessageItr;
+
+        // Owned references to the last batch pulled from MessageItr
+        std::vector<const bt_message*> Messages;
+        size_t NextMessage = 0;
+
+        int64_t LastTimestamp = std::numeric_limits<int64_t>::min();
+    };
+
+    bt_message_iterator_next_status Refill(uint32_t index);
+
+    int64_t GetTimestamp(Upstream& upstream, const bt_message* message);
+
+  private:
+    bt_self_message_iterator* _self;
+    MergeFilter& _filter;
+    size_t _attachedPortCount = 0;
+
+    std::vector<Upstream> _upstreams;
+
+    // Upstreams that are neither ended nor in the heap because they have
+    // no buffered message. Merging can't proceed until they are refilled.
+    std::vector<uint32_t> _needRefill;
+
+    TimestampHeap _heap;
+};
+
+MergeFilterIterator::~MergeFilterIterator()
+{
+    for (Upstream& upstream : _upstreams)
+    {
+        for (size_t i = upstream.NextMessage; i < upstream.Messages.size(); i++)
+        {
+            bt_message_put_ref(upstream.Messages[i]);
+        }
+    }
+}
+
+bool MergeFilterIterator::AttachNewInputPorts()
+{
+    const std::vector<bt_self_component_port_input*>& ports =
+        _filter.ConnectedInputPorts();
+
+    for (; _attachedPortCount < ports.size(); _attachedPortCount++)
+    {
+        Upstream upstream;
+        bt_message_iterator_create_from_message_iterator_status status =
+            bt_message_iterator_create_from_message_iterator(
+                _self, ports[_attachedPortCount], &upstream.MessageItr);
+        if (status != BT_MESSAGE_ITERATOR_CREATE_FROM_MESSAGE_ITERATOR_STATUS_OK)
+        {
+            return false;
+        }
+        FAIL_FAST_IF(!upstream.MessageItr);
+
+        _needRefill.push_back(static_cast<uint32_t>(_upstreams.size()));
+        _upstreams.push_back(std::move(upstream));
+    }
+
+    return true;
+}
+
+static const bt_clock_snapshot* BorrowClockSnapshot(const bt_message* message)
+{
+    const bt_clock_snapshot* clock = nullptr;
+
+    switch (bt_message_get_type(message))
+    {
+    case BT_MESSAGE_TYPE_EVENT:
+        return bt_message_event_borrow_default_clock_snapshot_const(message);
+    case BT_MESSAGE_TYPE_MESSAGE_ITERATOR_INACTIVITY:
+        return bt_message_message_iterator_inactivity_borrow_clock_snapshot_const(
+            message);
+    case BT_MESSAGE_TYPE_PACKET_BEGINNING:
+    {
+        const bt_stream_class* streamClass =
+            bt_stream_borrow_class_const(bt_packet_borrow_stream_const(
+                bt_message_packet_beginning_borrow_packet_const(message)));
+        if (bt_stream_class_packets_have_beginning_default_clock_snapshot(
+                streamClass))
+        {
+            clock = bt_message_packet_beginning_borrow_default_clock_snapshot_const(
+                message);
+        }
+        return clock;
+    }
+    case BT_MESSAGE_TYPE_PACKET_END:
+    {
+        const bt_stream_class* streamClass =
+            bt_stream_borrow_class_const(bt_packet_borrow_stream_const(
+                bt_message_packet_end_borrow_packet_const(message)));
+        if (bt_stream_class_packets_have_end_default_clock_snapshot(streamClass))
+        {
+            clock =
+                bt_message_packet_end_borrow_default_clock_snapshot_const(message);
+        }
+        return clock;
+    }
+    case BT_MESSAGE_TYPE_DISCARDED_EVENTS:
+    {
+        const bt_stream_class* streamClass = bt_stream_borrow_class_const(
+            bt_message_discarded_events_borrow_stream_const(message));
+        if (bt_stream_class_discarded_events_have_default_clock_snapshots(
+                streamClass))
+        {
+            clock =
+                bt_message_discarded_events_borrow_beginning_default_clock_snapshot_const(
+                    message);
+        }
+        return clock;
+    }
+    case BT_MESSAGE_TYPE_DISCARDED_PACKETS:
+    {
+        const bt_stream_class* streamClass = bt_stream_borrow_class_const(
+            bt_message_discarded_packets_borrow_stream_const(message));
+        if (bt_stream_class_discarded_packets_have_default_clock_snapshots(
+                streamClass))
+        {
+            clock =
+                bt_message_discarded_packets_borrow_beginning_default_clock_snapshot_const(
+                    message);
+        }
+        return clock;
+    }
+    case BT_MESSAGE_TYPE_STREAM_BEGINNING:
+    {
+        const bt_stream_class* streamClass = bt_stream_borrow_class_const(
+            bt_message_stream_beginning_borrow_stream_const(message));
+        if (bt_stream_class_borrow_default_clock_class_const(streamClass) &&
+            bt_message_stream_beginning_borrow_default_clock_snapshot_const(
+                message, &clock) != BT_MESSAGE_STREAM_CLOCK_SNAPSHOT_STATE_KNOWN)
+        {
+            clock = nullptr;
+        }
+        return clock;
+    }
+    case BT_MESSAGE_TYPE_STREAM_END:
+    {
+        const bt_stream_class* streamClass = bt_stream_borrow_class_const(
+            bt_message_stream_end_borrow_stream_const(message));
+        if (bt_stream_class_borrow_default_clock_class_const(streamClass) &&
+            bt_message_stream_end_borrow_default_clock_snapshot_const(
+                message, &clock) != BT_MESSAGE_STREAM_CLOCK_SNAPSHOT_STATE_KNOWN)
+        {
+            clock = nullptr;
+        }
+        return clock;
+    }
+    default:
+        return nullptr;
+    }
+}
+
+int64_t
+MergeFilterIterator::GetTimestamp(Upstream& upstream, const bt_message* message)
+{
+    // Messages without a usable clock snapshot inherit the timestamp of the
+    // message before them so they stay next to it in the merged output.
+    const bt_clock_snapshot* clock = BorrowClockSnapshot(message);
+    if (clock)
+    {
+        int64_t nanosFromEpoch = 0;
+        if (bt_clock_snapshot_get_ns_from_origin(clock, &nanosFromEpoch) ==
+            BT_CLOCK_SNAPSHOT_GET_NS_FROM_ORIGIN_STATUS_OK)
+        {
+            upstream.LastTimestamp = nanosFromEpoch;
+        }
+    }
+
+    return upstream.LastTimestamp;
+}
+
+bt_message_iterator_next_status MergeFilterIterator::Refill(uint32_t index)
+{
+    Upstream& upstream = _upstreams[index];
+
+    bt_message_array_const messages = nullptr;
+    uint64_t count = 0;
+    bt_message_iterator_next_status status =
+        bt_message_iterator_next(upstream.MessageItr.Get(), &messages, &count);
+
+    switch (status)
+    {
+    case BT_MESSAGE_ITERATOR_NEXT_STATUS_OK:
+        FAIL_FAST_IF(count == 0);
+        upstream.Messages.assign(messages, messages + count);
+        upstream.NextMessage = 0;
+        _heap.Push(GetTimestamp(upstream, upstream.Messages.front()), index);
+        break;
+    case BT_MESSAGE_ITERATOR_NEXT_STATUS_END:
+        upstream.MessageItr.Reset();
+        break;
+    default:
+        break;
+    }
+
+    return status;
+}
+
+bt_message_iterator_class_next_method_status MergeFilterIterator::Next(
+    bt_message_array_const messages,
+    uint64_t capacity,
+    uint64_t* count)
+{
+    if (!AttachNewInputPorts())
+    {
+        return BT_MESSAGE_ITERATOR_CLASS_NEXT_METHOD_STATUS_ERROR;
+    }
+
+    // The oldest message can only be picked once every live upstream has
+    // a buffered head message.
+    while (!_needRefill.empty())
+    {
+        bt_message_iterator_next_status status = Refill(_needRefill.back());
+        switch (status)
+        {
+        case BT_MESSAGE_ITERATOR_NEXT_STATUS_OK:
+        case BT_MESSAGE_ITERATOR_NEXT_STATUS_END:
+            _needRefill.pop_back();
+            break;
+        default:
+            return static_cast<bt_message_iterator_class_next_method_status>(
+                status);
+        }
+    }
+
+    uint64_t emitted = 0;
+    while (emitted < capacity && !_heap.Empty())
+    {
+        uint32_t index = _heap.Top().Source;
+        Upstream& upstream = _upstreams[index];
+
+        // Reference ownership moves to the output array
+        messages[emitted++] = upstream.Messages[upstream.NextMessage++];
+
+        if (upstream.NextMessage < upstream.Messages.size())
+        {
+            _heap.ReplaceTop(GetTimestamp(
+                upstream, upstream.Messages[upstream.NextMessage]));
+            continue;
+        }
+
+        _heap.Pop();
+        upstream.Messages.clear();
+        upstream.NextMessage = 0;
+
+        bt_message_iterator_next_status status = Refill(index);
+        if (status == BT_MESSAGE_ITERATOR_NEXT_STATUS_OK ||
+            status == BT_MESSAGE_ITERATOR_NEXT_STATUS_END)
+        {
+            continue;
+        }
+
+        if (status == BT_MESSAGE_ITERATOR_NEXT_STATUS_AGAIN)
+        {
+            _needRefill.push_back(index);
+            break;
+        }
+
+        for (uint64_t i = 0; i < emitted; i++)
+        {
+            bt_message_put_ref(messages[i]);
+        }
+        return static_cast<bt_message_iterator_class_next_method_status>(status);
+    }
+
+    if (emitted > 0)
+    {
+        *count = emitted;
+        return BT_MESSAGE_ITERATOR_CLASS_NEXT_METHOD_STATUS_OK;
+    }
+
+    if (_heap.Empty() && _needRefill.empty())
+    {
+        return BT_MESSAGE_ITERATOR_CLASS_NEXT_METHOD_STATUS_END;
+    }
+
+    return BT_MESSAGE_ITERATOR_CLASS_NEXT_METHOD_STATUS_AGAIN;
+}
+
+bt_message_iterator_class_initialize_method_status MergeFilterIterator_InitStatic(
+    bt_self_message_iterator* self,
+    bt_self_message_iterator_configuration*,
+    bt_self_component_port_output*)
+{
+    auto mergeFilter = static_cast<MergeFilter*>(bt_self_component_get_data(
+        bt_self_message_iterator_borrow_component(self)));
+
+    auto mergeItr = std::make_unique<MergeFilterIterator>(self, *mergeFilter);
+    if (!mergeItr->AttachNewInputPorts())
+    {
+        return BT_MESSAGE_ITERATOR_CLASS_INITIALIZE_METHOD_STATUS_ERROR;
+    }
+
+    bt_self_message_iterator_set_data(self, mergeItr.release());
+
+    return BT_MESSAGE_ITERATOR_CLASS_INITIALIZE_METHOD_STATUS_OK;
+}
+
+bt_message_iterator_class_next_method_status MergeFilterIterator_NextStatic(
+    bt_self_message_iterator* self,
+    bt_message_array_const messages,
+    uint64_t capacity,
+    uint64_t* count)
+{
+    auto mergeItr =
+        static_cast<MergeFilterIterator*>(bt_self_message_iterator_get_data(self));
+
+    return mergeItr->Next(messages, capacity, count);
+}
+
+void MergeFilterIterator_FinalizeStatic(bt_self_message_iterator* self)
+{
+    auto mergeItr =
+        static_cast<MergeFilterIterator*>(bt_self_message_iterator_get_data(self));
+
+    delete mergeItr;
+}
+
+bt_component_class_initialize_method_status MergeFilter_InitStatic(
+    bt_self_component_filter* self,
+    bt_self_component_filter_configuration*,
+    const bt_value*,
+    void*)
+{
+    auto mergeFilter = std::make_unique<MergeFilter>();
+
+    bt_self_component_add_port_status addPortStatus =
+        mergeFilter->AddInputPort(self);
+    if (addPortStatus != BT_SELF_COMPONENT_ADD_PORT_STATUS_OK)
+    {
+        return static_cast<bt_component_class_initialize_method_status>(
+            addPortStatus);
+    }
+
+    addPortStatus = bt_self_component_filter_add_output_port(
+        self, MergeFilter::c_outputPortName, nullptr, nullptr);
+    if (addPortStatus != BT_SELF_COMPONENT_ADD_PORT_STATUS_OK)
+    {
+        return static_cast<bt_component_class_initialize_method_status>(
+            addPortStatus);
+    }
+
+    bt_self_component_set_data(
+        bt_self_component_filter_as_self_component(self), mergeFilter.release());
+
+    return BT_COMPONENT_CLASS_INITIALIZE_METHOD_STATUS_OK;
+}
+
+bt_component_class_port_connected_method_status MergeFilter_InputPortConnectedStatic(
+    bt_self_component_filter* self,
+    bt_self_component_port_input* selfPort,
+    const bt_port_output*)
+{
+    auto mergeFilter = static_cast<MergeFilter*>(bt_self_component_get_data(
+        bt_self_component_filter_as_self_component(self)));
+
+    return mergeFilter->InputPortConnected(self, selfPort);
+}
+
+void MergeFilter_FinalizeStatic(bt_self_component_filter* self)
+{
+    auto mergeFilter = static_cast<MergeFilter*>(bt_self_component_get_data(
+        bt_self_component_filter_as_self_component(self)));
+
+    delete mergeFilter;
+}
+
+BabelPtr<const bt_component_class_filter> GetMergeFilterComponentClass()
+{
+    BabelPtr<bt_message_iterator_class> mergeIteratorClass =
+        bt_message_iterator_class_create(MergeFilterIterator_NextStatic);
+    bt_message_iterator_class_set_initialize_method(
+        mergeIteratorClass.Get(), MergeFilterIterator_InitStatic);
+    bt_message_iterator_class_set_finalize_method(
+        mergeIteratorClass.Get(), MergeFilterIterator_FinalizeStatic);
+
+    BabelPtr<bt_component_class_filter> mergeFilterClass =
+        bt_component_class_filter_create("merge", mergeIteratorClass.Get());
+    bt_component_class_filter_set_initialize_method(
+        mergeFilterClass.Get(), MergeFilter_InitStatic);
+    bt_component_class_filter_set_input_port_connected_method(
+        mergeFilterClass.Get(), MergeFilter_InputPortConnectedStatic);
+    bt_component_class_filter_set_finalize_method(
+        mergeFilterClass.Get(), MergeFilter_FinalizeStatic);
+
+    BabelPtr<const bt_component_class_filter> returnVal =
+        mergeFilterClass.Detach();
+
+    return returnVal;
+}
+
+}
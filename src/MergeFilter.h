@@ -0,0 +1,16 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "BabelPtr.h"
+
+namespace LttngConsume {
+
+// Filter that merges every connected input port into a single output port
+// in timestamp order. It serves the same purpose as utils.muxer but keys a
+// binary heap on cached integer timestamps, which keeps the per-message cost
+// low when there are many upstream streams.
+BabelPtr<const bt_component_class_filter> GetMergeFilterComponentClass();
+
+}
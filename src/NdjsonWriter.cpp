@@ -0,0 +1,417 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <lttng-consume/NdjsonWriter.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iterator>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "FailureHelpers.h"
+#include "ThreadPlacement.h"
+
+using namespace jsonbuilder;
+
+namespace LttngConsume {
+
+static constexpr size_t c_bufferAlignment = 4096;
+
+// Full buffers are written once this many have built up
+static constexpr size_t c_buffersPerWrite = 16;
+
+static std::system_error MakeSystemError(const char* what)
+{
+    return std::system_error(errno, std::generic_category(), what);
+}
+
+NdjsonWriter::NdjsonWriter(const NdjsonWriterOptions& options)
+    : _options(options)
+{
+    _options.BufferBytes = std::max<size_t>(_options.BufferBytes, 1);
+    _options.MaxQueuedEvents = std::max<size_t>(_options.MaxQueuedEvents, 1);
+
+    ValidateThreadPlacement(_options.Placement);
+
+    // Single line output
+    _renderer.Pretty(false);
+
+    OpenFile();
+
+    _lastWrite = std::chrono::steady_clock::now();
+    _thread = std::thread{ &NdjsonWriter::Run, this };
+}
+
+NdjsonWriter::~NdjsonWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        _stopping = true;
+    }
+    _wakeWriter.notify_one();
+
+    _thread.join();
+
+    if (_options.Fsync != NdjsonFsyncPolicy::Never && _fd >= 0)
+    {
+        fsync(_fd);
+    }
+    CloseFile();
+}
+
+void NdjsonWriter::Write(LttngEventBatch& batch)
+{
+    if (batch.empty())
+    {
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock{ _mutex };
+        _wakeProducers.wait(lock, [this]() {
+            return _pending.size() < _options.MaxQueuedEvents || _error;
+        });
+
+        ThrowIfFailed();
+
+        for (JsonBuilder& event : batch)
+        {
+            _pending.emplace_back();
+            if (!_recycled.empty())
+            {
+                _pending.back().swap(_recycled.back());
+                _recycled.pop_back();
+            }
+
+            // The slot keeps the recycled buffer, or an empty builder
+            _pending.back().swap(event);
+        }
+
+        _handedOver += batch.size();
+    }
+
+    _wakeWriter.notify_one();
+}
+
+void NdjsonWriter::Flush()
+{
+    std::unique_lock<std::mutex> lock{ _mutex };
+
+    uint64_t target = _handedOver;
+    _flushWaiters++;
+    _wakeWriter.notify_one();
+
+    _wakeProducers.wait(lock, [this, target]() {
+        return _written >= target || _error;
+    });
+    _flushWaiters--;
+
+    ThrowIfFailed();
+}
+
+void NdjsonWriter::ThrowIfFailed()
+{
+    if (_error)
+    {
+        std::rethrow_exception(_error);
+    }
+}
+
+void NdjsonWriter::Run()
+{
+    std::vector<JsonBuilder> events;
+
+    std::error_code placementError = ApplyThreadPlacement(_options.Placement);
+
+    std::unique_lock<std::mutex> lock{ _mutex };
+
+    if (placementError)
+    {
+        _error = std::make_exception_ptr(
+            std::system_error(placementError, "NdjsonWriter"));
+    }
+
+    while (true)
+    {
+        _wakeWriter.wait_for(lock, _options.FlushInterval, [this]() {
+            return !_pending.empty() || _stopping || _flushWaiters > 0;
+        });
+
+        events.swap(_pending);
+        uint64_t handedOver = _handedOver;
+        bool stopping = _stopping;
+        bool flushRequested = _flushWaiters > 0;
+        bool failed = static_cast<bool>(_error);
+
+        lock.unlock();
+        _wakeProducers.notify_all();
+
+        std::exception_ptr error;
+        if (!failed)
+        {
+            try
+            {
+                for (const JsonBuilder& event : events)
+                {
+                    Render(event);
+
+                    if (_buffers.size() > c_buffersPerWrite)
+                    {
+                        WriteBuffers(false);
+                    }
+                }
+
+                bool intervalPassed = std::chrono::steady_clock::now() -
+                                          _lastWrite >=
+                                      _options.FlushInterval;
+                if ((stopping || flushRequested || intervalPassed) &&
+                    !_buffers.empty())
+                {
+                    WriteBuffers(true);
+
+                    if (_options.Fsync == NdjsonFsyncPolicy::OnWrite &&
+                        _fd >= 0 && fsync(_fd) != 0)
+                    {
+                        throw MakeSystemError("fsync");
+                    }
+                }
+            }
+            catch (const std::system_error& e)
+            {
+                error = std::make_exception_ptr(
+                    std::system_error(e.code(), "NdjsonWriter"));
+            }
+            catch (const std::exception&)
+            {
+                // Such as std::bad_alloc while rendering or buffering
+                error = std::current_exception();
+            }
+        }
+
+        for (JsonBuilder& event : events)
+        {
+            event.clear();
+        }
+
+        lock.lock();
+
+        if (error && !_error)
+        {
+            _error = error;
+        }
+
+        if (_buffers.empty() || _error)
+        {
+            _written = handedOver;
+        }
+
+        size_t recycleCount = std::min(
+            events.size(), _options.MaxQueuedEvents - _recycled.size());
+        std::move(
+            events.begin(),
+            events.begin() + recycleCount,
+            std::back_inserter(_recycled));
+        events.clear();
+
+        _wakeProducers.notify_all();
+
+        if (stopping && _pending.empty())
+        {
+            return;
+        }
+    }
+}
+
+NdjsonWriter::AlignedBuffer& NdjsonWriter::BufferFor(size_t lineBytes)
+{
+    if (!_buffers.empty() &&
+        _buffers.back().Capacity - _buffers.back().Used >= lineBytes)
+    {
+        return _buffers.back();
+    }
+
+    if (lineBytes <= _options.BufferBytes && !_freeBuffers.empty())
+    {
+        _buffers.push_back(std::move(_freeBuffers.back()));
+        _freeBuffers.pop_back();
+        return _buffers.back();
+    }
+
+    size_t capacity = std::max(lineBytes, _options.BufferBytes);
+    size_t size = (capacity + c_bufferAlignment - 1) / c_bufferAlignment *
+                  c_bufferAlignment;
+
+    AlignedBuffer buffer;
+    buffer.Data = {
+        static_cast<char*>(std::aligned_alloc(c_bufferAlignment, size)),
+        std::free
+    };
+    if (!buffer.Data)
+    {
+        throw std::bad_alloc();
+    }
+    buffer.Capacity = capacity;
+
+    _buffers.push_back(std::move(buffer));
+    return _buffers.back();
+}
+
+void NdjsonWriter::Render(const JsonBuilder& event)
+{
+    std::string_view line = _renderer.Render(event);
+
+    // A line that doesn't fit in the current buffer starts the next one
+    // rather than being split across them
+    AlignedBuffer& buffer = BufferFor(line.size() + 1);
+    std::memcpy(buffer.Data.get() + buffer.Used, line.data(), line.size());
+    buffer.Used += line.size();
+    buffer.Data.get()[buffer.Used++] = '\n';
+}
+
+void NdjsonWriter::WriteBuffers(bool includePartial)
+{
+    size_t count = _buffers.size();
+
+    // The last buffer is usually still filling, so unless everything is to
+    // be written it waits for more lines
+    if (!includePartial && count > 0)
+    {
+        count--;
+    }
+
+    size_t first = 0;
+    while (first < count)
+    {
+        // Write as many buffers as fit in the current file in one call
+        auto now = std::chrono::steady_clock::now();
+        bool tooOld = _options.MaxFileAge.count() > 0 &&
+                      now - _fileOpened >= _options.MaxFileAge;
+
+        uint64_t bytes = 0;
+        size_t last = first;
+        while (last < count && last - first < IOV_MAX)
+        {
+            uint64_t nextBytes = bytes + _buffers[last].Used;
+            if (_options.MaxFileBytes > 0 && last > first &&
+                _fileBytes + nextBytes > _options.MaxFileBytes)
+            {
+                break;
+            }
+
+            bytes = nextBytes;
+            last++;
+        }
+
+        bool tooBig = _options.MaxFileBytes > 0 && _fileBytes > 0 &&
+                      _fileBytes + bytes > _options.MaxFileBytes;
+        if (tooOld || tooBig)
+        {
+            if (_options.Fsync != NdjsonFsyncPolicy::Never && fsync(_fd) != 0)
+            {
+                throw MakeSystemError("fsync");
+            }
+
+            CloseFile();
+            OpenFile();
+        }
+
+        WriteToFile(first, last);
+        first = last;
+    }
+
+    // Buffers grown for a long line are freed rather than kept
+    for (size_t i = 0; i < count; i++)
+    {
+        if (_buffers[i].Capacity == _options.BufferBytes)
+        {
+            _buffers[i].Used = 0;
+            _freeBuffers.push_back(std::move(_buffers[i]));
+        }
+    }
+    _buffers.erase(_buffers.begin(), _buffers.begin() + count);
+
+    _lastWrite = std::chrono::steady_clock::now();
+}
+
+void NdjsonWriter::WriteToFile(size_t first, size_t last)
+{
+    std::vector<iovec> iovecs;
+    for (size_t i = first; i < last; i++)
+    {
+        iovecs.push_back(iovec{ _buffers[i].Data.get(), _buffers[i].Used });
+    }
+
+    // writev() may stop early, so pick up wherever it left off
+    size_t index = 0;
+    while (index < iovecs.size())
+    {
+        ssize_t written = writev(
+            _fd, &iovecs[index], static_cast<int>(iovecs.size() - index));
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            throw MakeSystemError("writev");
+        }
+
+        _fileBytes += written;
+
+        size_t remaining = static_cast<size_t>(written);
+        while (index < iovecs.size() && remaining >= iovecs[index].iov_len)
+        {
+            remaining -= iovecs[index].iov_len;
+            index++;
+        }
+
+        if (index < iovecs.size())
+        {
+            iovecs[index].iov_base =
+                static_cast<char*>(iovecs[index].iov_base) + remaining;
+            iovecs[index].iov_len -= remaining;
+        }
+    }
+}
+
+void NdjsonWriter::OpenFile()
+{
+    std::time_t now = std::time(nullptr);
+    std::tm utcNow{};
+    gmtime_r(&now, &utcNow);
+
+    char timestamp[32];
+    std::strftime(timestamp, sizeof(timestamp), "%Y%m%dT%H%M%SZ", &utcNow);
+
+    std::string path = _options.Directory + "/" + _options.FilePrefix + "-" +
+                       timestamp + "-" + std::to_string(_fileSequence++) +
+                       ".ndjson";
+
+    _fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (_fd < 0)
+    {
+        throw MakeSystemError("open");
+    }
+
+    _fileBytes = 0;
+    _fileOpened = std::chrono::steady_clock::now();
+}
+
+void NdjsonWriter::CloseFile()
+{
+    if (_fd >= 0)
+    {
+        close(_fd);
+        _fd = -1;
+    }
+}
+
+}
@@ -0,0 +1,231 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "OfflineMerger.h"
+
+#include <chrono>
+#include <limits>
+#include <utility>
+
+#include <jsonbuilder/JsonBuilder.h>
+
+using namespace jsonbuilder;
+
+namespace LttngConsume {
+
+// Batches each worker may queue ahead of the merge
+static constexpr size_t c_maxQueuedBatches = 8;
+
+// Merged events delivered together
+static constexpr size_t c_mergedBatchSize = 256;
+
+static constexpr std::chrono::milliseconds c_stopPollInterval{ 50 };
+
+// Events are merged on the "time" member the reader adds to each of them
+static int64_t GetEventTime(const JsonBuilder& event)
+{
+    auto itr = event.find("time");
+    if (itr == event.end() || itr->Type() != JsonTime)
+    {
+        return std::numeric_limits<int64_t>::min();
+    }
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               itr->GetUnchecked<std::chrono::system_clock::time_point>()
+                   .time_since_epoch())
+        .count();
+}
+
+OfflineMerger::OfflineMerger(size_t workerCount, InFlightMemory& inFlight)
+    : _inFlight(inFlight), _heads(workerCount)
+{
+    for (size_t i = 0; i < workerCount; i++)
+    {
+        _queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    // Merged events stay charged to their worker's batch until the output
+    // has had them, so only events the output holds need charging here
+    _inFlight.Attach(_mergedBatch);
+}
+
+void OfflineMerger::Push(size_t worker, LttngEventBatch& batch)
+{
+    if (batch.empty())
+    {
+        return;
+    }
+
+    WorkerQueue& queue = *_queues[worker];
+
+    std::unique_lock<std::mutex> lock{ queue.Mutex };
+    queue.Changed.wait(lock, [&queue]() {
+        return queue.Batches.size() < c_maxQueuedBatches || queue.Abandoned;
+    });
+
+    if (queue.Abandoned)
+    {
+        return;
+    }
+
+    queue.Batches.emplace_back();
+    if (!queue.Spent.empty())
+    {
+        std::swap(queue.Batches.back(), queue.Spent.back());
+        queue.Spent.pop_back();
+    }
+
+    std::swap(queue.Batches.back(), batch);
+    queue.BatchBytes.push_back(_inFlight.ChargeDecoded(queue.Batches.back()));
+
+    queue.Changed.notify_all();
+}
+
+void OfflineMerger::Finish(size_t worker)
+{
+    WorkerQueue& queue = *_queues[worker];
+
+    std::lock_guard<std::mutex> lock{ queue.Mutex };
+    queue.Finished = true;
+    queue.Changed.notify_all();
+}
+
+bool OfflineMerger::NextBatch(size_t worker, const std::atomic<bool>& stop)
+{
+    WorkerQueue& queue = *_queues[worker];
+    WorkerHead& head = _heads[worker];
+
+    std::unique_lock<std::mutex> lock{ queue.Mutex };
+
+    // Events of the batch may still wait in _mergedBatch
+    if (_mergedBatch.empty())
+    {
+        _inFlight.Release(head.ChargedBytes);
+    }
+    else
+    {
+        _mergedChargedBytes += head.ChargedBytes;
+    }
+    head.ChargedBytes = 0;
+
+    head.Batch.Clear();
+    queue.Spent.emplace_back();
+    std::swap(queue.Spent.back(), head.Batch);
+
+    // Nothing notifies on stop, so it is polled
+    while (queue.Batches.empty() && !queue.Finished)
+    {
+        if (stop)
+        {
+            return false;
+        }
+
+        queue.Changed.wait_for(lock, c_stopPollInterval);
+    }
+
+    if (queue.Batches.empty())
+    {
+        return false;
+    }
+
+    std::swap(head.Batch, queue.Batches.front());
+    queue.Batches.pop_front();
+    head.Index = 0;
+    head.ChargedBytes = queue.BatchBytes.front();
+    queue.BatchBytes.pop_front();
+
+    queue.Changed.notify_all();
+    return true;
+}
+
+bool OfflineMerger::HasQueuedBatch(size_t worker)
+{
+    WorkerQueue& queue = *_queues[worker];
+
+    std::lock_guard<std::mutex> lock{ queue.Mutex };
+    return !queue.Batches.empty();
+}
+
+void OfflineMerger::Output(std::function<void(LttngEventBatch&)>& output)
+{
+    output(_mergedBatch);
+    _mergedBatch.Clear();
+
+    _inFlight.Release(_mergedChargedBytes);
+    _mergedChargedBytes = 0;
+}
+
+void OfflineMerger::Run(
+    std::function<void(LttngEventBatch&)>& output,
+    const std::atomic<bool>& stop)
+{
+    for (size_t i = 0; i < _heads.size(); i++)
+    {
+        if (NextBatch(i, stop))
+        {
+            _heap.Push(
+                GetEventTime(_heads[i].Batch[0]), static_cast<uint32_t>(i));
+        }
+    }
+
+    while (!_heap.Empty() && !stop)
+    {
+        uint32_t worker = _heap.Top().Source;
+        WorkerHead& head = _heads[worker];
+
+        _mergedBatch.EmplaceBack().swap(head.Batch[head.Index++]);
+        if (_mergedBatch.size() == c_mergedBatchSize)
+        {
+            Output(output);
+        }
+
+        if (head.Index == head.Batch.size())
+        {
+            // The worker may be blocked on the memory budget the merged
+            // events hold, so they go out before waiting on it
+            if (!_mergedBatch.empty() && !HasQueuedBatch(worker))
+            {
+                Output(output);
+            }
+
+            if (!NextBatch(worker, stop))
+            {
+                _heap.Pop();
+                continue;
+            }
+        }
+
+        _heap.ReplaceTop(GetEventTime(head.Batch[head.Index]));
+    }
+
+    if (!_mergedBatch.empty() && !stop)
+    {
+        Output(output);
+    }
+    _mergedBatch.Clear();
+
+    _inFlight.Release(_mergedChargedBytes);
+    _mergedChargedBytes = 0;
+
+    // Unblocks workers still pushing after a stop
+    for (size_t i = 0; i < _queues.size(); i++)
+    {
+        WorkerQueue& queue = *_queues[i];
+
+        std::lock_guard<std::mutex> lock{ queue.Mutex };
+        queue.Abandoned = true;
+        queue.Batches.clear();
+        queue.Changed.notify_all();
+
+        for (uint64_t bytes : queue.BatchBytes)
+        {
+            _inFlight.Release(bytes);
+        }
+        queue.BatchBytes.clear();
+
+        _inFlight.Release(_heads[i].ChargedBytes);
+        _heads[i].ChargedBytes = 0;
+    }
+}
+
+}
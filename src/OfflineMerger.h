@@ -0,0 +1,95 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <lttng-consume/LttngEventBatch.h>
+
+#include "InFlightMemory.h"
+#include "TimestampHeap.h"
+
+namespace LttngConsume {
+
+// Merges the batches delivered by the graphs of several offline workers
+// back into timestamp order. Each worker's own events must already be in
+// order, which its muxer or merge filter ensures.
+//
+// Workers hand their batches over with Push() on their own threads, and
+// Run() delivers the merged events on the calling thread. Batches are
+// swapped rather than copied, so their storage circulates between the
+// workers and the merger.
+class OfflineMerger
+{
+  public:
+    // Queued batches are charged to inFlight until they are merged
+    OfflineMerger(size_t workerCount, InFlightMemory& inFlight);
+
+    OfflineMerger(const OfflineMerger&) = delete;
+    OfflineMerger& operator=(const OfflineMerger&) = delete;
+
+    // Takes the events out of batch, leaving it with the storage of a batch
+    // already merged. Blocks while the worker is too far ahead of the
+    // merge, and drops the events once Run() has returned.
+    void Push(size_t worker, LttngEventBatch& batch);
+
+    // Called once a worker has pushed all its events
+    void Finish(size_t worker);
+
+    // Returns once every worker finished and its events were delivered, or
+    // soon after stop is set
+    void Run(
+        std::function<void(LttngEventBatch&)>& output,
+        const std::atomic<bool>& stop);
+
+  private:
+    struct WorkerQueue
+    {
+        std::mutex Mutex;
+        std::condition_variable Changed;
+        std::deque<LttngEventBatch> Batches;
+        std::deque<uint64_t> BatchBytes;
+        std::vector<LttngEventBatch> Spent;
+        bool Finished = false;
+        bool Abandoned = false;
+    };
+
+    // The batch being merged from a worker and the next event in it
+    struct WorkerHead
+    {
+        LttngEventBatch Batch;
+        size_t Index = 0;
+        uint64_t ChargedBytes = 0;
+    };
+
+    // Returns the current batch of the worker and waits for its next one.
+    // Returns false once the worker finished or stop is set.
+    bool NextBatch(size_t worker, const std::atomic<bool>& stop);
+
+    bool HasQueuedBatch(size_t worker);
+
+    // Delivers _mergedBatch, then releases the charges of the batches its
+    // events came from
+    void Output(std::function<void(LttngEventBatch&)>& output);
+
+  private:
+    InFlightMemory& _inFlight;
+    std::vector<std::unique_ptr<WorkerQueue>> _queues;
+    std::vector<WorkerHead> _heads;
+    TimestampHeap _heap;
+    LttngEventBatch _mergedBatch;
+
+    // Charged for batches merged in full whose last events are still in
+    // _mergedBatch
+    uint64_t _mergedChargedBytes = 0;
+};
+
+}
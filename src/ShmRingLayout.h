@@ -0,0 +1,102 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Layout of the shared memory ring written by ShmRingWriter and read by
+// ShmRingReader. Both sides map the same object, so everything here must
+// keep its layout across compilers and the atomics must be lock free.
+namespace LttngConsume::ShmRingLayout {
+
+constexpr uint64_t c_magic = 0x474e4952434c544cULL; // "LTLCRING"
+constexpr uint32_t c_version = 1;
+constexpr uint32_t c_maxReaders = 16;
+
+// Records are padded to this so their headers stay aligned
+constexpr uint64_t c_recordAlignment = 8;
+
+enum ReaderState : uint32_t
+{
+    ReaderFree = 0,
+
+    // Taken by a reader that hasn't published its position yet. Ignored
+    // by the writer.
+    ReaderClaiming = 1,
+
+    ReaderActive = 2
+};
+
+// Set on a record that only fills the gap at the end of the data area
+constexpr uint32_t c_paddingRecord = 1;
+
+struct RecordHeader
+{
+    uint32_t Size;
+    uint32_t Flags;
+};
+
+struct alignas(64) ReaderSlot
+{
+    std::atomic<uint32_t> State;
+    std::atomic<int32_t> Pid;
+
+    // Offset of the first byte the reader still needs. The writer never
+    // goes more than Capacity bytes past the lowest active one.
+    std::atomic<uint64_t> Position;
+};
+
+struct Header
+{
+    // Magic is stored last by the writer, once the rest is initialized
+    std::atomic<uint64_t> Magic;
+    uint32_t Version;
+    uint32_t HeaderSize;
+    uint64_t Capacity;
+
+    // Total bytes published, so the write position is WriteOffset %
+    // Capacity. Never wraps in practice.
+    alignas(64) std::atomic<uint64_t> WriteOffset;
+    std::atomic<uint32_t> Closed;
+
+    // Futex word bumped on publish while readers are waiting
+    alignas(64) std::atomic<uint32_t> Sequence;
+    std::atomic<uint32_t> Waiters;
+
+    ReaderSlot Readers[c_maxReaders];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+
+constexpr uint64_t c_dataOffset = (sizeof(Header) + 4095) / 4096 * 4096;
+
+inline uint64_t AlignRecord(uint64_t size)
+{
+    return (size + c_recordAlignment - 1) & ~(c_recordAlignment - 1);
+}
+
+// Not FUTEX_PRIVATE_FLAG, since the word is shared between processes
+inline void FutexWait(
+    std::atomic<uint32_t>* word,
+    uint32_t expected,
+    const timespec* timeout)
+{
+    syscall(SYS_futex, word, FUTEX_WAIT, expected, timeout, nullptr, 0);
+}
+
+inline void FutexWakeAll(std::atomic<uint32_t>* word)
+{
+    syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+}
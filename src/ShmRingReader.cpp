@@ -0,0 +1,192 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <lttng-consume/ShmRingReader.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ShmRingLayout.h"
+
+namespace LttngConsume {
+
+using namespace ShmRingLayout;
+
+ShmRingReader::ShmRingReader(const std::string& name)
+{
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "shm_open");
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) != 0)
+    {
+        int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), "fstat");
+    }
+
+    _mappedBytes = static_cast<size_t>(status.st_size);
+    if (_mappedBytes < c_dataOffset)
+    {
+        close(fd);
+        throw std::runtime_error("ShmRingReader: ring isn't initialized");
+    }
+
+    void* mapping =
+        mmap(nullptr, _mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int error = errno;
+    close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        throw std::system_error(error, std::generic_category(), "mmap");
+    }
+
+    _header = static_cast<Header*>(mapping);
+
+    if (_header->Magic.load(std::memory_order_acquire) != c_magic ||
+        _header->Version != c_version ||
+        _header->HeaderSize != c_dataOffset ||
+        _header->HeaderSize + _header->Capacity != _mappedBytes)
+    {
+        munmap(mapping, _mappedBytes);
+        throw std::runtime_error(
+            "ShmRingReader: ring isn't initialized or has another version");
+    }
+
+    _capacity = _header->Capacity;
+    _data = static_cast<const char*>(mapping) + c_dataOffset;
+
+    bool claimed = false;
+    for (_slot = 0; _slot < c_maxReaders; _slot++)
+    {
+        uint32_t expected = ReaderFree;
+        if (_header->Readers[_slot].State.compare_exchange_strong(
+                expected, ReaderClaiming))
+        {
+            claimed = true;
+            break;
+        }
+    }
+
+    if (!claimed)
+    {
+        munmap(mapping, _mappedBytes);
+        throw std::runtime_error("ShmRingReader: no free reader slot");
+    }
+
+    ReaderSlot& slot = _header->Readers[_slot];
+    slot.Pid.store(getpid(), std::memory_order_relaxed);
+    slot.Position.store(_header->WriteOffset.load());
+    slot.State.store(ReaderActive);
+
+    // Loaded after activating, so the writer either saw this slot or had
+    // not gone past this offset yet when it last checked the readers
+    _position = _header->WriteOffset.load();
+    _released = _position;
+    _published = _position;
+}
+
+ShmRingReader::~ShmRingReader()
+{
+    _header->Readers[_slot].State.store(ReaderFree);
+
+    munmap(_header, _mappedBytes);
+}
+
+bool ShmRingReader::Next(ShmRingEvent& event)
+{
+    while (true)
+    {
+        if (_position == _published)
+        {
+            _published = _header->WriteOffset.load(std::memory_order_acquire);
+            if (_position == _published)
+            {
+                return false;
+            }
+        }
+
+        uint64_t offset = _position & (_capacity - 1);
+
+        RecordHeader header;
+        std::memcpy(&header, _data + offset, sizeof(header));
+
+        if (header.Flags & c_paddingRecord)
+        {
+            _position += _capacity - offset;
+            continue;
+        }
+
+        event.Data = _data + offset + sizeof(header);
+        event.Size = header.Size;
+
+        _position += AlignRecord(sizeof(header) + header.Size);
+
+        return true;
+    }
+}
+
+void ShmRingReader::Release()
+{
+    if (_position != _released)
+    {
+        _header->Readers[_slot].Position.store(
+            _position, std::memory_order_release);
+        _released = _position;
+    }
+}
+
+bool ShmRingReader::Available() const
+{
+    return _header->WriteOffset.load(std::memory_order_acquire) != _position;
+}
+
+bool ShmRingReader::Wait(std::chrono::milliseconds timeout)
+{
+    if (Available())
+    {
+        return true;
+    }
+
+    Release();
+
+    _header->Waiters.fetch_add(1);
+
+    // Checked again after registering as a waiter, since the writer only
+    // wakes the futex when it sees one
+    uint32_t sequence = _header->Sequence.load();
+    if (!Available() && !_header->Closed.load())
+    {
+        auto seconds =
+            std::chrono::duration_cast<std::chrono::seconds>(timeout);
+        timespec relativeTimeout{
+            static_cast<time_t>(seconds.count()),
+            static_cast<long>(
+                std::chrono::nanoseconds{ timeout - seconds }.count())
+        };
+
+        FutexWait(&_header->Sequence, sequence, &relativeTimeout);
+    }
+
+    _header->Waiters.fetch_sub(1);
+
+    return Available();
+}
+
+bool ShmRingReader::IsClosed() const
+{
+    return _header->Closed.load() && !Available();
+}
+
+}
@@ -0,0 +1,219 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <lttng-consume/ShmRingWriter.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ShmRingLayout.h"
+
+using namespace jsonbuilder;
+
+namespace LttngConsume {
+
+using namespace ShmRingLayout;
+
+ShmRingWriter::ShmRingWriter(const ShmRingOptions& options)
+    : _name(options.Name)
+{
+    if (_name.size() < 2 || _name[0] != '/' ||
+        _name.find('/', 1) != std::string::npos)
+    {
+        throw std::invalid_argument(
+            "ShmRingWriter: Name must be '/' followed by a file name");
+    }
+
+    _capacity = 4096;
+    while (_capacity < options.CapacityBytes)
+    {
+        _capacity *= 2;
+    }
+
+    _mappedBytes = c_dataOffset + _capacity;
+
+    // Readers still attached to a previous ring keep their own mapping
+    shm_unlink(_name.c_str());
+
+    int fd = shm_open(_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "shm_open");
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(_mappedBytes)) != 0)
+    {
+        int error = errno;
+        close(fd);
+        shm_unlink(_name.c_str());
+        throw std::system_error(error, std::generic_category(), "ftruncate");
+    }
+
+    void* mapping =
+        mmap(nullptr, _mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int error = errno;
+    close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        shm_unlink(_name.c_str());
+        throw std::system_error(error, std::generic_category(), "mmap");
+    }
+
+    _header = new (mapping) Header();
+    _header->Version = c_version;
+    _header->HeaderSize = static_cast<uint32_t>(c_dataOffset);
+    _header->Capacity = _capacity;
+    _header->Magic.store(c_magic, std::memory_order_release);
+
+    _data = static_cast<char*>(mapping) + c_dataOffset;
+    _limit = _capacity;
+}
+
+ShmRingWriter::~ShmRingWriter()
+{
+    _header->Closed.store(1);
+    _header->Sequence.fetch_add(1);
+    FutexWakeAll(&_header->Sequence);
+
+    munmap(_header, _mappedBytes);
+    shm_unlink(_name.c_str());
+}
+
+size_t ShmRingWriter::Write(const LttngEventBatch& batch)
+{
+    size_t written = 0;
+    for (const JsonBuilder& event : batch)
+    {
+        written += Append(event);
+    }
+
+    Publish();
+
+    return written;
+}
+
+bool ShmRingWriter::Write(const JsonBuilder& event)
+{
+    bool written = Append(event);
+    Publish();
+
+    return written;
+}
+
+bool ShmRingWriter::Append(const JsonBuilder& event)
+{
+    uint64_t size = event.buffer_size();
+    uint64_t recordBytes = AlignRecord(sizeof(RecordHeader) + size);
+
+    uint64_t offset = _writeOffset & (_capacity - 1);
+    uint64_t gap = _capacity - offset;
+
+    // A record never wraps, the rest of the data area is skipped instead
+    uint64_t neededBytes = recordBytes + (gap < recordBytes ? gap : 0);
+
+    if (recordBytes > _capacity)
+    {
+        _droppedEvents++;
+        return false;
+    }
+
+    if (_writeOffset + neededBytes > _limit)
+    {
+        UpdateLimit();
+        if (_writeOffset + neededBytes > _limit)
+        {
+            _droppedEvents++;
+            return false;
+        }
+    }
+
+    if (gap < recordBytes)
+    {
+        RecordHeader padding{ static_cast<uint32_t>(gap), c_paddingRecord };
+        std::memcpy(_data + offset, &padding, sizeof(padding));
+
+        _writeOffset += gap;
+        offset = 0;
+    }
+
+    RecordHeader header{ static_cast<uint32_t>(size), 0 };
+    std::memcpy(_data + offset, &header, sizeof(header));
+    std::memcpy(_data + offset + sizeof(header), event.buffer_data(), size);
+
+    _writeOffset += recordBytes;
+
+    return true;
+}
+
+void ShmRingWriter::Publish()
+{
+    if (_header->WriteOffset.load(std::memory_order_relaxed) == _writeOffset)
+    {
+        return;
+    }
+
+    // Sequentially consistent so that a reader either sees the new offset
+    // or is seen in Waiters
+    _header->WriteOffset.store(_writeOffset);
+
+    if (_header->Waiters.load() > 0)
+    {
+        _header->Sequence.fetch_add(1);
+        FutexWakeAll(&_header->Sequence);
+    }
+}
+
+void ShmRingWriter::UpdateLimit()
+{
+    // A reader attaching during the scan starts at or after the published
+    // offset, so that bounds it as well
+    uint64_t lowest = _header->WriteOffset.load();
+    bool detached = false;
+
+    for (ReaderSlot& slot : _header->Readers)
+    {
+        if (slot.State.load() != ReaderActive)
+        {
+            continue;
+        }
+
+        uint64_t position = slot.Position.load(std::memory_order_acquire);
+        if (_writeOffset - position < _capacity / 2)
+        {
+            lowest = std::min(lowest, position);
+            continue;
+        }
+
+        // Only lagging readers are checked, to keep kill() off the usual
+        // path. A reader whose process is gone would block the ring forever.
+        int32_t pid = slot.Pid.load(std::memory_order_relaxed);
+        if (kill(pid, 0) != 0 && errno == ESRCH)
+        {
+            uint32_t expected = ReaderActive;
+            detached |=
+                slot.State.compare_exchange_strong(expected, ReaderFree);
+            continue;
+        }
+
+        lowest = std::min(lowest, position);
+    }
+
+    _limit = lowest + _capacity;
+
+    if (detached)
+    {
+        UpdateLimit();
+    }
+}
+
+}
@@ -0,0 +1,64 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "StringInterner.h"
+
+#include <mutex>
+
+namespace LttngConsume {
+
+uint32_t StringInterner::Intern(std::string_view str)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+
+        auto itr = _ids.find(str);
+        if (itr != _ids.end())
+        {
+            return itr->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+
+    // Another thread may have added it between the two locks
+    auto itr = _ids.find(str);
+    if (itr != _ids.end())
+    {
+        return itr->second;
+    }
+
+    uint32_t id = static_cast<uint32_t>(_strings.size());
+    const std::string& stored = _strings.emplace_back(str);
+    _ids.emplace(stored, id);
+
+    return id;
+}
+
+std::string_view StringInterner::Lookup(uint32_t id) const
+{
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+
+    if (id >= _strings.size())
+    {
+        return {};
+    }
+
+    return _strings[id];
+}
+
+uint32_t StringInterner::LocalCache::Intern(std::string_view str)
+{
+    auto itr = _ids.find(str);
+    if (itr != _ids.end())
+    {
+        return itr->second;
+    }
+
+    uint32_t id = _interner.Intern(str);
+    _ids.emplace(_interner.Lookup(id), id);
+
+    return id;
+}
+
+}
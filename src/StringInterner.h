@@ -0,0 +1,50 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace LttngConsume {
+
+// Maps low-cardinality strings to dense ids. Strings are never removed, so
+// the views handed out stay valid for the life of the table.
+class StringInterner
+{
+  public:
+    // Thread safe. Returns the id of str, adding it on first use.
+    uint32_t Intern(std::string_view str);
+
+    // Thread safe. Returns an empty view for an id that was never handed out.
+    std::string_view Lookup(uint32_t id) const;
+
+    // Remembers the ids one thread has already seen so repeated strings
+    // don't touch the shared table. Not thread safe itself.
+    class LocalCache
+    {
+      public:
+        explicit LocalCache(StringInterner& interner) : _interner(interner) {}
+
+        uint32_t Intern(std::string_view str);
+
+      private:
+        StringInterner& _interner;
+
+        // Keys view the interner's own copies, which never move
+        std::unordered_map<std::string_view, uint32_t> _ids;
+    };
+
+  private:
+    mutable std::shared_mutex _mutex;
+
+    // Indexed by id. A deque keeps the strings in place as it grows.
+    std::deque<std::string> _strings;
+    std::unordered_map<std::string_view, uint32_t> _ids;
+};
+
+}
@@ -0,0 +1,163 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "SubscriberFanOut.h"
+
+#include <stdexcept>
+#include <string_view>
+
+using namespace jsonbuilder;
+
+namespace LttngConsume {
+
+// Released builders kept for reuse. More than this and subscribers are
+// holding on to events, so the extras are freed.
+static constexpr size_t c_maxPooledBuilders = 1024;
+
+SubscriberFanOut::SubscriberFanOut(
+    const std::vector<std::shared_ptr<const LttngSubscription>>&
+        subscriptions,
+    StringInterner* interner,
+    InFlightMemory& inFlight)
+    : _reader(interner)
+    , _pool(std::make_shared<BuilderPool>())
+    , _account(inFlight.Account())
+{
+    for (const auto& subscription : subscriptions)
+    {
+        Subscriber subscriber;
+        subscriber.Subscription = subscription;
+        subscriber.Scopes = GetDecodeScopes(*subscription);
+        if (!subscription->Filter.empty())
+        {
+            subscriber.Filter =
+                std::make_unique<EventFilter>(subscription->Filter);
+        }
+
+        _subscribers.push_back(std::move(subscriber));
+    }
+}
+
+DecodeScopes
+SubscriberFanOut::GetDecodeScopes(const LttngSubscription& subscription)
+{
+    if (subscription.Fields.empty())
+    {
+        return DecodeScopes{};
+    }
+
+    DecodeScopes scopes{ false, false, false, false, false };
+    for (std::string_view field : subscription.Fields)
+    {
+        if (field == "packetContext")
+        {
+            scopes.PacketContext = true;
+        }
+        else if (field == "eventHeader")
+        {
+            scopes.EventHeader = true;
+        }
+        else if (field == "streamEventContext")
+        {
+            scopes.StreamEventContext = true;
+        }
+        else if (field == "eventContext")
+        {
+            scopes.EventContext = true;
+        }
+        else if (field == "data")
+        {
+            scopes.Payload = true;
+        }
+        else if (field != "name" && field != "time" && field != "metadata")
+        {
+            throw std::invalid_argument(
+                "Unknown subscription field " + std::string{ field });
+        }
+    }
+
+    return scopes;
+}
+
+void SubscriberFanOut::Deliver(
+    const bt_message* message,
+    uint64_t streamGeneration)
+{
+    DecodeScopes scopes{ false, false, false, false, false };
+
+    _matched.clear();
+    for (Subscriber& subscriber : _subscribers)
+    {
+        if (subscriber.Filter && !subscriber.Filter->Matches(message))
+        {
+            continue;
+        }
+
+        scopes.PacketContext |= subscriber.Scopes.PacketContext;
+        scopes.EventHeader |= subscriber.Scopes.EventHeader;
+        scopes.StreamEventContext |= subscriber.Scopes.StreamEventContext;
+        scopes.EventContext |= subscriber.Scopes.EventContext;
+        scopes.Payload |= subscriber.Scopes.Payload;
+
+        _matched.push_back(&subscriber);
+    }
+
+    if (_matched.empty())
+    {
+        return;
+    }
+
+    _reader.SetStreamGeneration(streamGeneration);
+
+    std::shared_ptr<const JsonBuilder> event = Decode(message, scopes);
+    for (const Subscriber* subscriber : _matched)
+    {
+        subscriber->Subscription->Callback(event);
+    }
+}
+
+std::shared_ptr<const JsonBuilder>
+SubscriberFanOut::Decode(const bt_message* message, const DecodeScopes& scopes)
+{
+    std::unique_ptr<JsonBuilder> builder;
+    {
+        std::lock_guard<std::mutex> lock{ _pool->Mutex };
+        if (!_pool->Builders.empty())
+        {
+            builder = std::move(_pool->Builders.back());
+            _pool->Builders.pop_back();
+        }
+    }
+
+    if (!builder)
+    {
+        builder = std::make_unique<JsonBuilder>();
+    }
+
+    builder->clear();
+    _reader.DecodeEvent(message, *builder, scopes);
+
+    // Charged before the pointer exists, as its deleter releases the bytes
+    // even if it fails to allocate
+    uint64_t bytes = builder->buffer_capacity();
+    _account->Charge(bytes);
+
+    // Whichever subscriber lets go last, on whatever thread, returns the
+    // builder to the pool
+    return std::shared_ptr<const JsonBuilder>(
+        builder.release(),
+        [pool = _pool, account = _account, bytes](const JsonBuilder* event) {
+            std::unique_ptr<JsonBuilder> released{
+                const_cast<JsonBuilder*>(event)
+            };
+            account->Release(bytes);
+
+            std::lock_guard<std::mutex> lock{ pool->Mutex };
+            if (pool->Builders.size() < c_maxPooledBuilders)
+            {
+                pool->Builders.push_back(std::move(released));
+            }
+        });
+}
+
+}
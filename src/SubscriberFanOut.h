@@ -0,0 +1,71 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <jsonbuilder/JsonBuilder.h>
+#include <lttng-consume/LttngSubscription.h>
+
+#include "EventFilter.h"
+#include "InFlightMemory.h"
+#include "LttngJsonReader.h"
+#include "StringInterner.h"
+
+struct bt_message;
+
+namespace LttngConsume {
+
+// Hands each event to the LttngSubscriptions whose filters it matches,
+// decoding it at most once with the union of their fields. Graph thread
+// only, like the filters it evaluates.
+class SubscriberFanOut
+{
+  public:
+    SubscriberFanOut(
+        const std::vector<std::shared_ptr<const LttngSubscription>>&
+            subscriptions,
+        StringInterner* interner,
+        InFlightMemory& inFlight);
+
+    // streamGeneration is the sink's, see DecodeLane::Enqueue()
+    void Deliver(const bt_message* message, uint64_t streamGeneration);
+
+    // Throws std::invalid_argument for a member name Fields can't hold
+    static DecodeScopes GetDecodeScopes(const LttngSubscription& subscription);
+
+  private:
+    struct Subscriber
+    {
+        std::shared_ptr<const LttngSubscription> Subscription;
+        std::unique_ptr<EventFilter> Filter;
+        DecodeScopes Scopes;
+    };
+
+    // Builders of events every subscriber has released. Shared with the
+    // deleters of the events handed out, which may outlive the consumer.
+    struct BuilderPool
+    {
+        std::mutex Mutex;
+        std::vector<std::unique_ptr<jsonbuilder::JsonBuilder>> Builders;
+    };
+
+    std::shared_ptr<const jsonbuilder::JsonBuilder>
+    Decode(const bt_message* message, const DecodeScopes& scopes);
+
+  private:
+    std::vector<Subscriber> _subscribers;
+    std::vector<const Subscriber*> _matched;
+    LttngJsonReader _reader;
+    std::shared_ptr<BuilderPool> _pool;
+
+    // Events are charged until every subscriber has let go
+    std::shared_ptr<InFlightAccount> _account;
+};
+
+}
@@ -0,0 +1,614 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "SyntheticSource.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <babeltrace2/babeltrace.h>
+
+#include "BabelPtr.h"
+
+namespace LttngConsume {
+
+void ValidateSyntheticSourceOptions(const SyntheticSourceOptions& options)
+{
+    if (options.StreamCount == 0 || options.EventsPerPacket == 0)
+    {
+        throw std::invalid_argument(
+            "Synthetic source needs at least one stream and event per packet");
+    }
+
+    if (options.EventsPerSecond < 0)
+    {
+        throw std::invalid_argument("Synthetic event rate is negative");
+    }
+
+    std::unordered_set<std::string> names;
+    for (const SyntheticField& field : options.Fields)
+    {
+        if (field.Name.empty() || !names.insert(field.Name).second)
+        {
+            throw std::invalid_argument(
+                "Synthetic field names must be unique and non-empty");
+        }
+
+        if (field.Type == SyntheticFieldType::Enumeration && field.Length == 0)
+        {
+            throw std::invalid_argument(
+                "Synthetic enumeration " + field.Name + " has no labels");
+        }
+    }
+}
+
+namespace {
+
+struct SyntheticSource
+{
+    SyntheticSourceOptions Options;
+
+    BabelPtr<bt_trace_class> TraceClass;
+    BabelPtr<bt_stream_class> StreamClass;
+    BabelPtr<bt_event_class> EventClass;
+    BabelPtr<bt_trace> Trace;
+
+    // Nanoseconds since the epoch of the first event, and the spacing of
+    // events within a stream. Streams are offset from each other by their
+    // index so no two events share a timestamp.
+    uint64_t FirstTimestamp = 0;
+    uint64_t EventSpacing = 1;
+
+    std::chrono::steady_clock::time_point StartTime;
+};
+
+BabelPtr<bt_field_class> CreatePayloadFieldClass(SyntheticSource& source)
+{
+    bt_trace_class* traceClass = source.TraceClass.Get();
+
+    BabelPtr<bt_field_class> payloadClass =
+        bt_field_class_structure_create(traceClass);
+    if (!payloadClass)
+    {
+        return {};
+    }
+
+    for (const SyntheticField& field : source.Options.Fields)
+    {
+        BabelPtr<bt_field_class> fieldClass;
+        switch (field.Type)
+        {
+        case SyntheticFieldType::SignedInteger:
+            fieldClass = bt_field_class_integer_signed_create(traceClass);
+            break;
+        case SyntheticFieldType::UnsignedInteger:
+            fieldClass = bt_field_class_integer_unsigned_create(traceClass);
+            break;
+        case SyntheticFieldType::Real:
+            fieldClass =
+                bt_field_class_real_double_precision_create(traceClass);
+            break;
+        case SyntheticFieldType::String:
+            fieldClass = bt_field_class_string_create(traceClass);
+            break;
+        case SyntheticFieldType::Enumeration:
+        {
+            fieldClass = bt_field_class_enumeration_unsigned_create(traceClass);
+            for (uint32_t value = 0; fieldClass && value < field.Length;
+                 value++)
+            {
+                BabelPtr<bt_integer_range_set_unsigned> ranges =
+                    bt_integer_range_set_unsigned_create();
+                std::string label = "LABEL" + std::to_string(value);
+                if (!ranges ||
+                    bt_integer_range_set_unsigned_add_range(
+                        ranges.Get(), value, value) !=
+                        BT_INTEGER_RANGE_SET_ADD_RANGE_STATUS_OK ||
+                    bt_field_class_enumeration_unsigned_add_mapping(
+                        fieldClass.Get(), label.c_str(), ranges.Get()) !=
+                        BT_FIELD_CLASS_ENUMERATION_ADD_MAPPING_STATUS_OK)
+                {
+                    return {};
+                }
+            }
+            break;
+        }
+        case SyntheticFieldType::IntegerArray:
+        case SyntheticFieldType::IntegerSequence:
+        {
+            BabelPtr<bt_field_class> elementClass =
+                bt_field_class_integer_signed_create(traceClass);
+            if (!elementClass)
+            {
+                return {};
+            }
+
+            fieldClass =
+                field.Type == SyntheticFieldType::IntegerArray ?
+                    bt_field_class_array_static_create(
+                        traceClass, elementClass.Get(), field.Length) :
+                    bt_field_class_array_dynamic_create(
+                        traceClass, elementClass.Get(), nullptr);
+            break;
+        }
+        }
+
+        if (!fieldClass ||
+            bt_field_class_structure_append_member(
+                payloadClass.Get(), field.Name.c_str(), fieldClass.Get()) !=
+                BT_FIELD_CLASS_STRUCTURE_APPEND_MEMBER_STATUS_OK)
+        {
+            return {};
+        }
+    }
+
+    return payloadClass;
+}
+
+bool CreateClasses(SyntheticSource& source, bt_self_component* selfComponent)
+{
+    source.TraceClass = bt_trace_class_create(selfComponent);
+    if (!source.TraceClass)
+    {
+        return false;
+    }
+
+    bt_trace_class* traceClass = source.TraceClass.Get();
+
+    // Nanosecond frequency and a Unix epoch origin, as LTTng's clocks have
+    BabelPtr<bt_clock_class> clockClass = bt_clock_class_create(selfComponent);
+    source.StreamClass = bt_stream_class_create(traceClass);
+    if (!clockClass || !source.StreamClass ||
+        bt_stream_class_set_default_clock_class(
+            source.StreamClass.Get(), clockClass.Get()) !=
+            BT_STREAM_CLASS_SET_DEFAULT_CLOCK_CLASS_STATUS_OK)
+    {
+        return false;
+    }
+
+    bt_stream_class_set_supports_packets(
+        source.StreamClass.Get(), BT_TRUE, BT_TRUE, BT_TRUE);
+
+    BabelPtr<bt_field_class> packetContextClass =
+        bt_field_class_structure_create(traceClass);
+    BabelPtr<bt_field_class> cpuIdClass =
+        bt_field_class_integer_unsigned_create(traceClass);
+    if (!packetContextClass || !cpuIdClass ||
+        bt_field_class_structure_append_member(
+            packetContextClass.Get(), "cpu_id", cpuIdClass.Get()) !=
+            BT_FIELD_CLASS_STRUCTURE_APPEND_MEMBER_STATUS_OK ||
+        bt_stream_class_set_packet_context_field_class(
+            source.StreamClass.Get(), packetContextClass.Get()) !=
+            BT_STREAM_CLASS_SET_FIELD_CLASS_STATUS_OK)
+    {
+        return false;
+    }
+
+    BabelPtr<bt_field_class> commonContextClass =
+        bt_field_class_structure_create(traceClass);
+    BabelPtr<bt_field_class> vpidClass =
+        bt_field_class_integer_signed_create(traceClass);
+    BabelPtr<bt_field_class> procnameClass =
+        bt_field_class_string_create(traceClass);
+    if (!commonContextClass || !vpidClass || !procnameClass ||
+        bt_field_class_structure_append_member(
+            commonContextClass.Get(), "vpid", vpidClass.Get()) !=
+            BT_FIELD_CLASS_STRUCTURE_APPEND_MEMBER_STATUS_OK ||
+        bt_field_class_structure_append_member(
+            commonContextClass.Get(), "procname", procnameClass.Get()) !=
+            BT_FIELD_CLASS_STRUCTURE_APPEND_MEMBER_STATUS_OK ||
+        bt_stream_class_set_event_common_context_field_class(
+            source.StreamClass.Get(), commonContextClass.Get()) !=
+            BT_STREAM_CLASS_SET_FIELD_CLASS_STATUS_OK)
+    {
+        return false;
+    }
+
+    source.EventClass = bt_event_class_create(source.StreamClass.Get());
+    BabelPtr<bt_field_class> payloadClass = CreatePayloadFieldClass(source);
+    if (!source.EventClass || !payloadClass ||
+        bt_event_class_set_name(
+            source.EventClass.Get(), source.Options.EventName.c_str()) !=
+            BT_EVENT_CLASS_SET_NAME_STATUS_OK ||
+        bt_event_class_set_payload_field_class(
+            source.EventClass.Get(), payloadClass.Get()) !=
+            BT_EVENT_CLASS_SET_FIELD_CLASS_STATUS_OK)
+    {
+        return false;
+    }
+
+    source.Trace = bt_trace_create(traceClass);
+    return source.Trace &&
+           bt_trace_set_name(source.Trace.Get(), "synthetic") ==
+               BT_TRACE_SET_NAME_STATUS_OK;
+}
+
+class SyntheticSourceIterator
+{
+  public:
+    SyntheticSourceIterator(
+        bt_self_message_iterator* self,
+        SyntheticSource& source,
+        uint32_t streamIndex)
+        : _self(self)
+        , _source(source)
+        , _streamIndex(streamIndex)
+    {}
+
+    bool Init()
+    {
+        _stream = bt_stream_create(
+            _source.StreamClass.Get(), _source.Trace.Get());
+        return static_cast<bool>(_stream);
+    }
+
+    bt_message_iterator_class_next_method_status
+    Next(bt_message_array_const messages, uint64_t capacity, uint64_t* count);
+
+  private:
+    uint64_t Timestamp(uint64_t eventIndex) const
+    {
+        return _source.FirstTimestamp + eventIndex * _source.EventSpacing +
+               _streamIndex;
+    }
+
+    // Events that are due by now, going by EventsPerSecond
+    uint64_t DueEvents() const;
+
+    bt_message* CreatePacketBeginning();
+
+    bt_message* CreateEvent();
+
+    bool FillPayload(bt_field* payload);
+
+  private:
+    bt_self_message_iterator* _self;
+    SyntheticSource& _source;
+    uint32_t _streamIndex;
+
+    BabelPtr<bt_stream> _stream;
+    BabelPtr<bt_packet> _packet;
+    uint64_t _eventIndex = 0;
+    uint32_t _packetEventCount = 0;
+    bool _begun = false;
+    bool _ended = false;
+
+    // Reused for each String field
+    std::string _stringValue;
+};
+
+uint64_t SyntheticSourceIterator::DueEvents() const
+{
+    const SyntheticSourceOptions& options = _source.Options;
+    if (options.EventsPerSecond == 0)
+    {
+        return UINT64_MAX;
+    }
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - _source.StartTime;
+
+    // The first event is due right away
+    return static_cast<uint64_t>(elapsed.count() * options.EventsPerSecond) +
+           1;
+}
+
+bt_message_iterator_class_next_method_status SyntheticSourceIterator::Next(
+    bt_message_array_const messages,
+    uint64_t capacity,
+    uint64_t* count)
+{
+    const SyntheticSourceOptions& options = _source.Options;
+    uint64_t dueEvents = DueEvents();
+
+    uint64_t emitted = 0;
+    while (emitted < capacity && !_ended)
+    {
+        bool streamDone = options.EventsPerStream != 0 &&
+                          _eventIndex == options.EventsPerStream;
+
+        bt_message* message = nullptr;
+        if (!_begun)
+        {
+            message = bt_message_stream_beginning_create(_self, _stream.Get());
+            _begun = true;
+        }
+        else if (
+            _packet &&
+            (_packetEventCount == options.EventsPerPacket || streamDone))
+        {
+            message = bt_message_packet_end_create_with_default_clock_snapshot(
+                _self, _packet.Get(), Timestamp(_eventIndex - 1));
+            _packet.Reset();
+        }
+        else if (streamDone)
+        {
+            message = bt_message_stream_end_create(_self, _stream.Get());
+            _ended = true;
+        }
+        else if (_eventIndex >= dueEvents)
+        {
+            break;
+        }
+        else if (!_packet)
+        {
+            message = CreatePacketBeginning();
+        }
+        else
+        {
+            message = CreateEvent();
+            _eventIndex++;
+            _packetEventCount++;
+        }
+
+        if (!message)
+        {
+            for (uint64_t i = 0; i < emitted; i++)
+            {
+                bt_message_put_ref(messages[i]);
+            }
+            return BT_MESSAGE_ITERATOR_CLASS_NEXT_METHOD_STATUS_MEMORY_ERROR;
+        }
+
+        messages[emitted++] = message;
+    }
+
+    if (emitted > 0)
+    {
+        *count = emitted;
+        return BT_MESSAGE_ITERATOR_CLASS_NEXT_METHOD_STATUS_OK;
+    }
+
+    return _ended ? BT_MESSAGE_ITERATOR_CLASS_NEXT_METHOD_STATUS_END :
+                    BT_MESSAGE_ITERATOR_CLASS_NEXT_METHOD_STATUS_AGAIN;
+}
+
+bt_message* SyntheticSourceIterator::CreatePacketBeginning()
+{
+    _packet = bt_packet_create(_stream.Get());
+    if (!_packet)
+    {
+        return nullptr;
+    }
+
+    bt_field_integer_unsigned_set_value(
+        bt_field_structure_borrow_member_field_by_index(
+            bt_packet_borrow_context_field(_packet.Get()), 0),
+        _streamIndex);
+
+    _packetEventCount = 0;
+
+    return bt_message_packet_beginning_create_with_default_clock_snapshot(
+        _self, _packet.Get(), Timestamp(_eventIndex));
+}
+
+bt_message* SyntheticSourceIterator::CreateEvent()
+{
+    bt_message* message =
+        bt_message_event_create_with_packet_and_default_clock_snapshot(
+            _self,
+            _source.EventClass.Get(),
+            _packet.Get(),
+            Timestamp(_eventIndex));
+    if (!message)
+    {
+        return nullptr;
+    }
+
+    bt_event* event = bt_message_event_borrow_event(message);
+
+    bt_field* commonContext = bt_event_borrow_common_context_field(event);
+    bt_field_integer_signed_set_value(
+        bt_field_structure_borrow_member_field_by_index(commonContext, 0),
+        _streamIndex + 1);
+    if (bt_field_string_set_value(
+            bt_field_structure_borrow_member_field_by_index(commonContext, 1),
+            "synthetic") != BT_FIELD_STRING_SET_VALUE_STATUS_OK ||
+        !FillPayload(bt_event_borrow_payload_field(event)))
+    {
+        bt_message_put_ref(message);
+        return nullptr;
+    }
+
+    return message;
+}
+
+bool SyntheticSourceIterator::FillPayload(bt_field* payload)
+{
+    // Pooled events keep the values of the last event they held, so every
+    // field is set each time
+    const std::vector<SyntheticField>& fields = _source.Options.Fields;
+    for (size_t i = 0; i < fields.size(); i++)
+    {
+        const SyntheticField& field = fields[i];
+        bt_field* member =
+            bt_field_structure_borrow_member_field_by_index(payload, i);
+
+        uint64_t elementCount = field.Length;
+        switch (field.Type)
+        {
+        case SyntheticFieldType::SignedInteger:
+            bt_field_integer_signed_set_value(
+                member, static_cast<int64_t>(_eventIndex));
+            break;
+        case SyntheticFieldType::UnsignedInteger:
+            bt_field_integer_unsigned_set_value(member, _eventIndex);
+            break;
+        case SyntheticFieldType::Real:
+            bt_field_real_double_precision_set_value(
+                member, static_cast<double>(_eventIndex));
+            break;
+        case SyntheticFieldType::String:
+            _stringValue.resize(field.Length);
+            for (uint32_t c = 0; c < field.Length; c++)
+            {
+                _stringValue[c] =
+                    static_cast<char>('a' + (_eventIndex + c) % 26);
+            }
+
+            if (bt_field_string_set_value(member, _stringValue.c_str()) !=
+                BT_FIELD_STRING_SET_VALUE_STATUS_OK)
+            {
+                return false;
+            }
+            break;
+        case SyntheticFieldType::Enumeration:
+            bt_field_integer_unsigned_set_value(
+                member, _eventIndex % field.Length);
+            break;
+        case SyntheticFieldType::IntegerSequence:
+            elementCount =
+                _eventIndex % (static_cast<uint64_t>(field.Length) + 1);
+            if (bt_field_array_dynamic_set_length(member, elementCount) !=
+                BT_FIELD_DYNAMIC_ARRAY_SET_LENGTH_STATUS_OK)
+            {
+                return false;
+            }
+            [[fallthrough]];
+        case SyntheticFieldType::IntegerArray:
+            for (uint64_t element = 0; element < elementCount; element++)
+            {
+                bt_field_integer_signed_set_value(
+                    bt_field_array_borrow_element_field_by_index(
+                        member, element),
+                    static_cast<int64_t>(element));
+            }
+            break;
+        }
+    }
+
+    return true;
+}
+
+bt_component_class_initialize_method_status SyntheticSource_InitStatic(
+    bt_self_component_source* self,
+    bt_self_component_source_configuration*,
+    const bt_value*,
+    void* initData)
+{
+    auto source = std::make_unique<SyntheticSource>();
+    source->Options = *static_cast<const SyntheticSourceOptions*>(initData);
+
+    bt_self_component* selfComponent =
+        bt_self_component_source_as_self_component(self);
+    if (!CreateClasses(*source, selfComponent))
+    {
+        return BT_COMPONENT_CLASS_INITIALIZE_METHOD_STATUS_MEMORY_ERROR;
+    }
+
+    // Streams take turns a nanosecond apart when events aren't paced
+    const SyntheticSourceOptions& options = source->Options;
+    source->EventSpacing = options.StreamCount;
+    if (options.EventsPerSecond > 0)
+    {
+        source->EventSpacing = std::max<uint64_t>(
+            source->EventSpacing,
+            static_cast<uint64_t>(1e9 / options.EventsPerSecond));
+    }
+
+    source->FirstTimestamp =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    source->StartTime = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < options.StreamCount; i++)
+    {
+        std::string portName = "out" + std::to_string(i);
+        bt_self_component_add_port_status addPortStatus =
+            bt_self_component_source_add_output_port(
+                self,
+                portName.c_str(),
+                reinterpret_cast<void*>(static_cast<uintptr_t>(i)),
+                nullptr);
+        if (addPortStatus != BT_SELF_COMPONENT_ADD_PORT_STATUS_OK)
+        {
+            return static_cast<bt_component_class_initialize_method_status>(
+                addPortStatus);
+        }
+    }
+
+    bt_self_component_set_data(selfComponent, source.release());
+
+    return BT_COMPONENT_CLASS_INITIALIZE_METHOD_STATUS_OK;
+}
+
+void SyntheticSource_FinalizeStatic(bt_self_component_source* self)
+{
+    delete static_cast<SyntheticSource*>(bt_self_component_get_data(
+        bt_self_component_source_as_self_component(self)));
+}
+
+bt_message_iterator_class_initialize_method_status
+SyntheticSourceIterator_InitStatic(
+    bt_self_message_iterator* self,
+    bt_self_message_iterator_configuration*,
+    bt_self_component_port_output* port)
+{
+    auto source = static_cast<SyntheticSource*>(bt_self_component_get_data(
+        bt_self_message_iterator_borrow_component(self)));
+    auto streamIndex = static_cast<uint32_t>(
+        reinterpret_cast<uintptr_t>(bt_self_component_port_get_data(
+            bt_self_component_port_output_as_self_component_port(port))));
+
+    auto sourceItr =
+        std::make_unique<SyntheticSourceIterator>(self, *source, streamIndex);
+    if (!sourceItr->Init())
+    {
+        return BT_MESSAGE_ITERATOR_CLASS_INITIALIZE_METHOD_STATUS_MEMORY_ERROR;
+    }
+
+    bt_self_message_iterator_set_data(self, sourceItr.release());
+
+    return BT_MESSAGE_ITERATOR_CLASS_INITIALIZE_METHOD_STATUS_OK;
+}
+
+bt_message_iterator_class_next_method_status SyntheticSourceIterator_NextStatic(
+    bt_self_message_iterator* self,
+    bt_message_array_const messages,
+    uint64_t capacity,
+    uint64_t* count)
+{
+    auto sourceItr = static_cast<SyntheticSourceIterator*>(
+        bt_self_message_iterator_get_data(self));
+
+    return sourceItr->Next(messages, capacity, count);
+}
+
+void SyntheticSourceIterator_FinalizeStatic(bt_self_message_iterator* self)
+{
+    delete static_cast<SyntheticSourceIterator*>(
+        bt_self_message_iterator_get_data(self));
+}
+
+}
+
+BabelPtr<const bt_component_class_source> GetSyntheticSourceComponentClass()
+{
+    BabelPtr<bt_message_iterator_class> sourceIteratorClass =
+        bt_message_iterator_class_create(SyntheticSourceIterator_NextStatic);
+    bt_message_iterator_class_set_initialize_method(
+        sourceIteratorClass.Get(), SyntheticSourceIterator_InitStatic);
+    bt_message_iterator_class_set_finalize_method(
+        sourceIteratorClass.Get(), SyntheticSourceIterator_FinalizeStatic);
+
+    BabelPtr<bt_component_class_source> sourceClass =
+        bt_component_class_source_create(
+            "synthetic", sourceIteratorClass.Get());
+    bt_component_class_source_set_initialize_method(
+        sourceClass.Get(), SyntheticSource_InitStatic);
+    bt_component_class_source_set_finalize_method(
+        sourceClass.Get(), SyntheticSource_FinalizeStatic);
+
+    BabelPtr<const bt_component_class_source> returnVal = sourceClass.Detach();
+
+    return returnVal;
+}
+
+}
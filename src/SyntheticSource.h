@@ -0,0 +1,22 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <lttng-consume/LttngConsumerOptions.h>
+
+#include "BabelPtr.h"
+
+namespace LttngConsume {
+
+// Throws std::invalid_argument for options the source can't generate, such
+// as no streams or two fields of the same name
+void ValidateSyntheticSourceOptions(const SyntheticSourceOptions& options);
+
+// Source that generates events as a SyntheticSourceOptions, passed as the
+// initialize method data, describes. It has one output port per stream and
+// wraps events in packets the way LTTng does, so it can stand in for
+// src.ctf.lttng-live or src.ctf.fs anywhere in the graph.
+BabelPtr<const bt_component_class_source> GetSyntheticSourceComponentClass();
+
+}
@@ -0,0 +1,181 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "ThreadPlacement.h"
+
+#include <cerrno>
+#include <climits>
+#include <stdexcept>
+#include <string>
+
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace LttngConsume {
+
+// Nodes a saved memory policy can name. get_mempolicy() fails if the host
+// has more.
+static constexpr size_t c_maxNodes = 1024;
+
+static constexpr size_t c_bitsPerLong = sizeof(unsigned long) * CHAR_BIT;
+
+// The kernel reads one bit less than maxnode says
+static unsigned long MaxNodeArgument(const std::vector<unsigned long>& nodes)
+{
+    return nodes.size() * c_bitsPerLong + 1;
+}
+
+// Called through syscall() rather than libnuma, which only wraps them
+static long SetMemoryPolicy(int mode, const std::vector<unsigned long>& nodes)
+{
+    return syscall(
+        SYS_set_mempolicy,
+        mode,
+        nodes.empty() ? nullptr : nodes.data(),
+        nodes.empty() ? 0 : MaxNodeArgument(nodes));
+}
+
+void ValidateThreadPlacement(const ThreadPlacementOptions& placement)
+{
+    for (uint32_t cpu : placement.Cpus)
+    {
+        if (cpu >= CPU_SETSIZE)
+        {
+            throw std::invalid_argument(
+                "CPU " + std::to_string(cpu) + " is beyond CPU_SETSIZE");
+        }
+    }
+}
+
+std::error_code ApplyThreadPlacement(const ThreadPlacementOptions& placement)
+{
+    if (!placement.Cpus.empty())
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (uint32_t cpu : placement.Cpus)
+        {
+            CPU_SET(cpu, &cpus);
+        }
+
+        int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (error != 0)
+        {
+            return std::error_code(error, std::generic_category());
+        }
+    }
+
+    if (placement.NumaNode)
+    {
+        // Preferred rather than bound, so allocations still succeed once
+        // the node runs out of memory
+        uint32_t node = *placement.NumaNode;
+        std::vector<unsigned long> nodes(node / c_bitsPerLong + 1);
+        nodes[node / c_bitsPerLong] |= 1ul << (node % c_bitsPerLong);
+
+        if (SetMemoryPolicy(MPOL_PREFERRED, nodes) != 0)
+        {
+            return std::error_code(errno, std::generic_category());
+        }
+    }
+
+    return {};
+}
+
+ScopedThreadPlacement::ScopedThreadPlacement(
+    const ThreadPlacementOptions& placement)
+{
+    if (!placement.Cpus.empty())
+    {
+        int error = pthread_getaffinity_np(
+            pthread_self(), sizeof(_previousCpus), &_previousCpus);
+        if (error != 0)
+        {
+            throw std::system_error(
+                error, std::generic_category(), "pthread_getaffinity_np");
+        }
+    }
+
+    if (placement.NumaNode)
+    {
+        _previousNodes.resize(c_maxNodes / c_bitsPerLong);
+        if (syscall(
+                SYS_get_mempolicy,
+                &_previousMode,
+                _previousNodes.data(),
+                MaxNodeArgument(_previousNodes),
+                nullptr,
+                0) != 0)
+        {
+            throw std::system_error(
+                errno, std::generic_category(), "get_mempolicy");
+        }
+    }
+
+    std::error_code error = ApplyThreadPlacement(placement);
+    _restoreCpus = !placement.Cpus.empty();
+    _restoreMemoryPolicy = placement.NumaNode.has_value();
+
+    if (error)
+    {
+        // Undo whichever half was applied
+        Restore();
+        throw std::system_error(error, "Thread placement");
+    }
+}
+
+void PlacementErrors::Set(std::error_code error)
+{
+    std::lock_guard<std::mutex> lock{ _mutex };
+    if (!_error)
+    {
+        _error = error;
+        _failed.store(true, std::memory_order_release);
+    }
+}
+
+void PlacementErrors::Rethrow()
+{
+    std::error_code error;
+    {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        error = _error;
+        _error.clear();
+        _failed.store(false, std::memory_order_release);
+    }
+
+    if (error)
+    {
+        throw std::system_error(error, "Thread placement");
+    }
+}
+
+ScopedThreadPlacement::~ScopedThreadPlacement()
+{
+    Restore();
+}
+
+void ScopedThreadPlacement::Restore()
+{
+    if (_restoreCpus)
+    {
+        pthread_setaffinity_np(
+            pthread_self(), sizeof(_previousCpus), &_previousCpus);
+        _restoreCpus = false;
+    }
+
+    if (_restoreMemoryPolicy)
+    {
+        if (_previousMode == MPOL_DEFAULT)
+        {
+            _previousNodes.clear();
+        }
+
+        SetMemoryPolicy(_previousMode, _previousNodes);
+        _restoreMemoryPolicy = false;
+    }
+}
+
+}
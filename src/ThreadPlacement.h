@@ -0,0 +1,69 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <system_error>
+#include <vector>
+
+#include <sched.h>
+
+#include <lttng-consume/LttngConsumerOptions.h>
+
+namespace LttngConsume {
+
+// Throws std::invalid_argument for a CPU beyond what cpu_set_t can hold
+void ValidateThreadPlacement(const ThreadPlacementOptions& placement);
+
+// Moves the calling thread onto placement.Cpus and has it prefer memory on
+// placement.NumaNode, leaving out whichever is unset. Returns the error of
+// the system call that failed, if any.
+std::error_code ApplyThreadPlacement(const ThreadPlacementOptions& placement);
+
+// Placement failures of the library's own threads, which are rethrown by
+// StartConsuming() once they have all stopped. Thread safe.
+class PlacementErrors
+{
+  public:
+    // Keeps the first error only
+    void Set(std::error_code error);
+
+    bool Failed() const { return _failed.load(std::memory_order_acquire); }
+
+    // Throws std::system_error with the error kept, if any, and forgets it
+    void Rethrow();
+
+  private:
+    std::mutex _mutex;
+    std::error_code _error;
+    std::atomic<bool> _failed{ false };
+};
+
+// Applies a placement to a thread the library doesn't own, such as the one
+// calling StartConsuming(), and puts back its previous affinity and memory
+// policy when destroyed. Throws std::system_error if it can't be applied.
+class ScopedThreadPlacement
+{
+  public:
+    explicit ScopedThreadPlacement(const ThreadPlacementOptions& placement);
+
+    ~ScopedThreadPlacement();
+
+    ScopedThreadPlacement(const ScopedThreadPlacement&) = delete;
+    ScopedThreadPlacement& operator=(const ScopedThreadPlacement&) = delete;
+
+  private:
+    void Restore();
+
+  private:
+    bool _restoreCpus = false;
+    cpu_set_t _previousCpus;
+
+    bool _restoreMemoryPolicy = false;
+    int _previousMode = 0;
+    std::vector<unsigned long> _previousNodes;
+};
+
+}
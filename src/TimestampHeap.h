@@ -0,0 +1,119 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace LttngConsume {
+
+// Binary min-heap of (timestamp, source index) pairs used for k-way merges.
+// Keys are cached inline so sifting never touches the sources themselves,
+// and ties are broken by source index to keep the merge deterministic.
+class TimestampHeap
+{
+  public:
+    struct Entry
+    {
+        int64_t Timestamp;
+        uint32_t Source;
+    };
+
+    bool Empty() const { return _entries.empty(); }
+
+    size_t Size() const { return _entries.size(); }
+
+    const Entry& Top() const { return _entries.front(); }
+
+    void Clear() { _entries.clear(); }
+
+    void Push(int64_t timestamp, uint32_t source)
+    {
+        _entries.push_back(Entry{ timestamp, source });
+        SiftUp(_entries.size() - 1);
+    }
+
+    void Pop()
+    {
+        _entries.front() = _entries.back();
+        _entries.pop_back();
+        if (!_entries.empty())
+        {
+            SiftDown(0);
+        }
+    }
+
+    // Re-keys the top entry after its source advanced. Cheaper than a
+    // Pop followed by a Push since only one sift is needed.
+    void ReplaceTop(int64_t timestamp)
+    {
+        _entries.front().Timestamp = timestamp;
+        SiftDown(0);
+    }
+
+  private:
+    static bool Less(const Entry& lhs, const Entry& rhs)
+    {
+        if (lhs.Timestamp != rhs.Timestamp)
+        {
+            return lhs.Timestamp < rhs.Timestamp;
+        }
+
+        return lhs.Source < rhs.Source;
+    }
+
+    void SiftUp(size_t index)
+    {
+        Entry entry = _entries[index];
+        while (index > 0)
+        {
+            size_t parent = (index - 1) / 2;
+            if (!Less(entry, _entries[parent]))
+            {
+                break;
+            }
+
+            _entries[index] = _entries[parent];
+            index = parent;
+        }
+
+        _entries[index] = entry;
+    }
+
+    void SiftDown(size_t index)
+    {
+        Entry entry = _entries[index];
+        size_t count = _entries.size();
+        while (true)
+        {
+            size_t child = index * 2 + 1;
+            if (child >= count)
+            {
+                break;
+            }
+
+            if (child + 1 < count && Less(_entries[child + 1], _entries[child]))
+            {
+                child++;
+            }
+
+            if (!Less(_entries[child], entry))
+            {
+                break;
+            }
+
+            _entries[index] = _entries[child];
+            index = child;
+        }
+
+        _entries[index] = entry;
+    }
+
+  private:
+    std::vector<Entry> _entries;
+};
+
+}
@@ -0,0 +1,195 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "TypedEventDecoder.h"
+
+#include <optional>
+#include <string>
+
+#include <babeltrace2/babeltrace.h>
+
+#include "ConsumerCounters.h"
+#include "FailureHelpers.h"
+#include "LttngJsonReader.h"
+
+namespace LttngConsume {
+
+TypedEventDecoder::TypedEventDecoder(
+    std::vector<std::shared_ptr<TypedEventHandler>> handlers,
+    ConsumerCounters& counters)
+    : _handlers(std::move(handlers))
+    , _counters(counters)
+{
+    for (const auto& handler : _handlers)
+    {
+        std::vector<FieldPath> paths;
+        for (const auto& field : handler->Fields())
+        {
+            paths.emplace_back(field.first);
+        }
+
+        _handlerPaths.push_back(std::move(paths));
+    }
+}
+
+template<typename T>
+static void SetNumber(TypedFieldValue& value, TypedFieldKind kind, T number)
+{
+    switch (kind)
+    {
+    case TypedFieldKind::Signed:
+        value.Signed = static_cast<int64_t>(number);
+        break;
+    case TypedFieldKind::Unsigned:
+        value.Unsigned = static_cast<uint64_t>(number);
+        break;
+    case TypedFieldKind::Real:
+        value.Real = static_cast<double>(number);
+        break;
+    case TypedFieldKind::Bool:
+        value.Bool = number != 0;
+        break;
+    case TypedFieldKind::String:
+        FAIL_FAST_IF(true);
+    }
+}
+
+bool TypedEventDecoder::IsBound(const bt_message* message)
+{
+    const bt_event_class* eventClass = bt_event_borrow_class_const(
+        bt_message_event_borrow_event_const(message));
+
+    if (eventClass != _lastEventClass)
+    {
+        _lastClassBinding = &GetClassBinding(eventClass);
+        _lastEventClass = eventClass;
+    }
+
+    return _lastClassBinding->Handler != nullptr;
+}
+
+void TypedEventDecoder::Deliver(const bt_message* message)
+{
+    const bt_event* event = bt_message_event_borrow_event_const(message);
+
+    // Always follows IsBound() for the same event
+    FAIL_FAST_IF(bt_event_borrow_class_const(event) != _lastEventClass);
+    ClassBinding& binding = *_lastClassBinding;
+
+    _values.resize(binding.Fields.size());
+
+    for (size_t i = 0; i < binding.Fields.size(); i++)
+    {
+        const BoundField& boundField = binding.Fields[i];
+        const bt_field* field = boundField.Path.Borrow(event);
+        TypedFieldValue& value = _values[i];
+
+        switch (boundField.Reader)
+        {
+        case FieldReader::Bool:
+            SetNumber(value, boundField.Kind, bt_field_bool_get_value(field));
+            break;
+        case FieldReader::Unsigned:
+            SetNumber(
+                value,
+                boundField.Kind,
+                bt_field_integer_unsigned_get_value(field));
+            break;
+        case FieldReader::Signed:
+            SetNumber(
+                value,
+                boundField.Kind,
+                bt_field_integer_signed_get_value(field));
+            break;
+        case FieldReader::SingleReal:
+            SetNumber(
+                value,
+                boundField.Kind,
+                bt_field_real_single_precision_get_value(field));
+            break;
+        case FieldReader::DoubleReal:
+            SetNumber(
+                value,
+                boundField.Kind,
+                bt_field_real_double_precision_get_value(field));
+            break;
+        case FieldReader::String:
+            value.String = std::string_view{
+                bt_field_string_get_value(field),
+                static_cast<size_t>(bt_field_string_get_length(field))
+            };
+            break;
+        }
+    }
+
+    binding.Handler->Deliver(_values.data());
+}
+
+TypedEventDecoder::ClassBinding&
+TypedEventDecoder::GetClassBinding(const bt_event_class* eventClass)
+{
+    auto itr = _classBindings.find(eventClass);
+    if (itr != _classBindings.end())
+    {
+        return itr->second;
+    }
+
+    ClassBinding binding;
+    bt_event_class_get_ref(eventClass);
+    binding.EventClass = eventClass;
+
+    std::string eventName = GetEventName(eventClass);
+    for (size_t i = 0; i < _handlers.size(); i++)
+    {
+        if (_handlers[i]->EventName() == eventName)
+        {
+            if (BindFields(i, eventClass, binding))
+            {
+                binding.Handler = _handlers[i].get();
+            }
+
+            break;
+        }
+    }
+
+    return _classBindings.emplace(eventClass, std::move(binding))
+        .first->second;
+}
+
+bool TypedEventDecoder::BindFields(
+    size_t handlerIndex,
+    const bt_event_class* eventClass,
+    ClassBinding& binding)
+{
+    const TypedEventHandler& handler = *_handlers[handlerIndex];
+    const std::vector<FieldPath>& paths = _handlerPaths[handlerIndex];
+
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        TypedFieldKind kind = handler.Fields()[i].second;
+
+        std::optional<ResolvedFieldPath> resolved =
+            ResolvedFieldPath::Resolve(paths[i], eventClass);
+        std::optional<FieldReader> reader =
+            resolved ? GetFieldReader(resolved->FieldClass()) : std::nullopt;
+
+        // Strings only bind to strings, numbers to any number
+        bool compatible = reader && (kind == TypedFieldKind::String) ==
+                                        (*reader == FieldReader::String);
+        if (!compatible)
+        {
+            // Events of the class keep being decoded to JSON
+            _counters.TypedBindingFailures.fetch_add(
+                1, std::memory_order_relaxed);
+
+            binding.Fields.clear();
+            return false;
+        }
+
+        binding.Fields.push_back(BoundField{ *resolved, *reader, kind });
+    }
+
+    return true;
+}
+
+}
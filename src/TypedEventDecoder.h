@@ -0,0 +1,80 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <lttng-consume/TypedEvent.h>
+
+#include "BabelPtr.h"
+#include "FieldPath.h"
+
+namespace LttngConsume {
+
+struct ConsumerCounters;
+
+// Reads the fields bound by TypedEventHandlers straight from babeltrace
+// fields and hands them over without building any JSON. Handlers are
+// matched to an event class, and their fields resolved and checked against
+// its field classes, once per class. Graph thread only, since it holds
+// references on the event classes it has seen.
+class TypedEventDecoder
+{
+  public:
+    // Throws std::invalid_argument if a field path is malformed
+    TypedEventDecoder(
+        std::vector<std::shared_ptr<TypedEventHandler>> handlers,
+        ConsumerCounters& counters);
+
+    // Returns false if no handler is bound to the class of the event, which
+    // is then decoded to JSON as usual
+    bool IsBound(const bt_message* message);
+
+    // Passes an event for which IsBound() held to its handler
+    void Deliver(const bt_message* message);
+
+  private:
+    struct BoundField
+    {
+        ResolvedFieldPath Path;
+        FieldReader Reader;
+        TypedFieldKind Kind;
+    };
+
+    struct ClassBinding
+    {
+        BabelPtr<const bt_event_class> EventClass;
+
+        // Null when no handler is bound to the class
+        TypedEventHandler* Handler = nullptr;
+        std::vector<BoundField> Fields;
+    };
+
+    ClassBinding& GetClassBinding(const bt_event_class* eventClass);
+
+    // Returns false, counting the class in TypedBindingFailures, if a field
+    // is missing or can't be converted to its member
+    bool BindFields(
+        size_t handlerIndex,
+        const bt_event_class* eventClass,
+        ClassBinding& binding);
+
+  private:
+    std::vector<std::shared_ptr<TypedEventHandler>> _handlers;
+    ConsumerCounters& _counters;
+    std::vector<std::vector<FieldPath>> _handlerPaths;
+
+    std::unordered_map<const bt_event_class*, ClassBinding> _classBindings;
+
+    // Consecutive events are usually of the same class
+    const bt_event_class* _lastEventClass = nullptr;
+    ClassBinding* _lastClassBinding = nullptr;
+
+    std::vector<TypedFieldValue> _values;
+};
+
+}
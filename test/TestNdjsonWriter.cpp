@@ -0,0 +1,92 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <catch2/catch.hpp>
+#include <lttng-consume/LttngEventBatch.h>
+#include <lttng-consume/NdjsonWriter.h>
+
+using namespace jsonbuilder;
+
+TEST_CASE("NdjsonWriter writes and rotates files", "[writer]")
+{
+    char directoryTemplate[] = "/tmp/lttngconsume-ndjson-XXXXXX";
+    REQUIRE(mkdtemp(directoryTemplate) != nullptr);
+    std::filesystem::path directory{ directoryTemplate };
+
+    LttngConsume::NdjsonWriterOptions writerOptions;
+    writerOptions.Directory = directory.string();
+    writerOptions.MaxFileBytes = 16 * 1024;
+    writerOptions.BufferBytes = 4096;
+
+    constexpr int c_eventsToWrite = 2000;
+    constexpr int c_eventsPerBatch = 100;
+
+    // Line lengths don't divide the buffer size, so lines keep reaching
+    // the end of a buffer, and every 500th is longer than a whole buffer
+    auto textLength = [](int index) {
+        return index % 500 == 499 ? 6000 : index % 97;
+    };
+
+    {
+        LttngConsume::NdjsonWriter writer{ writerOptions };
+
+        LttngConsume::LttngEventBatch batch;
+        for (int i = 0; i < c_eventsToWrite; i++)
+        {
+            JsonBuilder& event = batch.EmplaceBack();
+            event.push_back(event.root(), "index", i);
+            event.push_back(
+                event.root(), "text", std::string(textLength(i), 'y'));
+
+            if (batch.size() == c_eventsPerBatch)
+            {
+                writer.Write(batch);
+                batch.Clear();
+            }
+        }
+
+        writer.Flush();
+    }
+
+    int fileCount = 0;
+    int lineCount = 0;
+    int longLineCount = 0;
+    for (const auto& entry : std::filesystem::directory_iterator{ directory })
+    {
+        fileCount++;
+
+        std::ifstream file{ entry.path() };
+        std::string line;
+        while (std::getline(file, line))
+        {
+            REQUIRE(line.substr(0, 9) == "{\"index\":");
+            REQUIRE(line.back() == '}');
+
+            int index = std::stoi(line.substr(9));
+            REQUIRE(
+                std::count(line.begin(), line.end(), 'y') == textLength(index));
+
+            if (textLength(index) > 4096)
+            {
+                longLineCount++;
+            }
+            lineCount++;
+        }
+
+        REQUIRE(
+            std::filesystem::file_size(entry.path()) <=
+            writerOptions.MaxFileBytes);
+    }
+
+    std::filesystem::remove_all(directory);
+
+    REQUIRE(lineCount == c_eventsToWrite);
+    REQUIRE(longLineCount == c_eventsToWrite / 500);
+    REQUIRE(fileCount > 1);
+}
@@ -0,0 +1,74 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <catch2/catch.hpp>
+#include <lttng-consume/LttngEventBatch.h>
+#include <lttng-consume/ShmRingReader.h>
+#include <lttng-consume/ShmRingWriter.h>
+
+using namespace jsonbuilder;
+
+TEST_CASE("ShmRingReader receives events from ShmRingWriter", "[writer]")
+{
+    LttngConsume::ShmRingOptions ringOptions;
+    ringOptions.Name = "/lttngconsume-test-ring";
+    ringOptions.CapacityBytes = 1024 * 1024;
+
+    auto writer = std::make_unique<LttngConsume::ShmRingWriter>(ringOptions);
+    LttngConsume::ShmRingReader reader{ ringOptions.Name };
+
+    constexpr int c_eventsToWrite = 2500;
+    constexpr int c_eventsPerBatch = 25;
+
+    int eventsRead = 0;
+    std::thread readerThread{ [&reader, &eventsRead]() {
+        while (!reader.IsClosed())
+        {
+            reader.Wait(std::chrono::milliseconds{ 100 });
+            reader.Read([&eventsRead](const LttngConsume::ShmRingEvent& event) {
+                JsonBuilder jsonBuilder(event.Data, event.Size);
+
+                auto itr = jsonBuilder.find("index");
+                REQUIRE(itr != jsonBuilder.end());
+                REQUIRE(itr->GetUnchecked<int>() == eventsRead);
+
+                itr = jsonBuilder.find("text");
+                REQUIRE(itr != jsonBuilder.end());
+                REQUIRE(
+                    itr->GetUnchecked<std::string_view>() ==
+                    std::string(eventsRead % 61, 'y'));
+
+                eventsRead++;
+            });
+        }
+    } };
+
+    // The ring holds every event at once, so none are dropped however far
+    // the reader falls behind
+    LttngConsume::LttngEventBatch batch;
+    for (int i = 0; i < c_eventsToWrite; i++)
+    {
+        JsonBuilder& event = batch.EmplaceBack();
+        event.push_back(event.root(), "index", i);
+        event.push_back(event.root(), "text", std::string(i % 61, 'y'));
+
+        if (batch.size() == c_eventsPerBatch)
+        {
+            REQUIRE(writer->Write(batch) == c_eventsPerBatch);
+            batch.Clear();
+        }
+    }
+
+    REQUIRE(writer->GetDroppedEvents() == 0);
+
+    // Closing the ring lets the reader finish once it has read everything
+    writer.reset();
+    readerThread.join();
+
+    REQUIRE(eventsRead == c_eventsToWrite);
+}
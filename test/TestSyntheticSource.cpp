@@ -0,0 +1,354 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <catch2/catch.hpp>
+#include <lttng-consume/LttngConsumer.h>
+
+using namespace jsonbuilder;
+
+// These read the built-in synthetic source, so unlike TestTracepoint.cpp
+// they don't need an lttng session daemon
+
+TEST_CASE("LttngConsumer decodes synthetic events in order", "[synthetic]")
+{
+    constexpr uint32_t c_streamCount = 4;
+    constexpr uint64_t c_eventsPerStream = 1000;
+
+    LttngConsume::LttngConsumerOptions options;
+    options.Ordering = LttngConsume::MessageOrdering::TimestampMerge;
+    options.Synthetic.StreamCount = c_streamCount;
+    options.Synthetic.EventsPerStream = c_eventsPerStream;
+    options.Synthetic.EventsPerPacket = 64;
+    options.Synthetic.Fields = {
+        { "unsigned", LttngConsume::SyntheticFieldType::UnsignedInteger },
+        { "signed", LttngConsume::SyntheticFieldType::SignedInteger },
+        { "real", LttngConsume::SyntheticFieldType::Real },
+        { "string", LttngConsume::SyntheticFieldType::String, 6 },
+        { "enum", LttngConsume::SyntheticFieldType::Enumeration, 3 },
+        { "array", LttngConsume::SyntheticFieldType::IntegerArray, 3 },
+        { "sequence", LttngConsume::SyntheticFieldType::IntegerSequence, 2 }
+    };
+
+    // The source can't seek, so a time window is checked on each event
+    LttngConsume::LttngConsumerOptions pastOptions = options;
+    pastOptions.End =
+        std::chrono::system_clock::now() - std::chrono::seconds{ 1 };
+
+    LttngConsume::LttngConsumer pastConsumer{
+        "synthetic://", std::chrono::milliseconds{ 50 }, pastOptions
+    };
+
+    int pastCallbacks = 0;
+    pastConsumer.StartConsuming(
+        [&pastCallbacks](JsonBuilder&&) { pastCallbacks++; });
+
+    REQUIRE(pastCallbacks == 0);
+    REQUIRE(
+        pastConsumer.GetStatistics().EventsOutsideWindow ==
+        c_streamCount * c_eventsPerStream);
+
+    LttngConsume::LttngConsumer consumer{ "synthetic://",
+                                          std::chrono::milliseconds{ 50 },
+                                          options };
+
+    // Timestamps interleave the streams, so the events arrive round-robin
+    uint64_t eventCallbacks = 0;
+    consumer.StartConsuming([&eventCallbacks](JsonBuilder&& jsonBuilder) {
+        uint64_t index = eventCallbacks / c_streamCount;
+        uint64_t stream = eventCallbacks % c_streamCount;
+
+        auto itr = jsonBuilder.find("name");
+        REQUIRE(itr != jsonBuilder.end());
+        REQUIRE(itr->GetUnchecked<std::string_view>() == "synthetic.event");
+
+        itr = jsonBuilder.find("packetContext", "cpu_id");
+        REQUIRE(itr != jsonBuilder.end());
+        REQUIRE(itr->GetUnchecked<uint64_t>() == stream);
+
+        itr = jsonBuilder.find("streamEventContext", "vpid");
+        REQUIRE(itr != jsonBuilder.end());
+        REQUIRE(itr->GetUnchecked<int64_t>() == int64_t(stream + 1));
+
+        itr = jsonBuilder.find("data", "unsigned");
+        REQUIRE(itr != jsonBuilder.end());
+        REQUIRE(itr->Type() == JsonUInt);
+        REQUIRE(itr->GetUnchecked<uint64_t>() == index);
+
+        itr = jsonBuilder.find("data", "signed");
+        REQUIRE(itr != jsonBuilder.end());
+        REQUIRE(itr->Type() == JsonInt);
+        REQUIRE(itr->GetUnchecked<int64_t>() == int64_t(index));
+
+        itr = jsonBuilder.find("data", "real");
+        REQUIRE(itr != jsonBuilder.end());
+        REQUIRE(itr->Type() == JsonFloat);
+        REQUIRE(itr->GetUnchecked<double>() == double(index));
+
+        std::string expectedString;
+        for (uint64_t c = 0; c < 6; c++)
+        {
+            expectedString += static_cast<char>('a' + (index + c) % 26);
+        }
+
+        itr = jsonBuilder.find("data", "string");
+        REQUIRE(itr != jsonBuilder.end());
+        REQUIRE(itr->GetUnchecked<std::string_view>() == expectedString);
+
+        itr = jsonBuilder.find("data", "enum");
+        REQUIRE(itr != jsonBuilder.end());
+        REQUIRE(itr->Type() == JsonUtf8);
+        REQUIRE(
+            itr->GetUnchecked<std::string_view>() ==
+            "LABEL" + std::to_string(index % 3));
+
+        itr = jsonBuilder.find("data", "array");
+        REQUIRE(itr != jsonBuilder.end());
+        REQUIRE(jsonBuilder.count(itr) == 3);
+
+        int i = 0;
+        for (auto valItr = itr.begin(); valItr != itr.end(); ++valItr, ++i)
+        {
+            REQUIRE(valItr->GetUnchecked<int>() == i);
+        }
+
+        itr = jsonBuilder.find("data", "sequence");
+        REQUIRE(itr != jsonBuilder.end());
+        REQUIRE(jsonBuilder.count(itr) == index % 3);
+
+        eventCallbacks++;
+    });
+
+    REQUIRE(eventCallbacks == c_streamCount * c_eventsPerStream);
+}
+
+TEST_CASE("LttngConsumer paces synthetic events", "[synthetic]")
+{
+    constexpr double c_eventsPerSecond = 2000;
+
+    LttngConsume::LttngConsumerOptions options;
+    options.Synthetic.StreamCount = 2;
+    options.Synthetic.EventsPerSecond = c_eventsPerSecond;
+
+    auto start = std::chrono::steady_clock::now();
+
+    LttngConsume::LttngConsumer consumer{ "synthetic://",
+                                          std::chrono::milliseconds{ 10 },
+                                          options };
+
+    uint64_t eventCallbacks = 0;
+    std::thread consumptionThread{ [&consumer, &eventCallbacks]() {
+        consumer.StartConsuming(
+            [&eventCallbacks](JsonBuilder&&) { eventCallbacks++; });
+    } };
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{ 500 });
+
+    consumer.StopConsuming();
+    consumptionThread.join();
+
+    double elapsedSeconds = std::chrono::duration<double>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+
+    // Never ahead of the rate, only behind it while the graph sleeps
+    REQUIRE(eventCallbacks > 0);
+    double dueEvents = c_eventsPerSecond * elapsedSeconds + 1;
+    REQUIRE(eventCallbacks <= options.Synthetic.StreamCount * dueEvents);
+}
+
+TEST_CASE("LttngConsumer moves events into by-value callbacks", "[synthetic]")
+{
+    constexpr int c_eventsPerStream = 250;
+
+    LttngConsume::LttngConsumerOptions options;
+    options.Synthetic.EventsPerStream = c_eventsPerStream;
+
+    LttngConsume::LttngConsumer consumer{ "synthetic://",
+                                          std::chrono::milliseconds{ 50 },
+                                          options };
+
+    // Taking the event by value moves it out of the batch, as the
+    // std::function overload does, rather than copying it
+    int eventCallbacks = 0;
+    consumer.StartConsuming([&eventCallbacks](JsonBuilder jsonBuilder) {
+        auto itr = jsonBuilder.find("data", "value");
+        REQUIRE(itr != jsonBuilder.end());
+        REQUIRE(itr->GetUnchecked<uint64_t>() == uint64_t(eventCallbacks));
+
+        eventCallbacks++;
+    });
+
+    REQUIRE(eventCallbacks == c_eventsPerStream);
+}
+
+TEST_CASE("LttngConsumer counts unbound typed events", "[synthetic]")
+{
+    constexpr int c_eventsPerStream = 250;
+
+    LttngConsume::LttngConsumerOptions options;
+    options.Synthetic.EventsPerStream = c_eventsPerStream;
+
+    LttngConsume::LttngConsumer consumer{ "synthetic://",
+                                          std::chrono::milliseconds{ 50 },
+                                          options };
+
+    struct ValueEvent
+    {
+        uint64_t Value;
+    };
+
+    // A class lacking a bound field stays JSON, and is counted once
+    int typedCallbacks = 0;
+    consumer.AddTypedEvent(LttngConsume::MakeTypedEvent<ValueEvent>(
+        "synthetic.event",
+        { LttngConsume::Bind<&ValueEvent::Value>("data.missing") },
+        [&typedCallbacks](const ValueEvent&) { typedCallbacks++; }));
+
+    int jsonCallbacks = 0;
+    consumer.StartConsuming(
+        [&jsonCallbacks](JsonBuilder&&) { jsonCallbacks++; });
+
+    REQUIRE(typedCallbacks == 0);
+    REQUIRE(jsonCallbacks == c_eventsPerStream);
+    REQUIRE(consumer.GetStatistics().TypedBindingFailures == 1);
+}
+
+TEST_CASE("LttngConsumer filters on decimal and hex literals", "[synthetic]")
+{
+    // Leading zeros are still decimal, and 0x introduces hex
+    const std::pair<const char*, int> c_literalFilters[] = {
+        { "data.value == 010", 10 }, { "data.value == 0x10", 16 }
+    };
+
+    for (auto [filter, expectedValue] : c_literalFilters)
+    {
+        LttngConsume::LttngConsumerOptions options;
+        options.Synthetic.EventsPerStream = 20;
+        options.Filter = filter;
+
+        LttngConsume::LttngConsumer consumer{ "synthetic://",
+                                              std::chrono::milliseconds{ 50 },
+                                              options };
+
+        std::vector<int> values;
+        consumer.StartConsuming([&values](JsonBuilder&& jsonBuilder) {
+            values.push_back(
+                jsonBuilder.find("data", "value")->GetUnchecked<int>());
+        });
+
+        REQUIRE(values == std::vector<int>{ expectedValue });
+    }
+}
+
+TEST_CASE("LttngConsumer charges held events to its budget", "[synthetic]")
+{
+    constexpr uint64_t c_eventsPerStream = 1000;
+
+    LttngConsume::LttngConsumerOptions options;
+    options.Synthetic.EventsPerStream = c_eventsPerStream;
+    options.MemoryBudget.MaxBytes = 1;
+    options.MemoryBudget.Policy = LttngConsume::MemoryBudgetPolicy::Drop;
+
+    LttngConsume::LttngConsumer consumer{ "synthetic://",
+                                          std::chrono::milliseconds{ 50 },
+                                          options };
+
+    // Held events stay charged until they are released, so holding them
+    // drops the events read after them without any shard queues
+    std::vector<std::shared_ptr<JsonBuilder>> heldEvents;
+    consumer.StartConsumingBatches(
+        [&heldEvents](LttngConsume::LttngEventBatch& batch) {
+            for (size_t i = 0; i < batch.size(); i++)
+            {
+                heldEvents.push_back(batch.Hold(i));
+            }
+        });
+
+    LttngConsume::LttngConsumerStatistics statistics = consumer.GetStatistics();
+    REQUIRE(!heldEvents.empty());
+    REQUIRE(statistics.EventsOverBudget > 0);
+    REQUIRE(
+        heldEvents.size() + statistics.EventsOverBudget == c_eventsPerStream);
+    REQUIRE(statistics.InFlightBytes > 0);
+
+    heldEvents.clear();
+    REQUIRE(consumer.GetStatistics().InFlightBytes == 0);
+}
+
+TEST_CASE("LttngConsumer returns the last window when pulled", "[synthetic]")
+{
+    constexpr uint64_t c_eventsPerStream = 1000;
+
+    LttngConsume::LttngConsumerOptions options;
+    options.Synthetic.EventsPerStream = c_eventsPerStream;
+    options.Aggregation.Interval = std::chrono::hours{ 1 };
+
+    auto countEvents = [](LttngConsume::LttngEventBatch& batch) {
+        uint64_t count = 0;
+        for (JsonBuilder& summary : batch)
+        {
+            auto itr = summary.find("data", "synthetic.event", "count");
+            REQUIRE(itr != summary.end());
+            count += itr->GetUnchecked<uint64_t>();
+        }
+        return count;
+    };
+
+    // Every window reaches the caller, the last one at the end of the trace
+    {
+        LttngConsume::LttngConsumer consumer{ "synthetic://",
+                                              std::chrono::milliseconds{ 50 },
+                                              options };
+
+        uint64_t pulledEvents = 0;
+        LttngConsume::LttngEventBatch batch;
+        while (consumer.NextBatch(batch, 16, std::chrono::seconds{ 1 }))
+        {
+            pulledEvents += countEvents(batch);
+        }
+
+        REQUIRE(pulledEvents == c_eventsPerStream);
+    }
+
+    // Or once the caller stops, and dropping a consumer that never stopped
+    // doesn't deliver to a callback that is gone
+    options.Synthetic.EventsPerStream = 0;
+    options.Synthetic.EventsPerSecond = 2000;
+
+    for (bool stop : { true, false })
+    {
+        LttngConsume::LttngConsumer consumer{ "synthetic://",
+                                              std::chrono::milliseconds{ 10 },
+                                              options };
+
+        uint64_t processedEvents = 0;
+        std::function<void(LttngConsume::LttngEventBatch&)> callback =
+            [&processedEvents, &countEvents](
+                LttngConsume::LttngEventBatch& batch) {
+                processedEvents += countEvents(batch);
+            };
+
+        auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds{ 200 };
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            REQUIRE(consumer.ProcessAvailable(callback));
+        }
+
+        if (stop)
+        {
+            consumer.StopConsuming();
+            REQUIRE(!consumer.ProcessAvailable(callback));
+            REQUIRE(processedEvents > 0);
+        }
+    }
+}
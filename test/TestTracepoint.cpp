@@ -1,10 +1,20 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
+#include <atomic>
 #include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
 #include <thread>
+#include <sched.h>
+#include <sys/epoll.h>
 #include <unistd.h>
+#include <vector>
 
 #include <catch2/catch.hpp>
 #include <jsonbuilder/JsonRenderer.h>
@@ -163,6 +173,95 @@ static std::string MakeConnectionString(std::string_view sessionName)
     return result;
 }
 
+// An lttng session tracing the hello_world events, destroyed at the end of
+// the test
+class TracingSession
+{
+  public:
+    // A live session, with the procname and vpid contexts RunConsumer()
+    // checks if addProcessContext is set
+    explicit TracingSession(std::string name, bool addProcessContext = false)
+        : TracingSession(std::move(name), "--live", addProcessContext)
+    {}
+
+    // A session recording its trace to directory
+    TracingSession(std::string name, const std::filesystem::path& directory)
+        : TracingSession(
+              std::move(name), "--output=" + directory.string(), false)
+    {}
+
+    ~TracingSession() { Destroy(); }
+
+    TracingSession(const TracingSession&) = delete;
+    TracingSession& operator=(const TracingSession&) = delete;
+
+    std::string ConnectionString() const
+    {
+        return MakeConnectionString(_name);
+    }
+
+    // Stops tracing and flushes the trace, e.g. to read a recorded trace
+    // before the test ends
+    void Destroy()
+    {
+        if (!_destroyed)
+        {
+            Lttng("destroy " + _name);
+            _destroyed = true;
+        }
+    }
+
+  private:
+    TracingSession(
+        std::string name,
+        const std::string& createArgs,
+        bool addProcessContext)
+        : _name(std::move(name))
+    {
+        // Left over by an earlier run that didn't finish
+        Lttng("destroy " + _name);
+
+        Lttng("create " + _name + " " + createArgs);
+        Lttng("enable-event -s " + _name + " --userspace hello_world:*");
+        if (addProcessContext)
+        {
+            Lttng("add-context -s " + _name + " -u -t procname -t vpid");
+        }
+        Lttng("start " + _name);
+
+        std::this_thread::sleep_for(std::chrono::seconds{ 1 });
+    }
+
+    static void Lttng(const std::string& args)
+    {
+        system(("lttng " + args).c_str());
+    }
+
+    std::string _name;
+    bool _destroyed = false;
+};
+
+static constexpr int c_intArray[] = { 0, 1, 2 };
+static constexpr char c_charArray[] = { 'a', 'b', 'c', 'd', 'e' };
+
+// Fires count events, their integer and string fields counting from first,
+// and paced so a live consumer keeps up
+static void FireTracepoints(int count, int first = 0)
+{
+    for (int i = first; i < first + count; i++)
+    {
+        tracepoint(
+            hello_world,
+            my_first_tracepoint,
+            i,
+            std::to_string(i).c_str(),
+            c_intArray,
+            c_charArray);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{ 2 });
+    }
+}
+
 TEST_CASE("LttngConsumer callbacks happen", "[consumer]")
 {
     system("lttng destroy lttngconsume-tracepoint");
@@ -210,3 +309,1050 @@ TEST_CASE("LttngConsumer callbacks happen", "[consumer]")
 
     REQUIRE(eventCallbacks == c_eventsToFire);
 }
+
+TEST_CASE("LttngConsumer unordered mode delivers every event", "[consumer]")
+{
+    TracingSession session{ "lttngconsume-unordered", true };
+    std::string connectionString = session.ConnectionString();
+
+    LttngConsume::LttngConsumerOptions options;
+    options.Ordering = LttngConsume::MessageOrdering::Unordered;
+
+    LttngConsume::LttngConsumer consumer{ connectionString,
+                                          std::chrono::milliseconds{ 50 },
+                                          options };
+
+    constexpr int c_eventsToFire = 250;
+
+    // Events can arrive out of order across streams, so only check the
+    // total rather than the per-event sequence RunConsumer expects.
+    int eventCallbacks = 0;
+    std::thread consumptionThread{ [&consumer, &eventCallbacks]() {
+        consumer.StartConsuming([&eventCallbacks](JsonBuilder&& jsonBuilder) {
+            auto itr = jsonBuilder.find("name");
+            REQUIRE(itr != jsonBuilder.end());
+            REQUIRE(
+                itr->GetUnchecked<std::string_view>() ==
+                "hello_world.my_first_tracepoint");
+
+            eventCallbacks++;
+        });
+    } };
+
+    FireTracepoints(c_eventsToFire);
+
+    std::this_thread::sleep_for(std::chrono::seconds{ 2 });
+
+    consumer.StopConsuming();
+    consumptionThread.join();
+
+    REQUIRE(eventCallbacks == c_eventsToFire);
+}
+
+TEST_CASE("LttngConsumer sharded mode delivers every event", "[consumer]")
+{
+    TracingSession session{ "lttngconsume-sharded", true };
+    std::string connectionString = session.ConnectionString();
+
+    LttngConsume::LttngConsumerOptions options;
+    options.ShardCount = 4;
+
+    LttngConsume::LttngConsumer consumer{ connectionString,
+                                          std::chrono::milliseconds{ 50 },
+                                          options };
+
+    constexpr int c_eventsToFire = 250;
+
+    // Callbacks run concurrently on the shard threads
+    std::mutex callbackMutex;
+    std::set<std::thread::id> callbackThreads;
+    std::atomic<int> eventCallbacks{ 0 };
+    std::thread consumptionThread{ [&]() {
+        consumer.StartConsuming([&](JsonBuilder&& jsonBuilder) {
+            auto itr = jsonBuilder.find("data", "my_integer_field");
+            if (itr != jsonBuilder.end())
+            {
+                eventCallbacks++;
+            }
+
+            std::lock_guard<std::mutex> lock{ callbackMutex };
+            callbackThreads.insert(std::this_thread::get_id());
+        });
+    } };
+
+    // The live source has a single port, so only firing on two CPUs, into
+    // two per-CPU streams, spreads the events over more than one shard
+    cpu_set_t allowedCpus;
+    REQUIRE(sched_getaffinity(0, sizeof(allowedCpus), &allowedCpus) == 0);
+
+    std::vector<int> firingCpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE && firingCpus.size() < 2; cpu++)
+    {
+        if (CPU_ISSET(cpu, &allowedCpus))
+        {
+            firingCpus.push_back(cpu);
+        }
+    }
+    REQUIRE(firingCpus.size() == 2);
+
+    for (int i = 0; i < 2; i++)
+    {
+        std::thread firingThread{ [&firingCpus, i]() {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(firingCpus[i], &cpus);
+            REQUIRE(sched_setaffinity(0, sizeof(cpus), &cpus) == 0);
+
+            FireTracepoints(c_eventsToFire / 2, i * c_eventsToFire / 2);
+        } };
+        firingThread.join();
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds{ 2 });
+
+    consumer.StopConsuming();
+    consumptionThread.join();
+
+    REQUIRE(eventCallbacks == c_eventsToFire);
+    REQUIRE(callbackThreads.size() >= 2);
+}
+
+TEST_CASE("LttngConsumer drops events over its memory budget", "[consumer]")
+{
+    TracingSession session{ "lttngconsume-budget" };
+    std::string connectionString = session.ConnectionString();
+
+    // Any queued batch exceeds the budget, so events read while a shard is
+    // still delivering are dropped
+    LttngConsume::LttngConsumerOptions options;
+    options.ShardCount = 2;
+    options.MemoryBudget.MaxBytes = 1;
+    options.MemoryBudget.Policy = LttngConsume::MemoryBudgetPolicy::Drop;
+
+    LttngConsume::LttngConsumer consumer{ connectionString,
+                                          std::chrono::milliseconds{ 50 },
+                                          options };
+
+    constexpr int c_eventsToFire = 250;
+
+    std::atomic<int> eventCallbacks{ 0 };
+    std::thread consumptionThread{ [&consumer, &eventCallbacks]() {
+        consumer.StartConsuming([&eventCallbacks](JsonBuilder&&) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 5 });
+            eventCallbacks++;
+        });
+    } };
+
+    FireTracepoints(c_eventsToFire);
+
+    std::this_thread::sleep_for(std::chrono::seconds{ 3 });
+
+    consumer.StopConsuming();
+    consumptionThread.join();
+
+    LttngConsume::LttngConsumerStatistics statistics = consumer.GetStatistics();
+    REQUIRE(statistics.EventsOverBudget > 0);
+    REQUIRE(eventCallbacks + statistics.EventsOverBudget == c_eventsToFire);
+    REQUIRE(statistics.InFlightBytes == 0);
+    REQUIRE(statistics.InFlightBytesHighWater > 0);
+
+}
+
+TEST_CASE("LttngConsumer runs its threads on the given CPUs", "[consumer]")
+{
+    TracingSession session{ "lttngconsume-placed" };
+    std::string connectionString = session.ConnectionString();
+
+    LttngConsume::LttngConsumerOptions options;
+    options.ShardCount = 2;
+    options.Placement.Cpus = { 0 };
+    options.Placement.NumaNode = 0;
+
+    LttngConsume::LttngConsumer consumer{ connectionString,
+                                          std::chrono::milliseconds{ 50 },
+                                          options };
+
+    constexpr int c_eventsToFire = 100;
+
+    cpu_set_t cpusBefore;
+    cpu_set_t cpusAfter;
+
+    std::atomic<int> eventCallbacks{ 0 };
+    std::atomic<int> callbacksOffCpu{ 0 };
+    std::thread consumptionThread{ [&]() {
+        sched_getaffinity(0, sizeof(cpusBefore), &cpusBefore);
+
+        consumer.StartConsuming([&](JsonBuilder&&) {
+            if (sched_getcpu() != 0)
+            {
+                callbacksOffCpu++;
+            }
+
+            eventCallbacks++;
+        });
+
+        sched_getaffinity(0, sizeof(cpusAfter), &cpusAfter);
+    } };
+
+    FireTracepoints(c_eventsToFire);
+
+    std::this_thread::sleep_for(std::chrono::seconds{ 2 });
+
+    consumer.StopConsuming();
+    consumptionThread.join();
+
+    REQUIRE(eventCallbacks == c_eventsToFire);
+    REQUIRE(callbacksOffCpu == 0);
+
+    // The calling thread gets its own affinity back
+    REQUIRE(CPU_EQUAL(&cpusBefore, &cpusAfter));
+}
+
+TEST_CASE("LttngConsumer keyed shards keep per key order", "[consumer]")
+{
+    TracingSession session{ "lttngconsume-keyed", true };
+    std::string connectionString = session.ConnectionString();
+
+    LttngConsume::LttngConsumerOptions options;
+    options.ShardCount = 4;
+    options.ShardKey = "streamEventContext.vpid";
+
+    LttngConsume::LttngConsumer consumer{ connectionString,
+                                          std::chrono::milliseconds{ 50 },
+                                          options };
+
+    constexpr int c_eventsToFire = 250;
+
+    // Every event comes from this process, so they all share one shard and
+    // must arrive in the order they were fired
+    std::atomic<int> eventCallbacks{ 0 };
+    std::atomic<bool> inOrder{ true };
+    std::thread consumptionThread{ [&consumer, &eventCallbacks, &inOrder]() {
+        consumer.StartConsuming(
+            [&eventCallbacks, &inOrder](JsonBuilder&& jsonBuilder) {
+                auto itr = jsonBuilder.find("data", "my_integer_field");
+                if (itr != jsonBuilder.end())
+                {
+                    if (itr->GetUnchecked<int>() != eventCallbacks)
+                    {
+                        inOrder = false;
+                    }
+
+                    eventCallbacks++;
+                }
+            });
+    } };
+
+    FireTracepoints(c_eventsToFire);
+
+    std::this_thread::sleep_for(std::chrono::seconds{ 2 });
+
+    consumer.StopConsuming();
+    consumptionThread.join();
+
+    REQUIRE(eventCallbacks == c_eventsToFire);
+    REQUIRE(inOrder);
+}
+
+TEST_CASE("LttngConsumer aggregation counts every event", "[consumer]")
+{
+    TracingSession session{ "lttngconsume-aggregate" };
+    std::string connectionString = session.ConnectionString();
+
+    LttngConsume::LttngConsumerOptions options;
+    options.Aggregation.Interval = std::chrono::hours{ 1 };
+    options.Aggregation.ValueField = "data.my_integer_field";
+    options.Aggregation.HistogramBounds = { 99, 199 };
+
+    LttngConsume::LttngConsumer consumer{ connectionString,
+                                          std::chrono::milliseconds{ 50 },
+                                          options };
+
+    constexpr int c_eventsToFire = 250;
+
+    // The run may straddle a window boundary, so add up every record
+    uint64_t eventCount = 0;
+    double valueSum = 0;
+    uint64_t bucketCounts[3] = {};
+    std::thread consumptionThread{ [&]() {
+        consumer.StartConsuming([&](JsonBuilder&& jsonBuilder) {
+            auto itr = jsonBuilder.find("name");
+            REQUIRE(itr != jsonBuilder.end());
+            REQUIRE(
+                itr->GetUnchecked<std::string_view>() ==
+                "lttng-consume.aggregate");
+
+            auto classItr =
+                jsonBuilder.find("data", "hello_world.my_first_tracepoint");
+            if (classItr == jsonBuilder.end())
+            {
+                return;
+            }
+
+            eventCount +=
+                jsonBuilder.find(classItr, "count")->GetUnchecked<uint64_t>();
+            valueSum +=
+                jsonBuilder.find(classItr, "sum")->GetUnchecked<double>();
+
+            auto histogramItr = jsonBuilder.find(classItr, "histogram");
+            REQUIRE(jsonBuilder.count(histogramItr) == 3);
+
+            size_t bucket = 0;
+            for (auto& bucketValue : histogramItr)
+            {
+                bucketCounts[bucket++] += bucketValue.GetUnchecked<uint64_t>();
+            }
+        });
+    } };
+
+    FireTracepoints(c_eventsToFire);
+
+    std::this_thread::sleep_for(std::chrono::seconds{ 2 });
+
+    consumer.StopConsuming();
+    consumptionThread.join();
+
+    REQUIRE(eventCount == c_eventsToFire);
+    REQUIRE(valueSum == c_eventsToFire * (c_eventsToFire - 1) / 2);
+    REQUIRE(bucketCounts[0] == 100);
+    REQUIRE(bucketCounts[1] == 100);
+    REQUIRE(bucketCounts[2] == 50);
+}
+
+TEST_CASE("LttngConsumer aggregation emits idle windows", "[consumer]")
+{
+    TracingSession session{ "lttngconsume-aggregate-idle" };
+    std::string connectionString = session.ConnectionString();
+
+    LttngConsume::LttngConsumerOptions options;
+    options.Aggregation.Interval = std::chrono::milliseconds{ 100 };
+    options.Aggregation.IdleFlushDelay = std::chrono::milliseconds{ 200 };
+
+    LttngConsume::LttngConsumer consumer{ connectionString,
+                                          std::chrono::milliseconds{ 50 },
+                                          options };
+
+    constexpr int c_eventsToFire = 250;
+
+    std::atomic<uint64_t> eventCount{ 0 };
+    std::thread consumptionThread{ [&]() {
+        consumer.StartConsuming([&](JsonBuilder&& jsonBuilder) {
+            auto classItr =
+                jsonBuilder.find("data", "hello_world.my_first_tracepoint");
+            if (classItr != jsonBuilder.end())
+            {
+                eventCount += jsonBuilder.find(classItr, "count")
+                                  ->GetUnchecked<uint64_t>();
+            }
+        });
+    } };
+
+    FireTracepoints(c_eventsToFire);
+
+    std::this_thread::sleep_for(std::chrono::seconds{ 2 });
+
+    // No later event closes the last window, so it went out while idle
+    uint64_t countBeforeStop = eventCount;
+
+    consumer.StopConsuming();
+    consumptionThread.join();
+
+    REQUIRE(countBeforeStop == c_eventsToFire);
+}
+
+TEST_CASE("LttngConsumer samples events before decoding", "[consumer]")
+{
+    TracingSession session{ "lttngconsume-sampled" };
+    std::string connectionString = session.ConnectionString();
+
+    LttngConsume::EventRateLimit limit;
+    limit.EventName = "hello_world.*";
+    limit.SampleRatio = 0.5;
+
+    LttngConsume::LttngConsumerOptions options;
+    options.RateLimits.push_back(limit);
+
+    LttngConsume::LttngConsumer consumer{ connectionString,
+                                          std::chrono::milliseconds{ 50 },
+                                          options };
+
+    constexpr int c_eventsToFire = 250;
+
+    int eventCallbacks = 0;
+    std::thread consumptionThread{ [&consumer, &eventCallbacks]() {
+        consumer.StartConsuming([&eventCallbacks](JsonBuilder&& jsonBuilder) {
+            // Every other event is kept, starting with the second
+            auto itr = jsonBuilder.find("data", "my_integer_field");
+            REQUIRE(itr != jsonBuilder.end());
+            REQUIRE(itr->GetUnchecked<int>() == eventCallbacks * 2 + 1);
+
+            eventCallbacks++;
+        });
+    } };
+
+    FireTracepoints(c_eventsToFire);
+
+    std::this_thread::sleep_for(std::chrono::seconds{ 2 });
+
+    consumer.StopConsuming();
+    consumptionThread.join();
+
+    REQUIRE(eventCallbacks == c_eventsToFire / 2);
+    REQUIRE(consumer.GetStatistics().EventsSampledOut == c_eventsToFire / 2);
+}
+
+TEST_CASE("LttngConsumer filters events on field values", "[consumer]")
+{
+    TracingSession session{ "lttngconsume-filtered" };
+    std::string connectionString = session.ConnectionString();
+
+    LttngConsume::LttngConsumerOptions options;
+
+    options.Filter = "data.my_integer_field >= && true";
+    REQUIRE_THROWS_AS(
+        LttngConsume::LttngConsumer(
+            connectionString, std::chrono::milliseconds{ 50 }, options),
+        std::invalid_argument);
+
+    // The missing field makes the last comparison false for every event
+    options.Filter = "(data.my_integer_field >= 100 && "
+                     "!(data.my_string_field in { \"150\", \"x\" })) || "
+                     "data.no_such_field == 1";
+
+    LttngConsume::LttngConsumer consumer{ connectionString,
+                                          std::chrono::milliseconds{ 50 },
+                                          options };
+
+    constexpr int c_eventsToFire = 250;
+
+    int eventCallbacks = 0;
+    std::thread consumptionThread{ [&consumer, &eventCallbacks]() {
+        consumer.StartConsuming([&eventCallbacks](JsonBuilder&& jsonBuilder) {
+            auto itr = jsonBuilder.find("data", "my_integer_field");
+            REQUIRE(itr != jsonBuilder.end());
+            REQUIRE(itr->GetUnchecked<int>() >= 100);
+            REQUIRE(itr->GetUnchecked<int>() != 150);
+
+            eventCallbacks++;
+        });
+    } };
+
+    FireTracepoints(c_eventsToFire);
+
+    std::this_thread::sleep_for(std::chrono::seconds{ 2 });
+
+    consumer.StopConsuming();
+    consumptionThread.join();
+
+    REQUIRE(eventCallbacks == c_eventsToFire - 101);
+    REQUIRE(consumer.GetStatistics().EventsFilteredOut == 101);
+
+}
+
+TEST_CASE("LttngConsumer interns repeated strings", "[consumer]")
+{
+    TracingSession session{ "lttngconsume-interned", true };
+    std::string connectionString = session.ConnectionString();
+
+    LttngConsume::LttngConsumerOptions options;
+    options.InternStrings = true;
+
+    LttngConsume::LttngConsumer consumer{ connectionString,
+                                          std::chrono::milliseconds{ 50 },
+                                          options };
+
+    constexpr int c_eventsToFire = 10;
+
+    int eventCallbacks = 0;
+    const char* procnameData = nullptr;
+    std::thread consumptionThread{ [&]() {
+        consumer.StartConsuming([&](JsonBuilder&& jsonBuilder) {
+            auto itr = jsonBuilder.find("streamEventContext", "procname");
+            REQUIRE(itr != jsonBuilder.end());
+            REQUIRE(itr->Type() == JsonUInt);
+
+            std::string_view procname =
+                consumer.LookupInternedString(itr->GetUnchecked<uint32_t>());
+            REQUIRE(!procname.empty());
+
+            // Every event comes from this process, so they all share the
+            // same interned string
+            if (procnameData == nullptr)
+            {
+                procnameData = procname.data();
+            }
+            REQUIRE(procname.data() == procnameData);
+
+            itr = jsonBuilder.find("metadata", "lttngName");
+            REQUIRE(itr != jsonBuilder.end());
+            REQUIRE(
+                consumer.LookupInternedString(itr->GetUnchecked<uint32_t>()) ==
+                "hello_world:my_first_tracepoint");
+
+            // Payload strings are left alone
+            itr = jsonBuilder.find("data", "my_string_field");
+            REQUIRE(itr != jsonBuilder.end());
+            REQUIRE(itr->Type() == JsonUtf8);
+
+            eventCallbacks++;
+        });
+    } };
+
+    FireTracepoints(c_eventsToFire);
+
+    std::this_thread::sleep_for(std::chrono::seconds{ 2 });
+
+    consumer.StopConsuming();
+    consumptionThread.join();
+
+    REQUIRE(eventCallbacks == c_eventsToFire);
+}
+
+TEST_CASE("LttngConsumer delivers batches", "[consumer]")
+{
+    TracingSession session{ "lttngconsume-batches" };
+    std::string connectionString = session.ConnectionString();
+
+    LttngConsume::LttngConsumer consumer{ connectionString,
+                                          std::chrono::milliseconds{ 50 } };
+
+    constexpr int c_eventsToFire = 250;
+
+    int eventCallbacks = 0;
+    std::thread consumptionThread{ [&consumer, &eventCallbacks]() {
+        consumer.StartConsumingBatches(
+            [&eventCallbacks](LttngConsume::LttngEventBatch& batch) {
+                REQUIRE(!batch.empty());
+
+                for (JsonBuilder& jsonBuilder : batch)
+                {
+                    auto itr = jsonBuilder.find("data", "my_integer_field");
+                    REQUIRE(itr != jsonBuilder.end());
+                    REQUIRE(itr->GetUnchecked<int>() == eventCallbacks);
+
+                    eventCallbacks++;
+                }
+            });
+    } };
+
+    FireTracepoints(c_eventsToFire);
+
+    std::this_thread::sleep_for(std::chrono::seconds{ 2 });
+
+    consumer.StopConsuming();
+    consumptionThread.join();
+
+    REQUIRE(eventCallbacks == c_eventsToFire);
+}
+
+TEST_CASE("LttngConsumer tracks delivery latency", "[consumer]")
+{
+    TracingSession session{ "lttngconsume-latency" };
+    std::string connectionString = session.ConnectionString();
+
+    LttngConsume::LttngConsumerOptions options;
+    options.TrackLatency = true;
+
+    LttngConsume::LttngConsumer consumer{ connectionString,
+                                          std::chrono::milliseconds{ 50 },
+                                          options };
+
+    constexpr int c_eventsToFire = 250;
+
+    std::thread consumptionThread{ [&consumer]() {
+        consumer.StartConsuming([](JsonBuilder&&) {});
+    } };
+
+    FireTracepoints(c_eventsToFire);
+
+    std::this_thread::sleep_for(std::chrono::seconds{ 2 });
+
+    consumer.StopConsuming();
+    consumptionThread.join();
+
+    uint64_t streamEvents = 0;
+    uint64_t sessionEvents = 0;
+    for (const auto& histogram : consumer.GetLatencyHistograms())
+    {
+        REQUIRE(histogram.Session == "lttngconsume-latency");
+
+        uint64_t events = 0;
+        for (uint64_t bucket : histogram.Buckets)
+        {
+            events += bucket;
+        }
+
+        (histogram.Stream.empty() ? sessionEvents : streamEvents) += events;
+    }
+
+    REQUIRE(streamEvents == c_eventsToFire);
+    REQUIRE(sessionEvents == c_eventsToFire);
+}
+
+TEST_CASE("LttngConsumer inlines functor callbacks", "[consumer]")
+{
+    TracingSession session{ "lttngconsume-functor" };
+    std::string connectionString = session.ConnectionString();
+
+    LttngConsume::LttngConsumer consumer{ connectionString,
+                                          std::chrono::milliseconds{ 50 } };
+
+    constexpr int c_eventsToFire = 250;
+
+    // Taking the event by lvalue reference leaves it in the batch
+    struct EventCounter
+    {
+        int& Count;
+
+        void operator()(const JsonBuilder& jsonBuilder)
+        {
+            auto itr = jsonBuilder.find("data", "my_integer_field");
+            REQUIRE(itr != jsonBuilder.end());
+            REQUIRE(itr->GetUnchecked<int>() == Count);
+
+            Count++;
+        }
+    };
+
+    int eventCallbacks = 0;
+    std::thread consumptionThread{ [&consumer, &eventCallbacks]() {
+        consumer.StartConsuming(EventCounter{ eventCallbacks });
+    } };
+
+    FireTracepoints(c_eventsToFire);
+
+    std::this_thread::sleep_for(std::chrono::seconds{ 2 });
+
+    consumer.StopConsuming();
+    consumptionThread.join();
+
+    REQUIRE(eventCallbacks == c_eventsToFire);
+}
+
+TEST_CASE("LttngConsumer returns pulled batches in order", "[consumer]")
+{
+    TracingSession session{ "lttngconsume-pulled" };
+    std::string connectionString = session.ConnectionString();
+
+    LttngConsume::LttngConsumer consumer{ connectionString,
+                                          std::chrono::milliseconds{ 50 } };
+
+    constexpr int c_eventsToFire = 250;
+    constexpr size_t c_maxEvents = 16;
+
+    // Events are fired from another thread while this one pulls
+    std::thread tracingThread{ []() { FireTracepoints(c_eventsToFire); } };
+
+    int eventsPulled = 0;
+
+    LttngConsume::LttngEventBatch batch;
+    auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds{ 5 };
+    while (eventsPulled < c_eventsToFire &&
+           std::chrono::steady_clock::now() < deadline)
+    {
+        REQUIRE(consumer.NextBatch(
+            batch, c_maxEvents, std::chrono::milliseconds{ 100 }));
+        REQUIRE(batch.size() <= c_maxEvents);
+
+        for (JsonBuilder& event : batch)
+        {
+            auto itr = event.find("data", "my_integer_field");
+            REQUIRE(itr != event.end());
+            REQUIRE(itr->GetUnchecked<int>() == eventsPulled);
+
+            eventsPulled++;
+        }
+    }
+
+    tracingThread.join();
+
+    REQUIRE(eventsPulled == c_eventsToFire);
+
+    // Nothing is left, so the timeout passes with an empty batch
+    REQUIRE(consumer.NextBatch(
+        batch, c_maxEvents, std::chrono::milliseconds{ 200 }));
+    REQUIRE(batch.empty());
+
+    consumer.StopConsuming();
+    REQUIRE(!consumer.NextBatch(batch, c_maxEvents, std::chrono::seconds{ 1 }));
+}
+
+TEST_CASE("LttngConsumer processes events from an epoll loop", "[consumer]")
+{
+    TracingSession session{ "lttngconsume-polled" };
+    std::string connectionString = session.ConnectionString();
+
+    LttngConsume::LttngConsumer consumer{ connectionString,
+                                          std::chrono::milliseconds{ 50 } };
+
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    REQUIRE(epollFd >= 0);
+
+    epoll_event registration{};
+    registration.events = EPOLLIN;
+    REQUIRE(
+        epoll_ctl(
+            epollFd, EPOLL_CTL_ADD, consumer.GetPollFd(), &registration) == 0);
+
+    constexpr int c_eventsToFire = 250;
+
+    std::thread tracingThread{ []() { FireTracepoints(c_eventsToFire); } };
+
+    int eventCallbacks = 0;
+    std::function<void(LttngConsume::LttngEventBatch&)> callback =
+        [&eventCallbacks](LttngConsume::LttngEventBatch& batch) {
+            for (JsonBuilder& event : batch)
+            {
+                auto itr = event.find("data", "my_integer_field");
+                REQUIRE(itr != event.end());
+                REQUIRE(itr->GetUnchecked<int>() == eventCallbacks);
+
+                eventCallbacks++;
+            }
+        };
+
+    auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds{ 5 };
+    while (eventCallbacks < c_eventsToFire &&
+           std::chrono::steady_clock::now() < deadline)
+    {
+        epoll_event ready{};
+        if (epoll_wait(epollFd, &ready, 1, 100) == 1)
+        {
+            REQUIRE(consumer.ProcessAvailable(callback));
+        }
+    }
+
+    tracingThread.join();
+    close(epollFd);
+
+    REQUIRE(eventCallbacks == c_eventsToFire);
+
+    consumer.StopConsuming();
+    REQUIRE(!consumer.ProcessAvailable(callback));
+}
+
+TEST_CASE("LttngConsumer shares decoded events with subscribers", "[consumer]")
+{
+    TracingSession session{ "lttngconsume-subscribed" };
+    std::string connectionString = session.ConnectionString();
+
+    LttngConsume::LttngConsumer consumer{ connectionString,
+                                          std::chrono::milliseconds{ 50 } };
+
+    // Events 50 to 99 match both, and are decoded once with both members
+    int lowEvents = 0;
+    int lowEventsWithHeader = 0;
+    LttngConsume::LttngSubscription low;
+    low.Filter = "data.my_integer_field < 100";
+    low.Fields = { "data" };
+    low.Callback = [&](const std::shared_ptr<const JsonBuilder>& event) {
+        REQUIRE(event->find("data") != event->end());
+        lowEventsWithHeader += event->find("eventHeader") != event->end();
+        lowEvents++;
+    };
+
+    int highEvents = 0;
+    int highEventsWithData = 0;
+    std::shared_ptr<const JsonBuilder> lastHighEvent;
+    LttngConsume::LttngSubscription high;
+    high.Filter = "data.my_integer_field >= 50";
+    high.Fields = { "eventHeader" };
+    high.Callback = [&](const std::shared_ptr<const JsonBuilder>& event) {
+        REQUIRE(event->find("eventHeader") != event->end());
+        highEventsWithData += event->find("data") != event->end();
+        highEvents++;
+
+        lastHighEvent = event;
+    };
+
+    consumer.Subscribe(std::move(low));
+    consumer.Subscribe(std::move(high));
+
+    LttngConsume::LttngSubscription unknownField;
+    unknownField.Fields = { "payload" };
+    unknownField.Callback = [](const std::shared_ptr<const JsonBuilder>&) {};
+    REQUIRE_THROWS_AS(
+        consumer.Subscribe(std::move(unknownField)), std::invalid_argument);
+
+    constexpr int c_eventsToFire = 250;
+
+    // Subscribers take every event in place of this callback
+    int batchCallbacks = 0;
+    std::thread consumptionThread{ [&consumer, &batchCallbacks]() {
+        consumer.StartConsumingBatches(
+            [&batchCallbacks](LttngConsume::LttngEventBatch&) {
+                batchCallbacks++;
+            });
+    } };
+
+    FireTracepoints(c_eventsToFire);
+
+    std::this_thread::sleep_for(std::chrono::seconds{ 2 });
+
+    consumer.StopConsuming();
+    consumptionThread.join();
+
+    REQUIRE(batchCallbacks == 0);
+    REQUIRE(lowEvents == 100);
+    REQUIRE(lowEventsWithHeader == 50);
+    REQUIRE(highEvents == 200);
+    REQUIRE(highEventsWithData == 50);
+
+    // A held event outlives the graph that decoded it, and stays charged
+    // to the consumer's budget until it is released
+    REQUIRE(lastHighEvent);
+    REQUIRE(lastHighEvent->find("eventHeader") != lastHighEvent->end());
+    REQUIRE(
+        consumer.GetStatistics().InFlightBytes ==
+        lastHighEvent->buffer_capacity());
+
+    lastHighEvent.reset();
+    REQUIRE(consumer.GetStatistics().InFlightBytes == 0);
+}
+
+TEST_CASE("LttngConsumer captures the live stream to CTF", "[consumer]")
+{
+    char directoryTemplate[] = "/tmp/lttngconsume-capture-XXXXXX";
+    REQUIRE(mkdtemp(directoryTemplate) != nullptr);
+    std::filesystem::path directory{ directoryTemplate };
+
+    // An older segment that no longer fits next to a new one
+    std::filesystem::path staleSegment =
+        directory / "capture-00000000000000000001";
+    std::filesystem::create_directory(staleSegment);
+    {
+        std::ofstream staleFile{ staleSegment / "stream" };
+        staleFile << std::string(1024 * 1024, 'x');
+    }
+
+    TracingSession session{ "lttngconsume-capture" };
+    std::string connectionString = session.ConnectionString();
+
+    LttngConsume::LttngConsumerOptions options;
+    options.Capture.Directory = directory.string();
+    options.Capture.SegmentBytes = 1024 * 1024;
+    options.Capture.MaxBytes = 3 * 512 * 1024;
+
+    LttngConsume::LttngConsumer consumer{ connectionString,
+                                          std::chrono::milliseconds{ 50 },
+                                          options };
+
+    constexpr int c_eventsToFire = 250;
+
+    int eventCallbacks = 0;
+    std::thread consumptionThread{ [&consumer, &eventCallbacks]() {
+        consumer.StartConsuming(
+            [&eventCallbacks](JsonBuilder&&) { eventCallbacks++; });
+    } };
+
+    FireTracepoints(c_eventsToFire);
+
+    std::this_thread::sleep_for(std::chrono::seconds{ 2 });
+
+    consumer.StopConsuming();
+    consumptionThread.join();
+
+    session.Destroy();
+
+    LttngConsume::LttngConsumerStatistics statistics = consumer.GetStatistics();
+    REQUIRE(eventCallbacks == c_eventsToFire);
+    REQUIRE(statistics.CaptureSegments == 1);
+    REQUIRE(statistics.CaptureSegmentsDeleted == 1);
+    REQUIRE(statistics.MessagesNotCaptured == 0);
+    REQUIRE(!std::filesystem::exists(staleSegment));
+
+    // The capture reads back as a recorded trace with the same events
+    LttngConsume::LttngConsumer replay{ directory.string(),
+                                        std::chrono::milliseconds{ 50 } };
+
+    std::vector<int> values;
+    replay.StartConsuming([&values](JsonBuilder&& jsonBuilder) {
+        auto itr = jsonBuilder.find("data", "my_integer_field");
+        REQUIRE(itr != jsonBuilder.end());
+        values.push_back(itr->GetUnchecked<int>());
+    });
+
+    std::filesystem::remove_all(directory);
+
+    REQUIRE(values.size() == c_eventsToFire);
+    for (int i = 0; i < c_eventsToFire; i++)
+    {
+        REQUIRE(values[i] == i);
+    }
+}
+
+TEST_CASE("LttngConsumer reads a time window of a recorded trace", "[consumer]")
+{
+    char directoryTemplate[] = "/tmp/lttngconsume-recorded-XXXXXX";
+    REQUIRE(mkdtemp(directoryTemplate) != nullptr);
+    std::filesystem::path directory{ directoryTemplate };
+
+    TracingSession session{ "lttngconsume-recorded", directory };
+
+    // Leave gaps around the window so clock skew can't move events across
+    FireTracepoints(100);
+    std::this_thread::sleep_for(std::chrono::milliseconds{ 200 });
+    auto begin = std::chrono::system_clock::now();
+    FireTracepoints(50, 100);
+    auto end = std::chrono::system_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds{ 200 });
+    FireTracepoints(100, 150);
+
+    session.Destroy();
+
+    LttngConsume::LttngConsumerOptions options;
+    options.Begin = begin;
+    options.End = end;
+
+    LttngConsume::LttngConsumer consumer{ directory.string(),
+                                          std::chrono::milliseconds{ 50 },
+                                          options };
+
+    // Returns by itself at the end of the trace
+    std::vector<int> values;
+    consumer.StartConsuming([&values](JsonBuilder&& jsonBuilder) {
+        auto itr = jsonBuilder.find("data", "my_integer_field");
+        REQUIRE(itr != jsonBuilder.end());
+        values.push_back(itr->GetUnchecked<int>());
+    });
+
+    std::filesystem::remove_all(directory);
+
+    REQUIRE(values.size() == 50);
+    REQUIRE(values.front() == 100);
+    REQUIRE(values.back() == 149);
+}
+
+TEST_CASE("LttngConsumer merges offline workers in order", "[consumer]")
+{
+    char directoryTemplate[] = "/tmp/lttngconsume-workers-XXXXXX";
+    REQUIRE(mkdtemp(directoryTemplate) != nullptr);
+    std::filesystem::path directory{ directoryTemplate };
+
+    TracingSession session{ "lttngconsume-workers", directory };
+
+    constexpr int c_firingThreads = 4;
+    constexpr int c_eventsPerThread = 60;
+
+    // Events come from several threads so they spread over per-CPU streams
+    std::atomic<int> nextValue{ 0 };
+    std::vector<std::thread> firingThreads;
+    for (int thread = 0; thread < c_firingThreads; thread++)
+    {
+        firingThreads.emplace_back([&nextValue]() {
+            for (int i = 0; i < c_eventsPerThread; i++)
+            {
+                tracepoint(
+                    hello_world,
+                    my_first_tracepoint,
+                    nextValue++,
+                    "",
+                    c_intArray,
+                    c_charArray);
+
+                std::this_thread::sleep_for(std::chrono::milliseconds{ 2 });
+            }
+        });
+    }
+
+    for (std::thread& thread : firingThreads)
+    {
+        thread.join();
+    }
+
+    session.Destroy();
+
+    LttngConsume::LttngConsumerOptions options;
+    options.OfflineWorkerCount = 4;
+
+    LttngConsume::LttngConsumer consumer{ directory.string(),
+                                          std::chrono::milliseconds{ 50 },
+                                          options };
+
+    int64_t previousTime = 0;
+    int eventCallbacks = 0;
+    consumer.StartConsuming(
+        [&previousTime, &eventCallbacks](JsonBuilder&& jsonBuilder) {
+            auto itr = jsonBuilder.find("time");
+            REQUIRE(itr != jsonBuilder.end());
+
+            int64_t time =
+                itr->GetUnchecked<std::chrono::system_clock::time_point>()
+                    .time_since_epoch()
+                    .count();
+            REQUIRE(time >= previousTime);
+
+            previousTime = time;
+            eventCallbacks++;
+        });
+
+    std::filesystem::remove_all(directory);
+
+    REQUIRE(eventCallbacks == c_firingThreads * c_eventsPerThread);
+}
+
+TEST_CASE("LttngConsumer decodes typed events", "[consumer]")
+{
+    TracingSession session{ "lttngconsume-typed" };
+    std::string connectionString = session.ConnectionString();
+
+    LttngConsume::LttngConsumer consumer{ connectionString,
+                                          std::chrono::milliseconds{ 50 } };
+
+    struct HelloWorldEvent
+    {
+        int64_t Integer;
+        uint32_t UnsignedInteger;
+        double Float;
+        std::string String;
+        int32_t Enum;
+    };
+
+    int typedCallbacks = 0;
+    consumer.AddTypedEvent(LttngConsume::MakeTypedEvent<HelloWorldEvent>(
+        "hello_world.my_first_tracepoint",
+        { LttngConsume::Bind<&HelloWorldEvent::Integer>(
+              "data.my_integer_field"),
+          LttngConsume::Bind<&HelloWorldEvent::UnsignedInteger>(
+              "data.my_unsigned_integer_field"),
+          LttngConsume::Bind<&HelloWorldEvent::Float>("data.my_float_field"),
+          LttngConsume::Bind<&HelloWorldEvent::String>("data.my_string_field"),
+          LttngConsume::Bind<&HelloWorldEvent::Enum>("data.my_enum_field") },
+        [&typedCallbacks](const HelloWorldEvent& event) {
+            REQUIRE(event.Integer == typedCallbacks);
+            REQUIRE(event.UnsignedInteger == uint32_t(typedCallbacks));
+            REQUIRE(event.Float == double(typedCallbacks));
+            REQUIRE(event.String == std::to_string(typedCallbacks));
+            REQUIRE(event.Enum == typedCallbacks);
+
+            typedCallbacks++;
+        }));
+
+    REQUIRE_THROWS_AS(
+        consumer.AddTypedEvent(LttngConsume::MakeTypedEvent<HelloWorldEvent>(
+            "hello_world.my_first_tracepoint",
+            { LttngConsume::Bind<&HelloWorldEvent::Integer>("payload.x") },
+            [](const HelloWorldEvent&) {})),
+        std::invalid_argument);
+
+    constexpr int c_eventsToFire = 250;
+
+    int jsonCallbacks = 0;
+    std::thread consumptionThread{ [&consumer, &jsonCallbacks]() {
+        consumer.StartConsuming(
+            [&jsonCallbacks](JsonBuilder&&) { jsonCallbacks++; });
+    } };
+
+    FireTracepoints(c_eventsToFire);
+
+    std::this_thread::sleep_for(std::chrono::seconds{ 2 });
+
+    consumer.StopConsuming();
+    consumptionThread.join();
+
+    REQUIRE(typedCallbacks == c_eventsToFire);
+    REQUIRE(jsonCallbacks == 0);
+    REQUIRE(consumer.GetStatistics().TypedBindingFailures == 0);
+}
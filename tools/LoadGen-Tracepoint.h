@@ -0,0 +1,32 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#undef TRACEPOINT_PROVIDER
+#define TRACEPOINT_PROVIDER lttng_consume_load
+
+#undef TRACEPOINT_INCLUDE
+#define TRACEPOINT_INCLUDE "LoadGen-Tracepoint.h"
+
+#if !defined(_LTTNG_CONSUME_LOAD_TP_H) || defined(TRACEPOINT_HEADER_MULTI_READ)
+#    define _LTTNG_CONSUME_LOAD_TP_H
+
+#    include <stddef.h>
+#    include <stdint.h>
+
+#    include <lttng/tracepoint.h>
+
+// clang-format off
+
+TRACEPOINT_EVENT(
+    lttng_consume_load,
+    load_event,
+    TP_ARGS(uint64_t, sequence_arg, uint32_t, thread_arg, const char*, payload_arg, size_t, payload_len_arg),
+    TP_FIELDS(
+        ctf_integer(uint64_t, sequence, sequence_arg)
+        ctf_integer(uint32_t, thread, thread_arg)
+        ctf_sequence_text(char, payload, payload_arg, size_t, payload_len_arg)))
+// clang-format on
+
+#endif /* _LTTNG_CONSUME_LOAD_TP_H */
+
+#include <lttng/tracepoint-event.h>
@@ -0,0 +1,189 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "LoadGenerator.h"
+
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <tracelogging/TraceLoggingProvider.h>
+
+#include "LoadGen-Tracepoint.h"
+
+TRACELOGGING_DEFINE_PROVIDER(
+    g_loadProvider,
+    "LttngConsumeLoad",
+    (0x5c1b5a4e, 0x7d0e, 0x4f3e, 0x9a, 0x51, 0x2d, 0x6c, 0x0b, 0x8e, 0x41, 0x27));
+
+namespace LttngConsume {
+
+const char* GetLoadEventPattern(LoadEventKind kind)
+{
+    return kind == LoadEventKind::Tracepoint ? "lttng_consume_load:*" :
+                                               "LttngConsumeLoad:*";
+}
+
+// TraceLoggingCountedString() takes a 16-bit length
+static bool PayloadFits(const LoadOptions& options)
+{
+    return options.Kind != LoadEventKind::TraceLogging ||
+           options.PayloadBytes <= UINT16_MAX;
+}
+
+template<typename T>
+static bool ParseNumber(std::string_view value, T& result)
+{
+    auto [end, error] =
+        std::from_chars(value.data(), value.data() + value.size(), result);
+    return error == std::errc{} && end == value.data() + value.size();
+}
+
+bool ParseLoadOption(
+    std::string_view name,
+    std::string_view value,
+    LoadOptions& options)
+{
+    if (name == "--threads")
+    {
+        return ParseNumber(value, options.Threads) && options.Threads > 0;
+    }
+    else if (name == "--rate")
+    {
+        return ParseNumber(value, options.EventsPerSecond) &&
+               options.EventsPerSecond > 0;
+    }
+    else if (name == "--duration-ms")
+    {
+        uint64_t durationMs = 0;
+        if (!ParseNumber(value, durationMs))
+        {
+            return false;
+        }
+
+        options.Duration = std::chrono::milliseconds{ durationMs };
+        return true;
+    }
+    else if (name == "--payload-bytes")
+    {
+        return ParseNumber(value, options.PayloadBytes) &&
+               PayloadFits(options);
+    }
+    else if (name == "--kind")
+    {
+        if (value == "tracepoint")
+        {
+            options.Kind = LoadEventKind::Tracepoint;
+            return true;
+        }
+        else if (value == "tracelogging")
+        {
+            options.Kind = LoadEventKind::TraceLogging;
+            return PayloadFits(options);
+        }
+    }
+
+    return false;
+}
+
+static uint64_t
+EmitFromThread(const LoadOptions& options, uint32_t threadIndex)
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::string payload(options.PayloadBytes, 'x');
+
+    // Spread the total rate over the threads, in nanoseconds per event
+    double eventsPerSecond =
+        static_cast<double>(options.EventsPerSecond) / options.Threads;
+    auto interval = std::chrono::nanoseconds{
+        static_cast<int64_t>(1e9 / eventsPerSecond) };
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = start + options.Duration;
+    Clock::time_point nextEvent = start;
+
+    uint64_t sequence = 0;
+    while (true)
+    {
+        Clock::time_point now = Clock::now();
+        if (now >= end)
+        {
+            break;
+        }
+
+        // Sleeping is too coarse for short gaps, so only sleep when well
+        // ahead of schedule
+        if (nextEvent - now > std::chrono::milliseconds{ 1 })
+        {
+            std::this_thread::sleep_until(nextEvent);
+        }
+        else if (now - nextEvent > std::chrono::milliseconds{ 100 })
+        {
+            nextEvent = now;
+        }
+
+        if (options.Kind == LoadEventKind::Tracepoint)
+        {
+            tracepoint(
+                lttng_consume_load,
+                load_event,
+                sequence,
+                threadIndex,
+                payload.data(),
+                payload.size());
+        }
+        else
+        {
+            TraceLoggingWrite(
+                g_loadProvider,
+                "LoadEvent",
+                TraceLoggingUInt64(sequence, "sequence"),
+                TraceLoggingUInt32(threadIndex, "thread"),
+                TraceLoggingCountedString(
+                    payload.data(),
+                    static_cast<uint16_t>(payload.size()),
+                    "payload"));
+        }
+
+        sequence++;
+        nextEvent += interval;
+    }
+
+    return sequence;
+}
+
+uint64_t RunLoad(const LoadOptions& options)
+{
+    if (options.Kind == LoadEventKind::TraceLogging)
+    {
+        TraceLoggingRegister(g_loadProvider);
+    }
+
+    std::atomic<uint64_t> emitted{ 0 };
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < options.Threads; i++)
+    {
+        threads.emplace_back([&options, &emitted, i]() {
+            emitted += EmitFromThread(options, i);
+        });
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    if (options.Kind == LoadEventKind::TraceLogging)
+    {
+        TraceLoggingUnregister(g_loadProvider);
+    }
+
+    return emitted;
+}
+
+}
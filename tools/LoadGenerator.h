@@ -0,0 +1,54 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace LttngConsume {
+
+enum class LoadEventKind
+{
+    // lttng_consume_load:load_event
+    Tracepoint,
+
+    // LttngConsumeLoad:LoadEvent
+    TraceLogging
+};
+
+struct LoadOptions
+{
+    uint32_t Threads = 1;
+
+    // Total across all threads, each of which paces itself to its share
+    uint64_t EventsPerSecond = 10000;
+
+    std::chrono::milliseconds Duration{ 5000 };
+
+    // Length of the text payload carried by every event, at most 65535
+    // for TraceLogging events
+    size_t PayloadBytes = 64;
+
+    LoadEventKind Kind = LoadEventKind::Tracepoint;
+};
+
+// The lttng enable-event pattern matching the events of kind
+const char* GetLoadEventPattern(LoadEventKind kind);
+
+// Applies a "--name value" command line option. Returns false if the name
+// is unknown, the value doesn't parse, or the payload set is too long for
+// TraceLogging events.
+bool ParseLoadOption(
+    std::string_view name,
+    std::string_view value,
+    LoadOptions& options);
+
+// Emits events until Duration has passed and returns how many were
+// emitted. Threads that fall behind their rate emit as fast as they can
+// rather than trying to catch up later.
+uint64_t RunLoad(const LoadOptions& options);
+
+}
@@ -0,0 +1,40 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <iostream>
+#include <string_view>
+
+#include "LoadGenerator.h"
+
+static void PrintUsage()
+{
+    std::cerr << "usage: lttng-consumeLoadGenerator [--threads N] [--rate "
+                 "EVENTS_PER_SECOND]\n"
+                 "           [--duration-ms MS] [--payload-bytes BYTES] "
+                 "[--kind tracepoint|tracelogging]\n";
+}
+
+int main(int argc, char** argv)
+{
+    LttngConsume::LoadOptions options;
+
+    for (int i = 1; i < argc; i += 2)
+    {
+        if (i + 1 >= argc ||
+            !LttngConsume::ParseLoadOption(argv[i], argv[i + 1], options))
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    std::cerr << "Enable with: lttng enable-event --userspace '"
+              << LttngConsume::GetLoadEventPattern(options.Kind) << "'\n";
+
+    uint64_t emitted = LttngConsume::RunLoad(options);
+
+    std::cout << "emitted " << emitted << " events in "
+              << options.Duration.count() << " ms" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,198 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// Runs the load generator at increasing rates against a local
+// lttng-sessiond and lttng-relayd, consuming each run live, and reports
+// how many events made it through at each rate.
+
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <lttng-consume/LttngConsumer.h>
+
+#include "LoadGenerator.h"
+
+using namespace LttngConsume;
+
+static std::string MakeConnectionString(std::string_view sessionName)
+{
+    std::string result = "net://localhost/host/";
+
+    char hostnameBuf[256];
+    gethostname(hostnameBuf, 256);
+
+    result += hostnameBuf;
+    result += "/";
+    result += sessionName;
+
+    return result;
+}
+
+static bool ParseRates(std::string_view value, std::vector<uint64_t>& rates)
+{
+    rates.clear();
+
+    while (!value.empty())
+    {
+        size_t commaPos = value.find(',');
+        std::string_view rateString = value.substr(0, commaPos);
+
+        uint64_t rate = 0;
+        auto [end, error] = std::from_chars(
+            rateString.data(), rateString.data() + rateString.size(), rate);
+        if (error != std::errc{} ||
+            end != rateString.data() + rateString.size() || rate == 0)
+        {
+            return false;
+        }
+        rates.push_back(rate);
+
+        value = commaPos == std::string_view::npos ? std::string_view{} :
+                                                     value.substr(commaPos + 1);
+    }
+
+    return !rates.empty();
+}
+
+static void PrintUsage()
+{
+    std::cerr
+        << "usage: lttng-consumeThroughput [--rates R1,R2,...] [--shards N]\n"
+           "           [--threads N] [--duration-ms MS] [--payload-bytes "
+           "BYTES]\n"
+           "           [--kind tracepoint|tracelogging]\n";
+}
+
+struct RunResult
+{
+    uint64_t Emitted = 0;
+    uint64_t Received = 0;
+    LttngConsumerStatistics Statistics;
+};
+
+static RunResult RunAtRate(
+    const LoadOptions& loadOptions,
+    const LttngConsumerOptions& consumerOptions)
+{
+    std::string sessionName =
+        "lttngconsume-load-" + std::to_string(loadOptions.EventsPerSecond);
+    std::string sessionArg = " -s " + sessionName;
+
+    system(("lttng destroy " + sessionName + " > /dev/null 2>&1").c_str());
+    system(("lttng create " + sessionName + " --live > /dev/null").c_str());
+    system(("lttng enable-event" + sessionArg + " --userspace '" +
+            GetLoadEventPattern(loadOptions.Kind) + "' > /dev/null")
+               .c_str());
+    system(("lttng start " + sessionName + " > /dev/null").c_str());
+
+    std::this_thread::sleep_for(std::chrono::seconds{ 1 });
+
+    LttngConsumer consumer{ MakeConnectionString(sessionName),
+                            std::chrono::milliseconds{ 50 },
+                            consumerOptions };
+
+    // Count whole batches so the callback itself costs next to nothing
+    std::atomic<uint64_t> received{ 0 };
+    std::thread consumptionThread{ [&consumer, &received]() {
+        consumer.StartConsumingBatches([&received](LttngEventBatch& batch) {
+            received.fetch_add(batch.size(), std::memory_order_relaxed);
+        });
+    } };
+
+    RunResult result;
+    result.Emitted = RunLoad(loadOptions);
+
+    // Let the live timer flush and the consumer catch up
+    std::this_thread::sleep_for(std::chrono::seconds{ 3 });
+
+    consumer.StopConsuming();
+    consumptionThread.join();
+
+    result.Received = received;
+    result.Statistics = consumer.GetStatistics();
+
+    system(("lttng destroy " + sessionName + " > /dev/null").c_str());
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    LoadOptions loadOptions;
+    LttngConsumerOptions consumerOptions;
+    std::vector<uint64_t> rates = { 10000, 50000, 100000, 250000, 500000 };
+
+    for (int i = 1; i < argc; i += 2)
+    {
+        if (i + 1 >= argc)
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        std::string_view name = argv[i];
+        std::string_view value = argv[i + 1];
+
+        bool parsed = false;
+        if (name == "--rates")
+        {
+            parsed = ParseRates(value, rates);
+        }
+        else if (name == "--shards")
+        {
+            auto [end, error] = std::from_chars(
+                value.data(), value.data() + value.size(),
+                consumerOptions.ShardCount);
+            parsed = error == std::errc{} && end == value.data() + value.size();
+        }
+        else
+        {
+            parsed = ParseLoadOption(name, value, loadOptions);
+        }
+
+        if (!parsed)
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    std::cout << "rate,emitted,received,discarded,packetsDiscarded,"
+                 "receivedPerSecond"
+              << std::endl;
+
+    uint64_t highestLosslessRate = 0;
+    for (uint64_t rate : rates)
+    {
+        loadOptions.EventsPerSecond = rate;
+
+        RunResult result = RunAtRate(loadOptions, consumerOptions);
+
+        double seconds = loadOptions.Duration.count() / 1000.0;
+        std::cout << rate << "," << result.Emitted << "," << result.Received
+                  << "," << result.Statistics.EventsDiscarded << ","
+                  << result.Statistics.PacketsDiscarded << ","
+                  << static_cast<uint64_t>(result.Received / seconds)
+                  << std::endl;
+
+        if (result.Received == result.Emitted &&
+            result.Statistics.EventsDiscarded == 0 &&
+            result.Statistics.PacketsDiscarded == 0)
+        {
+            highestLosslessRate = rate;
+        }
+    }
+
+    std::cout << "highest lossless rate: " << highestLosslessRate
+              << " events/s" << std::endl;
+
+    return 0;
+}